@@ -15,6 +15,8 @@
 
 #include "MidiEvent.h"
 #include <vector>
+#include <atomic>
+#include <mutex>
 
 namespace smf {
 
@@ -22,11 +24,13 @@ class MidiEventList {
 	public:
 		                 MidiEventList      (void);
 		                 MidiEventList      (const MidiEventList& other);
-		                 MidiEventList      (MidiEventList&& other);
+		                 MidiEventList      (MidiEventList&& other) noexcept;
 
 		                ~MidiEventList      ();
 
 		MidiEventList&   operator=          (MidiEventList& other);
+		MidiEventList&   operator=          (MidiEventList&& other) noexcept;
+		void             swap               (MidiEventList& other) noexcept;
 		MidiEvent&       operator[]         (int index);
 		const MidiEvent& operator[]         (int index) const;
 
@@ -48,6 +52,11 @@ class MidiEventList {
 		void             clearSequence      (void);
 		int              markSequence       (int sequence = 1);
 
+		// lists of events by message kind (EVENT_KIND_* in MidiMessage.h):
+		const std::vector<MidiEvent*>& getEventsOfKind (int kind) const;
+		void             updateEventKinds   (void);
+		void             invalidateEventKinds (void);
+
 		int              push               (MidiEvent& event);
 		int              push_back          (MidiEvent& event);
 		int              append             (MidiEvent& event);
@@ -64,8 +73,27 @@ class MidiEventList {
 
 	private:
 		void             sort                (void);
-
-	// MidiFile class calls sort()
+		void             copyLinks           (const MidiEventList& other);
+		void             buildEventKinds     (void) const;
+		void             makeAbsoluteTicks   (void);
+		void             makeDeltaTicks      (void);
+		static void      accumulateTicks     (int* ticks, int count);
+		static int       differenceTicks     (int* ticks, int count);
+
+		// m_kinds == events in list order for each kind of message, built
+		// on demand by getEventsOfKind().  The lists of a const list may be
+		// requested from several threads, so they are built while holding
+		// m_kindsmutex.
+		mutable std::vector<std::vector<MidiEvent*>> m_kinds;
+		mutable std::atomic<bool> m_kindsvalid {false};
+		mutable std::mutex m_kindsmutex;
+
+		// m_refcount == the number of MidiFiles sharing this list (see
+		// MidiFile::shareTracks()).
+		std::atomic<int> m_refcount {1};
+
+	// MidiFile class calls sort(), copyLinks() and the tick conversions,
+	// and manages m_refcount
 	friend class MidiFile;
 };
 
@@ -15,11 +15,13 @@
 #define _MIDIFILE_H_INCLUDED
 
 #include "MidiEventList.h"
+#include "TempoMap.h"
 
 #include <vector>
 #include <string>
 #include <istream>
 #include <fstream>
+#include <functional>
 
 #define TIME_STATE_DELTA       0
 #define TIME_STATE_ABSOLUTE    1
@@ -27,14 +29,11 @@
 #define TRACK_STATE_SPLIT      0
 #define TRACK_STATE_JOINED     1
 
-namespace smf {
-
-class _TickTime {
-	public:
-		int    tick;
-		double seconds;
-};
+// Files with fewer events than this are processed one track at a time
+// by default (see MidiFile::setParallelThreshold()):
+#define PARALLEL_TRACK_EVENTS  20000
 
+namespace smf {
 
 class MidiFile {
 	public:
@@ -42,12 +41,13 @@ class MidiFile {
 		               MidiFile                    (const std::string& filename);
 		               MidiFile                    (std::istream& input);
 		               MidiFile                    (const MidiFile& other);
-		               MidiFile                    (MidiFile&& other);
+		               MidiFile                    (MidiFile&& other) noexcept;
 
 		              ~MidiFile                    ();
 
 		MidiFile&      operator=                   (const MidiFile& other);
-		MidiFile&      operator=                   (MidiFile&& other);
+		MidiFile&      operator=                   (MidiFile&& other) noexcept;
+		void           swap                        (MidiFile& other) noexcept;
 
 		// reading/writing functions:
 		bool           read                        (const std::string& filename);
@@ -71,6 +71,9 @@ class MidiFile {
 		int              getNumTracks              (void) const;
 		int              size                      (void) const;
 		void             removeEmpties             (void);
+		void             makeTrackUnique           (int aTrack);
+		void             makeTracksUnique          (void);
+		bool             isTrackShared             (int aTrack) const;
 
 		// tick-related functions:
 		void             makeDeltaTicks            (void);
@@ -122,12 +125,20 @@ class MidiFile {
 		int              getFileDurationInTicks    (void);
 		double           getFileDurationInQuarters (void);
 		double           getFileDurationInSeconds  (void);
+		const TempoMap&  getTempoMap               (void);
+		void             invalidateTimeMap         (int tick = 0);
 
 		// note-analysis functions:
 		int              linkNotePairs             (void);
 		int              linkEventPairs            (void);
 		void             clearLinks                (void);
 
+		// parallel track processing:
+		void             setThreadCount            (int count);
+		int              getThreadCount            (void) const;
+		static void      setParallelThreshold      (int events);
+		static int       getParallelThreshold      (void);
+
 		// filename functions:
 		void             setFilename               (const std::string& aname);
 		const char*      getFilename               (void) const;
@@ -267,11 +278,14 @@ class MidiFile {
 		// the object.
 		std::string m_readFileName;
 
-		// m_timemapvalid ==
-		bool m_timemapvalid = false;
+		// m_timemapdirty == Earliest absolute tick from which m_tempomap
+		// may not match the tempo messages of the file, or INT_MAX if the
+		// tempo map is up to date.
+		int m_timemapdirty = 0;
 
-		// m_timemap ==
-		std::vector<_TickTime> m_timemap;
+		// m_tempomap == Tempo segments for converting between ticks
+		// and seconds.
+		TempoMap m_tempomap;
 
 		// m_rwstatus == True if last read was successful, false if a problem.
 		bool m_rwstatus = true;
@@ -279,7 +293,21 @@ class MidiFile {
 		// m_linkedEventQ == True if link analysis has been done.
 		bool m_linkedEventsQ = false;
 
+		// m_threadcount == Number of threads used to process the tracks
+		// (0 for one per processor core).
+		int m_threadcount = 0;
+
+		// m_storagegeneration == Incremented whenever the track lists are
+		// replaced (such as when a shared track is copied before being
+		// modified) and whenever events are added or removed through the
+		// MidiFile interface.  Pointers to MidiEvents taken before the
+		// change may refer to old or deleted events.
+		int m_storagegeneration = 0;
+
+		void       shareTracks                     (const MidiFile& other);
+
 	private:
+		static void releaseList                    (MidiEventList* list);
 		int        extractMidiData                 (std::istream& inputfile,
 		                                            std::vector<uchar>& array,
 		                                            uchar& runningCommand);
@@ -290,11 +318,8 @@ class MidiFile {
 		void       writeVLValue                    (long aValue,
 		                                            std::vector<uchar>& data);
 		int        makeVLV                         (uchar *buffer, int number);
-		static int ticksearch                      (const void* A, const void* B);
-		static int secondsearch                    (const void* A, const void* B);
 		void       buildTimeMap                    (void);
-		double     linearTickInterpolationAtSecond (double seconds);
-		double     linearSecondInterpolationAtTick (int ticktime);
+		void       processTracks                   (const std::function<void(int)>& function);
 };
 
 } // end of namespace smf
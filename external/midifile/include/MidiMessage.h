@@ -17,6 +17,20 @@
 #include <vector>
 #include <string>
 
+// Event kind tags (see MidiMessage::getEventKind()):
+#define EVENT_KIND_EMPTY       0
+#define EVENT_KIND_NOTEON      1
+#define EVENT_KIND_NOTEOFF     2
+#define EVENT_KIND_CONTROLLER  3
+#define EVENT_KIND_PATCH       4
+#define EVENT_KIND_PITCHBEND   5
+#define EVENT_KIND_TEMPO       6
+#define EVENT_KIND_TEXT        7
+#define EVENT_KIND_META        8
+#define EVENT_KIND_SYSEX       9
+#define EVENT_KIND_OTHER      10
+#define EVENT_KIND_COUNT      11
+
 namespace smf {
 
 typedef unsigned char  uchar;
@@ -57,6 +71,7 @@ class MidiMessage : public std::vector<uchar> {
 
 		int            getSize              (void) const;
 		void           setSize              (int asize);
+		void           clear                (void);
 		int            setSizeToCommand     (void);
 		int            resizeToCommand      (void);
 
@@ -166,6 +181,13 @@ class MidiMessage : public std::vector<uchar> {
 		void           setTempoMicroseconds (int microseconds);
 		void           setMetaTempo         (double tempo);
 
+		// message kind tag for indexing events by type:
+		int            getEventKind         (void) const;
+		void           updateEventKind      (void);
+
+	private:
+		uchar          m_kind = EVENT_KIND_EMPTY;  // EVENT_KIND_* of the bytes
+
 };
 
 } // end of namespace smf
@@ -54,17 +54,12 @@ MidiEvent::MidiEvent(int aTime, int aTrack, vector<uchar>& message)
 }
 
 
-MidiEvent::MidiEvent(const MidiEvent& mfevent) : MidiMessage() {
+MidiEvent::MidiEvent(const MidiEvent& mfevent) : MidiMessage(mfevent) {
 	track   = mfevent.track;
 	tick    = mfevent.tick;
 	seconds = mfevent.seconds;
 	seq     = mfevent.seq;
 	m_eventlink = NULL;
-
-	this->resize(mfevent.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = mfevent[i];
-	}
 }
 
 
@@ -112,10 +107,7 @@ MidiEvent& MidiEvent::operator=(const MidiEvent& mfevent) {
 	seconds = mfevent.seconds;
 	seq     = mfevent.seq;
 	m_eventlink = NULL;
-	this->resize(mfevent.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = mfevent[i];
-	}
+	MidiMessage::operator=(mfevent);
 	return *this;
 }
 
@@ -125,20 +117,14 @@ MidiEvent& MidiEvent::operator=(const MidiMessage& message) {
 		return *this;
 	}
 	clearVariables();
-	this->resize(message.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = message[i];
-	}
+	MidiMessage::operator=(message);
 	return *this;
 }
 
 
 MidiEvent& MidiEvent::operator=(const vector<uchar>& bytes) {
 	clearVariables();
-	this->resize(bytes.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = bytes[i];
-	}
+	setMessage(bytes);
 	return *this;
 }
 
@@ -16,10 +16,22 @@
 #include <vector>
 #include <algorithm>
 #include <iterator>
+#include <iostream>
 #include <utility>
+#include <unordered_map>
 
 #include "stdlib.h"
 
+// The AVX2 kernels are compiled for AVX2 with a function attribute and
+// are only used if the processor supports it, since the library is not
+// built with -mavx2:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define MIDIEVENTLIST_AVX2_DISPATCH
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
 namespace smf {
 
 //////////////////////////////
@@ -53,9 +65,12 @@ MidiEventList::MidiEventList(const MidiEventList& other) {
 // MidiEventList::MidiEventList(MidiEventList&&) -- Move constructor.
 //
 
-MidiEventList::MidiEventList(MidiEventList&& other) {
-   list = std::move(other.list);
-   other.list.clear();
+MidiEventList::MidiEventList(MidiEventList&& other) noexcept {
+	list = std::move(other.list);
+	other.list.clear();
+	m_kinds.swap(other.m_kinds);
+	m_kindsvalid.store(other.m_kindsvalid.load());
+	other.m_kindsvalid.store(false);
 }
 
 
@@ -148,6 +163,7 @@ void MidiEventList::clear(void) {
 		}
 	}
 	list.resize(0);
+	invalidateEventKinds();
 }
 
 
@@ -157,6 +173,7 @@ void MidiEventList::clear(void) {
 // MidiEventList::data -- Return the low-level array of MidiMessage
 //     pointers.  This is useful for applying your own sorting
 //     function to the list.
+//     Call invalidateEventKinds() after reordering the list in this way.
 //
 
 MidiEvent** MidiEventList::data(void) {
@@ -215,6 +232,7 @@ int MidiEventList::getEventCount(void) const {
 int MidiEventList::append(MidiEvent& event) {
 	MidiEvent* ptr = new MidiEvent(event);
 	list.push_back(ptr);
+	invalidateEventKinds();
 	return (int)list.size()-1;
 }
 
@@ -255,6 +273,7 @@ void MidiEventList::removeEmpties(void) {
 	if (count == 0) {
 		return;
 	}
+	invalidateEventKinds();
 	std::vector<MidiEvent*> newlist;
 	newlist.reserve(list.size() - count);
 	for (int i=0; i<(int)list.size(); i++) {
@@ -471,6 +490,62 @@ int MidiEventList::markSequence(int sequence) {
 }
 
 
+//////////////////////////////
+//
+// MidiEventList::getEventsOfKind -- Return the events in the list which
+//   have the given kind of message (one of the EVENT_KIND_* values in
+//   MidiMessage.h), in list order.  The lists are built from the kind
+//   stored in each event when first requested, and kept until events are
+//   added to, removed from or sorted in the list.  Call updateEventKinds()
+//   after changing the kind of a message in place.  An empty list is
+//   returned for an invalid kind.  Several threads may request the lists
+//   of the same list at once, as long as none of them changes it.
+//
+
+const std::vector<MidiEvent*>& MidiEventList::getEventsOfKind(int kind) const {
+	static const std::vector<MidiEvent*> empty;
+	if ((kind < 0) || (kind >= EVENT_KIND_COUNT)) {
+		return empty;
+	}
+	if (!m_kindsvalid.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(m_kindsmutex);
+		if (!m_kindsvalid.load(std::memory_order_relaxed)) {
+			buildEventKinds();
+		}
+	}
+	return m_kinds[kind];
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::updateEventKinds -- Refresh the message kind of every
+//   event (for bytes changed directly through the std::vector interface)
+//   and rebuild the lists of events by kind.
+//
+
+void MidiEventList::updateEventKinds(void) {
+	for (int i=0; i<(int)list.size(); i++) {
+		list[i]->updateEventKind();
+	}
+	buildEventKinds();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::invalidateEventKinds -- Discard the lists of events
+//   by kind, so that they are rebuilt when next requested.
+//
+
+void MidiEventList::invalidateEventKinds(void) {
+	m_kindsvalid.store(false);
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // protected functions --
@@ -486,6 +561,7 @@ int MidiEventList::markSequence(int sequence) {
 
 void MidiEventList::detach(void) {
 	list.resize(0);
+	invalidateEventKinds();
 }
 
 
@@ -499,6 +575,7 @@ void MidiEventList::detach(void) {
 
 int MidiEventList::push_back_no_copy(MidiEvent* event) {
 	list.push_back(event);
+	invalidateEventKinds();
 	return (int)list.size()-1;
 }
 
@@ -510,11 +587,41 @@ int MidiEventList::push_back_no_copy(MidiEvent* event) {
 //
 
 MidiEventList& MidiEventList::operator=(MidiEventList& other) {
-	list.swap(other.list);
+	swap(other);
+	return *this;
+}
+
+
+MidiEventList& MidiEventList::operator=(MidiEventList&& other) noexcept {
+	if (this == &other) {
+		return *this;
+	}
+	clear();
+	list = std::move(other.list);
+	other.list.clear();
+	m_kinds.swap(other.m_kinds);
+	m_kindsvalid.store(other.m_kindsvalid.load());
+	other.m_kindsvalid.store(false);
 	return *this;
 }
 
 
+
+//////////////////////////////
+//
+// MidiEventList::swap -- Exchange the events of two lists without
+//    copying them.
+//
+
+void MidiEventList::swap(MidiEventList& other) noexcept {
+	list.swap(other.list);
+	m_kinds.swap(other.m_kinds);
+	bool valid = m_kindsvalid.load();
+	m_kindsvalid.store(other.m_kindsvalid.load());
+	other.m_kindsvalid.store(valid);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // private functions
@@ -530,6 +637,268 @@ MidiEventList& MidiEventList::operator=(MidiEventList& other) {
 
 void MidiEventList::sort(void) {
 	qsort(data(), getEventCount(), sizeof(MidiEvent*), eventcompare);
+	invalidateEventKinds();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::copyLinks -- Link the events in the same way as the
+//    events at the same positions in another list, such as the list that
+//    this one was copied from.  Both note and controller links are kept,
+//    including links which linkNotePairs() would not make.  Links to
+//    events outside of the other list are not copied.
+//
+
+void MidiEventList::copyLinks(const MidiEventList& other) {
+	clearLinks();
+	int count = std::min(getEventCount(), other.getEventCount());
+	std::unordered_map<const MidiEvent*, int> positions;
+	positions.reserve(count);
+	for (int i=0; i<count; i++) {
+		positions[other.list[i]] = i;
+	}
+	for (int i=0; i<count; i++) {
+		const MidiEvent* link = other.list[i]->getLinkedEvent();
+		if (link == NULL) {
+			continue;
+		}
+		auto it = positions.find(link);
+		if ((it != positions.end()) && (it->second > i)) {
+			list[i]->linkEvent(list[it->second]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::buildEventKinds -- Sort the events into lists by the
+//    kind of message stored in each event.
+//
+
+void MidiEventList::buildEventKinds(void) const {
+	m_kinds.resize(EVENT_KIND_COUNT);
+	for (int i=0; i<(int)m_kinds.size(); i++) {
+		m_kinds[i].clear();
+	}
+	for (int i=0; i<(int)list.size(); i++) {
+		m_kinds[list[i]->getEventKind()].push_back(list[i]);
+	}
+	m_kindsvalid.store(true, std::memory_order_release);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::makeAbsoluteTicks -- Convert the delta ticks of the
+//    events into absolute ticks.  Private because the MidiFile class
+//    keeps track of the delta/absolute tick state of the list.  The
+//    ticks are copied into a contiguous buffer so that the running sum
+//    can be calculated several events at a time.
+//
+
+void MidiEventList::makeAbsoluteTicks(void) {
+	int count = (int)list.size();
+	if (count < 2) {
+		return;
+	}
+	std::vector<int> ticks(count);
+	for (int i=0; i<count; i++) {
+		ticks[i] = list[i]->tick;
+	}
+	accumulateTicks(ticks.data(), count);
+	for (int i=0; i<count; i++) {
+		list[i]->tick = ticks[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::makeDeltaTicks -- Convert the absolute ticks of the
+//    events into delta ticks.  Private for the same reason as
+//    makeAbsoluteTicks().  An error message is printed for each
+//    negative delta tick, which happens when the list is not sorted.
+//
+
+void MidiEventList::makeDeltaTicks(void) {
+	int count = (int)list.size();
+	if (count < 2) {
+		return;
+	}
+	std::vector<int> ticks(count);
+	for (int i=0; i<count; i++) {
+		ticks[i] = list[i]->tick;
+	}
+	int negatives = differenceTicks(ticks.data(), count);
+	for (int i=0; i<count; i++) {
+		list[i]->tick = ticks[i];
+		if ((negatives > 0) && (ticks[i] < 0) && (i > 0)) {
+			std::cerr << "Error: negative delta tick value: " << ticks[i] << std::endl
+			     << "Timestamps must be sorted first"
+			     << " (use MidiFile::sortTracks() before writing)." << std::endl;
+		}
+	}
+}
+
+
+
+#if defined(MIDIEVENTLIST_AVX2_DISPATCH)
+
+//////////////////////////////
+//
+// accumulateTicksAvx2 -- Calculate the prefix sum of the ticks eight at
+//    a time with AVX2 for MidiEventList::accumulateTicks().  Returns the
+//    number of ticks which were summed (a multiple of eight).
+//
+
+__attribute__((target("avx2")))
+static int accumulateTicksAvx2(int* ticks, int count) {
+	__m256i carry = _mm256_setzero_si256();
+	__m256i last  = _mm256_set1_epi32(7);
+	int i = 0;
+	for (; i+8<=count; i+=8) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(ticks + i));
+		// sum within each group of four values:
+		x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+		x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+		// add the total of the lower four values to the upper four:
+		__m256i low = _mm256_shuffle_epi32(x, 0xff);
+		x = _mm256_add_epi32(x, _mm256_permute2x128_si256(low, low, 0x08));
+		x = _mm256_add_epi32(x, carry);
+		_mm256_storeu_si256((__m256i*)(ticks + i), x);
+		carry = _mm256_permutevar8x32_epi32(x, last);
+	}
+	return i;
+}
+
+
+
+//////////////////////////////
+//
+// differenceTicksAvx2 -- Calculate the differences of the ticks eight at
+//    a time from the end with AVX2 for MidiEventList::differenceTicks(),
+//    adding the number of negative differences to negatives.  Returns
+//    the index after the last tick which still needs a difference.
+//
+
+__attribute__((target("avx2")))
+static int differenceTicksAvx2(int* ticks, int count, int& negatives) {
+	__m256i zero = _mm256_setzero_si256();
+	__m256i sum  = _mm256_setzero_si256();
+	int i = count;
+	for (; i-8>=1; i-=8) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(ticks + i - 8));
+		__m256i y = _mm256_loadu_si256((const __m256i*)(ticks + i - 9));
+		x = _mm256_sub_epi32(x, y);
+		_mm256_storeu_si256((__m256i*)(ticks + i - 8), x);
+		sum = _mm256_sub_epi32(sum, _mm256_cmpgt_epi32(zero, x));
+	}
+	int counts[8];
+	_mm256_storeu_si256((__m256i*)counts, sum);
+	for (int j=0; j<8; j++) {
+		negatives += counts[j];
+	}
+	return i;
+}
+
+#endif
+
+
+
+//////////////////////////////
+//
+// MidiEventList::accumulateTicks -- Replace each value in the array
+//    with the sum of itself and all previous values (inclusive prefix
+//    sum).  Blocks of values are summed in registers by adding shifted
+//    copies of the block to itself, then adding the running total of
+//    the previous blocks.
+//
+
+void MidiEventList::accumulateTicks(int* ticks, int count) {
+	int i = 0;
+
+#if defined(MIDIEVENTLIST_AVX2_DISPATCH)
+	static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+	if (hasAvx2) {
+		i = accumulateTicksAvx2(ticks, count);
+	}
+#endif
+
+	int total = (i > 0) ? ticks[i-1] : 0;
+
+#if defined(__SSE2__)
+	__m128i carry = _mm_set1_epi32(total);
+	for (; i+4<=count; i+=4) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(ticks + i));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+		x = _mm_add_epi32(x, carry);
+		_mm_storeu_si128((__m128i*)(ticks + i), x);
+		carry = _mm_shuffle_epi32(x, 0xff);
+	}
+	if (i > 0) {
+		total = ticks[i-1];
+	}
+#endif
+
+	for (; i<count; i++) {
+		total += ticks[i];
+		ticks[i] = total;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::differenceTicks -- Replace each value in the array
+//    with its difference from the previous value (the first value is
+//    unchanged).  The array is processed from the end so that the
+//    previous values are still available when a block is stored.
+//    Returns the number of negative differences.
+//
+
+int MidiEventList::differenceTicks(int* ticks, int count) {
+	int negatives = 0;
+	int i = count;
+
+#if defined(MIDIEVENTLIST_AVX2_DISPATCH)
+	static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+	if (hasAvx2) {
+		i = differenceTicksAvx2(ticks, count, negatives);
+	}
+#endif
+
+#if defined(__SSE2__)
+	__m128i zero = _mm_setzero_si128();
+	__m128i sum  = _mm_setzero_si128();
+	for (; i-4>=1; i-=4) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(ticks + i - 4));
+		__m128i y = _mm_loadu_si128((const __m128i*)(ticks + i - 5));
+		x = _mm_sub_epi32(x, y);
+		_mm_storeu_si128((__m128i*)(ticks + i - 4), x);
+		sum = _mm_sub_epi32(sum, _mm_cmpgt_epi32(zero, x));
+	}
+	int counts[4];
+	_mm_storeu_si128((__m128i*)counts, sum);
+	for (int j=0; j<4; j++) {
+		negatives += counts[j];
+	}
+#endif
+
+	for (i=i-1; i>=1; i--) {
+		ticks[i] -= ticks[i-1];
+		if (ticks[i] < 0) {
+			negatives++;
+		}
+	}
+	return negatives;
 }
 
 
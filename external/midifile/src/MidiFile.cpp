@@ -23,10 +23,144 @@
 #include <sstream>
 #include <iterator>
 #include <algorithm>
+#include <utility>
+#include <climits>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 
 namespace smf {
 
+// The smallest event count processed in parallel:
+static std::atomic<int> parallelThreshold(PARALLEL_TRACK_EVENTS);
+
+
+namespace {
+
+//////////////////////////////
+//
+// TrackPool -- Worker threads shared by all MidiFiles for processing
+//    tracks in parallel.  The threads are started the first time they
+//    are needed and then wait for the next job, so processTracks() does
+//    not start and stop threads on every call.  The calling thread
+//    always works on its own job, so a job finishes even when all of the
+//    pool threads are busy with other jobs.
+//
+
+class TrackPool {
+	public:
+		static TrackPool& get     (void);
+		void              run     (int count, int threads,
+		                           const std::function<void(int)>& function);
+
+	private:
+		struct Job {
+			const std::function<void(int)>* function;
+			int              count;
+			std::atomic<int> next;
+			int              helpers;  // pool threads still wanted
+			int              active;   // pool threads working on the job
+		};
+
+		void              work    (void);
+
+		std::mutex               m_mutex;
+		std::condition_variable  m_wake;
+		std::condition_variable  m_done;
+		std::deque<Job*>         m_jobs;
+		std::vector<std::thread> m_threads;
+};
+
+
+
+//////////////////////////////
+//
+// TrackPool::get -- Return the pool.  It is never deleted, so exiting
+//    does not wait for the threads, and a forked process does not try to
+//    join threads which it does not have.
+//
+
+TrackPool& TrackPool::get(void) {
+	static TrackPool* pool = new TrackPool;
+	return *pool;
+}
+
+
+
+//////////////////////////////
+//
+// TrackPool::run -- Call the function for each index from 0 to
+//    count-1 using the calling thread and up to threads-1 pool threads.
+//    Returns when all of the calls have finished.
+//
+
+void TrackPool::run(int count, int threads,
+		const std::function<void(int)>& function) {
+	Job job;
+	job.function = &function;
+	job.count    = count;
+	job.next     = 0;
+	job.helpers  = threads - 1;
+	job.active   = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		while ((int)m_threads.size() < job.helpers) {
+			m_threads.emplace_back(&TrackPool::work, this);
+		}
+		m_jobs.push_back(&job);
+	}
+	m_wake.notify_all();
+
+	int index;
+	while ((index = job.next.fetch_add(1)) < count) {
+		function(index);
+	}
+
+	// Stop more pool threads from taking the job, and wait for the ones
+	// which did to finish their last index:
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto it = std::find(m_jobs.begin(), m_jobs.end(), &job);
+	if (it != m_jobs.end()) {
+		m_jobs.erase(it);
+	}
+	m_done.wait(lock, [&job]() { return job.active == 0; });
+}
+
+
+
+//////////////////////////////
+//
+// TrackPool::work -- Loop of each pool thread: take the oldest job which
+//    still wants help and process its indexes until none are left.
+//
+
+void TrackPool::work(void) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_wake.wait(lock, [this]() { return !m_jobs.empty(); });
+		Job* job = m_jobs.front();
+		if (--job->helpers <= 0) {
+			m_jobs.pop_front();
+		}
+		job->active++;
+		lock.unlock();
+		int index;
+		while ((index = job->next.fetch_add(1)) < job->count) {
+			(*job->function)(index);
+		}
+		lock.lock();
+		if (--job->active == 0) {
+			m_done.notify_all();
+		}
+	}
+}
+
+} // end of anonymous namespace
+
+
 //////////////////////////////
 //
 // MidiFile::MidiFile -- Constuctor.
@@ -65,7 +199,7 @@ MidiFile::MidiFile(const MidiFile& other) {
 
 
 
-MidiFile::MidiFile(MidiFile&& other) {
+MidiFile::MidiFile(MidiFile&& other) noexcept {
 	*this = std::move(other);
 }
 
@@ -85,21 +219,29 @@ MidiFile::~MidiFile() {
 	}
 	m_events.resize(0);
 	m_rwstatus = false;
-	m_timemap.clear();
-	m_timemapvalid = 0;
+	m_tempomap.clear();
+	invalidateTimeMap();
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::operator= -- Copying another
+// MidiFile::operator= -- Copying another MidiFile.  The events of the
+//    other file are duplicated, and any previous contents are deleted.
+//    Moving another MidiFile takes ownership of its events without
+//    copying them, leaving the other file empty.
 //
 
 MidiFile& MidiFile::operator=(const MidiFile& other) {
 	if (this == &other) {
 		return *this;
 	}
+	for (int i=0; i<(int)m_events.size(); i++) {
+		releaseList(m_events[i]);
+		m_events[i] = NULL;
+	}
+	m_events.clear();
 	m_events.reserve(other.m_events.size());
 	auto it = other.m_events.begin();
 	std::generate_n(std::back_inserter(m_events), other.m_events.size(),
@@ -112,9 +254,11 @@ MidiFile& MidiFile::operator=(const MidiFile& other) {
 	m_theTrackState       = other.m_theTrackState;
 	m_theTimeState        = other.m_theTimeState;
 	m_readFileName        = other.m_readFileName;
-	m_timemapvalid        = other.m_timemapvalid;
-	m_timemap             = other.m_timemap;
+	m_timemapdirty        = other.m_timemapdirty;
+	m_tempomap            = other.m_tempomap;
 	m_rwstatus            = other.m_rwstatus;
+	m_linkedEventsQ       = false;
+	m_storagegeneration++;
 	if (other.m_linkedEventsQ) {
 		linkEventPairs();
 	}
@@ -122,7 +266,13 @@ MidiFile& MidiFile::operator=(const MidiFile& other) {
 }
 
 
-MidiFile& MidiFile::operator=(MidiFile&& other) {
+MidiFile& MidiFile::operator=(MidiFile&& other) noexcept {
+	if (this == &other) {
+		return *this;
+	}
+	for (int i=0; i<(int)m_events.size(); i++) {
+		releaseList(m_events[i]);
+	}
 	m_events = std::move(other.m_events);
 	m_linkedEventsQ = other.m_linkedEventsQ;
 	other.m_linkedEventsQ = false;
@@ -132,14 +282,44 @@ MidiFile& MidiFile::operator=(MidiFile&& other) {
 	m_trackCount          = other.m_trackCount;
 	m_theTrackState       = other.m_theTrackState;
 	m_theTimeState        = other.m_theTimeState;
-	m_readFileName        = other.m_readFileName;
-	m_timemapvalid        = other.m_timemapvalid;
-	m_timemap             = other.m_timemap;
+	m_readFileName        = std::move(other.m_readFileName);
+	m_timemapdirty        = other.m_timemapdirty;
+	m_tempomap.swap(other.m_tempomap);
 	m_rwstatus            = other.m_rwstatus;
+	m_storagegeneration   = other.m_storagegeneration;
+	other.m_storagegeneration++;
+	other.m_trackCount    = 1;
+	other.m_theTrackState = TRACK_STATE_SPLIT;
+	other.m_theTimeState  = TIME_STATE_ABSOLUTE;
+	other.m_readFileName.clear();
+	other.invalidateTimeMap();
+	other.m_tempomap.clear();
 	return *this;
 }
 
 
+
+//////////////////////////////
+//
+// MidiFile::swap -- Exchange the contents of two MidiFiles without
+//    copying their events.
+//
+
+void MidiFile::swap(MidiFile& other) noexcept {
+	m_events.swap(other.m_events);
+	std::swap(m_ticksPerQuarterNote, other.m_ticksPerQuarterNote);
+	std::swap(m_trackCount,          other.m_trackCount);
+	std::swap(m_theTrackState,       other.m_theTrackState);
+	std::swap(m_theTimeState,        other.m_theTimeState);
+	m_readFileName.swap(other.m_readFileName);
+	std::swap(m_timemapdirty,        other.m_timemapdirty);
+	m_tempomap.swap(other.m_tempomap);
+	std::swap(m_rwstatus,            other.m_rwstatus);
+	std::swap(m_linkedEventsQ,       other.m_linkedEventsQ);
+	std::swap(m_storagegeneration,   other.m_storagegeneration);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // reading/writing functions --
@@ -152,7 +332,7 @@ MidiFile& MidiFile::operator=(MidiFile&& other) {
 //
 
 bool MidiFile::read(const std::string& filename) {
-	m_timemapvalid = 0;
+	invalidateTimeMap();
 	setFilename(filename);
 	m_rwstatus = true;
 
@@ -173,6 +353,7 @@ bool MidiFile::read(const std::string& filename) {
 //
 
 bool MidiFile::read(std::istream& input) {
+	invalidateTimeMap();
 	m_rwstatus = true;
 	if (input.peek() != 'M') {
 		// If the first byte in the input stream is not 'M', then presume that
@@ -740,9 +921,12 @@ bool MidiFile::status(void) const {
 //////////////////////////////
 //
 // MidiFile::operator[] -- return the event list for the specified track.
+//     A track shared with another MidiFile is copied first when the
+//     non-const version is used.
 //
 
 MidiEventList& MidiFile::operator[](int aTrack) {
+	makeTrackUnique(aTrack);
 	return *m_events[aTrack];
 }
 
@@ -786,9 +970,105 @@ int MidiFile::size(void) const {
 //
 
 void MidiFile::removeEmpties(void) {
+	invalidateTimeMap();
+	makeTracksUnique();
+	m_storagegeneration++;
+	processTracks([this](int track) {
+		m_events[track]->removeEmpties();
+	});
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::makeTrackUnique -- Copy a track which is shared with
+//     another MidiFile (see MidiRoll::fork()), so that it can be modified
+//     without changing the other file.  Events in the copy are linked in
+//     the same way as in the original.  Pointers to MidiEvents in
+//     the track which were taken before the copy was made refer to the
+//     shared events.
+//
+
+void MidiFile::makeTrackUnique(int aTrack) {
+	if ((aTrack < 0) || (aTrack >= (int)m_events.size())) {
+		return;
+	}
+	MidiEventList* list = m_events[aTrack];
+	if ((list == NULL) || (list->m_refcount.load(std::memory_order_acquire) == 1)) {
+		return;
+	}
+	MidiEventList* copy = new MidiEventList(*list);
+	copy->copyLinks(*list);
+	m_events[aTrack] = copy;
+	releaseList(list);
+	m_storagegeneration++;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::makeTracksUnique -- Copy all tracks which are shared with
+//     another MidiFile.
+//
+
+void MidiFile::makeTracksUnique(void) {
+	for (int i=0; i<(int)m_events.size(); i++) {
+		makeTrackUnique(i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::isTrackShared -- Returns true if the track list is shared
+//     with another MidiFile.
+//
+
+bool MidiFile::isTrackShared(int aTrack) const {
+	if ((aTrack < 0) || (aTrack >= (int)m_events.size())) {
+		return false;
+	}
+	if (m_events[aTrack] == NULL) {
+		return false;
+	}
+	return m_events[aTrack]->m_refcount.load(std::memory_order_acquire) > 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::shareTracks -- Replace the contents of the MidiFile with
+//     the track lists of another MidiFile without copying the events.
+//     The shared tracks are copied by the first MidiFile which modifies
+//     them (copy-on-write).
+//
+
+void MidiFile::shareTracks(const MidiFile& other) {
+	if (this == &other) {
+		return;
+	}
+	for (int i=0; i<(int)m_events.size(); i++) {
+		releaseList(m_events[i]);
+		m_events[i] = NULL;
+	}
+	m_events = other.m_events;
 	for (int i=0; i<(int)m_events.size(); i++) {
-		m_events[i]->removeEmpties();
+		m_events[i]->m_refcount.fetch_add(1, std::memory_order_relaxed);
 	}
+	m_ticksPerQuarterNote = other.m_ticksPerQuarterNote;
+	m_trackCount          = other.m_trackCount;
+	m_theTrackState       = other.m_theTrackState;
+	m_theTimeState        = other.m_theTimeState;
+	m_readFileName        = other.m_readFileName;
+	m_timemapdirty        = other.m_timemapdirty;
+	m_tempomap            = other.m_tempomap;
+	m_rwstatus            = other.m_rwstatus;
+	m_linkedEventsQ       = other.m_linkedEventsQ;
+	m_storagegeneration++;
 }
 
 
@@ -807,10 +1087,17 @@ void MidiFile::removeEmpties(void) {
 //
 
 void MidiFile::markSequence(void) {
+	makeTracksUnique();
+	// first sequence number of each track:
+	std::vector<int> sequences(getTrackCount());
 	int sequence = 1;
 	for (int i=0; i<getTrackCount(); i++) {
-		sequence = operator[](i).markSequence(sequence);
+		sequences[i] = sequence;
+		sequence += m_events[i]->getEventCount();
 	}
+	processTracks([this, &sequences](int track) {
+		m_events[track]->markSequence(sequences[track]);
+	});
 }
 
 //
@@ -872,6 +1159,8 @@ void MidiFile::joinTracks(void) {
 		return;
 	}
 
+	makeTracksUnique();
+	m_storagegeneration++;
 	MidiEventList* joinedTrack;
 	joinedTrack = new MidiEventList;
 
@@ -918,6 +1207,8 @@ void MidiFile::splitTracks(void) {
 	if (getTrackState() == TRACK_STATE_SPLIT) {
 		return;
 	}
+	makeTracksUnique();
+	m_storagegeneration++;
 	int oldTimeState = getTickState();
 	if (oldTimeState == TIME_STATE_DELTA) {
 		makeAbsoluteTicks();
@@ -972,6 +1263,8 @@ void MidiFile::splitTracksByChannel(void) {
 	if (getTrackState() == TRACK_STATE_SPLIT) {
 		return;
 	}
+	makeTracksUnique();
+	m_storagegeneration++;
 
 	int oldTimeState = getTickState();
 	if (oldTimeState == TIME_STATE_DELTA) {
@@ -1115,31 +1408,11 @@ void MidiFile::makeDeltaTicks(void) {
 	if (getTickState() == TIME_STATE_DELTA) {
 		return;
 	}
-	int i, j;
-	int temp;
-	int length = getNumTracks();
-	int *timedata = new int[length];
-	for (i=0; i<length; i++) {
-		timedata[i] = 0;
-		if (m_events[i]->size() > 0) {
-			timedata[i] = (*m_events[i])[0].tick;
-		} else {
-			continue;
-		}
-		for (j=1; j<(int)m_events[i]->size(); j++) {
-			temp = (*m_events[i])[j].tick;
-			int deltatick = temp - timedata[i];
-			if (deltatick < 0) {
-				std::cerr << "Error: negative delta tick value: " << deltatick << std::endl
-				     << "Timestamps must be sorted first"
-				     << " (use MidiFile::sortTracks() before writing)." << std::endl;
-			}
-			(*m_events[i])[j].tick = deltatick;
-			timedata[i] = temp;
-		}
-	}
+	makeTracksUnique();
+	processTracks([this](int track) {
+		m_events[track]->makeDeltaTicks();
+	});
 	m_theTimeState = TIME_STATE_DELTA;
-	delete [] timedata;
 }
 
 //
@@ -1166,23 +1439,11 @@ void MidiFile::makeAbsoluteTicks(void) {
 	if (getTickState() == TIME_STATE_ABSOLUTE) {
 		return;
 	}
-	int i, j;
-	int length = getNumTracks();
-	int* timedata = new int[length];
-	for (i=0; i<length; i++) {
-		timedata[i] = 0;
-		if (m_events[i]->size() > 0) {
-			timedata[i] = (*m_events[i])[0].tick;
-		} else {
-			continue;
-		}
-		for (j=1; j<(int)m_events[i]->size(); j++) {
-			timedata[i] += (*m_events[i])[j].tick;
-			(*m_events[i])[j].tick = timedata[i];
-		}
-	}
+	makeTracksUnique();
+	processTracks([this](int track) {
+		m_events[track]->makeAbsoluteTicks();
+	});
 	m_theTimeState = TIME_STATE_ABSOLUTE;
-	delete [] timedata;
 }
 
 //
@@ -1287,30 +1548,10 @@ double MidiFile::getFileDurationInQuarters(void) {
 //    The file state can be in delta ticks since this function
 //    will temporarily go to absolute tick mode for the calculation
 //    of the max time.
+//
 
 double MidiFile::getFileDurationInSeconds(void) {
-	if (m_timemapvalid == 0) {
-		buildTimeMap();
-		if (m_timemapvalid == 0) {
-			return -1.0;    // something went wrong
-		}
-	}
-	bool revertToDelta = false;
-	if (isDeltaTicks()) {
-		makeAbsoluteTicks();
-		revertToDelta = true;
-	}
-	const MidiFile& mf = *this;
-	double output = 0.0;
-	for (int i=0; i<mf.getTrackCount(); i++) {
-		if (mf[i].back().seconds > output) {
-			output = mf[i].back().seconds;
-		}
-	}
-	if (revertToDelta) {
-		deltaTicks();
-	}
-	return output;
+	return getTimeInSeconds(getFileDurationInTicks());
 }
 
 
@@ -1323,10 +1564,14 @@ double MidiFile::getFileDurationInSeconds(void) {
 //
 // MidiFile::doTimeAnalysis -- Identify the real-time position of
 //    all events by monitoring the tempo in relations to the tick
-//    times in the file.
+//    times in the file.  The tempo map is always rebuilt from the start,
+//    since tempo messages may have been edited in place without calling
+//    invalidateTimeMap().
 //
 
 void MidiFile::doTimeAnalysis(void) {
+	m_tempomap.clear();
+	invalidateTimeMap();
 	buildTimeMap();
 }
 
@@ -1335,7 +1580,8 @@ void MidiFile::doTimeAnalysis(void) {
 //////////////////////////////
 //
 // MidiFile::getTimeInSeconds -- return the time in seconds for
-//     the current message.
+//     the current message, or for an absolute tick value.  Ticks after
+//     the last tempo message are converted with the last tempo.
 //
 
 double MidiFile::getTimeInSeconds(int aTrack, int anIndex) {
@@ -1344,69 +1590,63 @@ double MidiFile::getTimeInSeconds(int aTrack, int anIndex) {
 
 
 double MidiFile::getTimeInSeconds(int tickvalue) {
-	if (m_timemapvalid == 0) {
-		buildTimeMap();
-		if (m_timemapvalid == 0) {
-			return -1.0;    // something went wrong
-		}
-	}
+	return getTempoMap().getTimeInSeconds(tickvalue);
+}
 
-	_TickTime key;
-	key.tick    = tickvalue;
-	key.seconds = -1;
 
-	void* ptr = bsearch(&key, m_timemap.data(), m_timemap.size(),
-			sizeof(_TickTime), ticksearch);
 
-	if (ptr == NULL) {
-		// The specific tick value was not found, so do a linear
-		// search for the two tick values which occur before and
-		// after the tick value, and do a linear interpolation of
-		// the time in seconds values to figure out the final
-		// time in seconds.
-		// Since the code is not yet written, kill the program at this point:
-		return linearSecondInterpolationAtTick(tickvalue);
-	} else {
-		return ((_TickTime*)ptr)->seconds;
-	}
+//////////////////////////////
+//
+// MidiFile::getAbsoluteTickTime -- return the tick value represented
+//    by the input time in seconds.  The result is fractional if the
+//    time falls between two ticks.
+//
+
+double MidiFile::getAbsoluteTickTime(double starttime) {
+	return getTempoMap().getAbsoluteTickTime(starttime);
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::getAbsoluteTickTime -- return the tick value represented
-//    by the input time in seconds.  If there is not tick entry at
-//    the given time in seconds, then interpolate between two values.
+// MidiFile::getTempoMap -- return the tempo map of the file, which
+//    converts between absolute ticks and time in seconds.  The map is
+//    rebuilt if the file has changed since it was last calculated.  Use
+//    doTimeAnalysis() to also store the time in seconds in each event.
 //
 
-double MidiFile::getAbsoluteTickTime(double starttime) {
-	if (m_timemapvalid == 0) {
-		buildTimeMap();
-		if (m_timemapvalid == 0) {
-			if (m_timemapvalid == 0) {
-				return -1.0;    // something went wrong
-			}
-		}
+const TempoMap& MidiFile::getTempoMap(void) {
+	if (m_timemapdirty != INT_MAX) {
+		m_tempomap.update(*this, m_timemapdirty);
+		m_timemapdirty = INT_MAX;
 	}
+	return m_tempomap;
+}
 
-	_TickTime key;
-	key.tick    = -1;
-	key.seconds = starttime;
 
-	void* ptr = bsearch(&key, m_timemap.data(), m_timemap.size(),
-			sizeof(_TickTime), secondsearch);
 
-	if (ptr == NULL) {
-		// The specific seconds value was not found, so do a linear
-		// search for the two time values which occur before and
-		// after the given time value, and do a linear interpolation of
-		// the time in tick values to figure out the final time in ticks.
-		return linearTickInterpolationAtSecond(starttime);
-	} else {
-		return ((_TickTime*)ptr)->tick;
-	}
+//////////////////////////////
+//
+// MidiFile::invalidateTimeMap -- Mark the tempo map as out of date from
+//    the given absolute tick onwards.  Functions which add events or
+//    change the tempo do this automatically, but call this function after
+//    changing the tempo or tick values of events directly.  The next
+//    getTempoMap() then only recalculates the tempo segments after the
+//    earliest marked tick.  If the file is in delta tick mode, the tick
+//    is not an absolute time, so everything is marked out of date.  The
+//    time in seconds stored in events is only updated by doTimeAnalysis().
+//
+// default value: tick = 0
+//
 
+void MidiFile::invalidateTimeMap(int tick) {
+	if (isDeltaTicks() || (tick < 0)) {
+		tick = 0;
+	}
+	if (tick < m_timemapdirty) {
+		m_timemapdirty = tick;
+	}
 }
 
 
@@ -1424,13 +1664,16 @@ double MidiFile::getAbsoluteTickTime(double starttime) {
 //
 
 int MidiFile::linkNotePairs(void) {
-	int i;
-	int sum = 0;
-	for (i=0; i<getTrackCount(); i++) {
-		if (m_events[i] == NULL) {
-			continue;
+	makeTracksUnique();
+	std::vector<int> counts(getTrackCount(), 0);
+	processTracks([this, &counts](int track) {
+		if (m_events[track] != NULL) {
+			counts[track] = m_events[track]->linkNotePairs();
 		}
-		sum += m_events[i]->linkNotePairs();
+	});
+	int sum = 0;
+	for (int i=0; i<(int)counts.size(); i++) {
+		sum += counts[i];
 	}
 	m_linkedEventsQ = true;
 	return sum;
@@ -1486,11 +1729,13 @@ const char* MidiFile::getFilename(void) const {
 
 MidiEvent* MidiFile::addEvent(int aTrack, int aTick,
 		std::vector<uchar>& midiData) {
-	m_timemapvalid = 0;
+	invalidateTimeMap(aTick);
 	MidiEvent* me = new MidiEvent;
 	me->tick = aTick;
 	me->track = aTrack;
 	me->setMessage(midiData);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1503,10 +1748,15 @@ MidiEvent* MidiFile::addEvent(int aTrack, int aTick,
 //
 
 MidiEvent* MidiFile::addEvent(MidiEvent& mfevent) {
+	invalidateTimeMap(mfevent.tick);
 	if (getTrackState() == TRACK_STATE_JOINED) {
+		makeTrackUnique(0);
+		m_storagegeneration++;
 		m_events[0]->push_back(mfevent);
 		return &m_events[0]->back();
 	} else {
+		makeTrackUnique(mfevent.track);
+		m_storagegeneration++;
 		m_events.at(mfevent.track)->push_back(mfevent);
 		return &m_events.at(mfevent.track)->back();
 	}
@@ -1517,11 +1767,16 @@ MidiEvent* MidiFile::addEvent(MidiEvent& mfevent) {
 //
 
 MidiEvent* MidiFile::addEvent(int aTrack, MidiEvent& mfevent) {
+	invalidateTimeMap(mfevent.tick);
 	if (getTrackState() == TRACK_STATE_JOINED) {
+		makeTrackUnique(0);
+		m_storagegeneration++;
 		m_events[0]->push_back(mfevent);
       m_events[0]->back().track = aTrack;
 		return &m_events[0]->back();
 	} else {
+		makeTrackUnique(aTrack);
+		m_storagegeneration++;
 		m_events.at(aTrack)->push_back(mfevent);
 		m_events.at(aTrack)->back().track = aTrack;
 		return &m_events.at(aTrack)->back();
@@ -1537,7 +1792,7 @@ MidiEvent* MidiFile::addEvent(int aTrack, MidiEvent& mfevent) {
 
 MidiEvent* MidiFile::addMetaEvent(int aTrack, int aTick, int aType,
 		std::vector<uchar>& metaData) {
-	m_timemapvalid = 0;
+	invalidateTimeMap(aTick);
 	int i;
 	int length = (int)metaData.size();
 	std::vector<uchar> fulldata;
@@ -1581,6 +1836,9 @@ MidiEvent* MidiFile::addText(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeText(text);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1596,6 +1854,9 @@ MidiEvent* MidiFile::addCopyright(int aTrack, int aTick, const std::string& text
 	MidiEvent* me = new MidiEvent;
 	me->makeCopyright(text);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1611,6 +1872,9 @@ MidiEvent* MidiFile::addTrackName(int aTrack, int aTick, const std::string& name
 	MidiEvent* me = new MidiEvent;
 	me->makeTrackName(name);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1627,6 +1891,9 @@ MidiEvent* MidiFile::addInstrumentName(int aTrack, int aTick,
 	MidiEvent* me = new MidiEvent;
 	me->makeInstrumentName(name);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1642,6 +1909,9 @@ MidiEvent* MidiFile::addLyric(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeLyric(text);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1657,6 +1927,9 @@ MidiEvent* MidiFile::addMarker(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeMarker(text);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1672,6 +1945,9 @@ MidiEvent* MidiFile::addCue(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeCue(text);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1687,6 +1963,9 @@ MidiEvent* MidiFile::addTempo(int aTrack, int aTick, double aTempo) {
 	MidiEvent* me = new MidiEvent;
 	me->makeTempo(aTempo);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1721,6 +2000,9 @@ MidiEvent* MidiFile::addTimeSignature(int aTrack, int aTick, int top, int bottom
 	MidiEvent* me = new MidiEvent;
 	me->makeTimeSignature(top, bottom, clocksPerClick, num32ndsPerQuarter);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1813,6 +2095,9 @@ MidiEvent* MidiFile::addNoteOn(int aTrack, int aTick, int aChannel, int key, int
 	MidiEvent* me = new MidiEvent;
 	me->makeNoteOn(aChannel, key, vel);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1829,6 +2114,9 @@ MidiEvent* MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key,
 	MidiEvent* me = new MidiEvent;
 	me->makeNoteOff(aChannel, key, vel);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1845,6 +2133,9 @@ MidiEvent* MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key) {
 	MidiEvent* me = new MidiEvent;
 	me->makeNoteOff(aChannel, key);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1862,6 +2153,9 @@ MidiEvent* MidiFile::addController(int aTrack, int aTick, int aChannel,
 	MidiEvent* me = new MidiEvent;
 	me->makeController(aChannel, num, value);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1879,6 +2173,9 @@ MidiEvent* MidiFile::addPatchChange(int aTrack, int aTick, int aChannel,
 	MidiEvent* me = new MidiEvent;
 	me->makePatchChange(aChannel, patchnum);
 	me->tick = aTick;
+	invalidateTimeMap(aTick);
+	makeTrackUnique(aTrack);
+	m_storagegeneration++;
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1909,7 +2206,7 @@ MidiEvent* MidiFile::addTimbre(int aTrack, int aTick, int aChannel, int patchnum
 //
 
 MidiEvent* MidiFile::addPitchBend(int aTrack, int aTick, int aChannel, double amount) {
-	m_timemapvalid = 0;
+	invalidateTimeMap(aTick);
 	amount += 1.0;
 	int value = int(amount * 8192 + 0.5);
 
@@ -2046,6 +2343,7 @@ int MidiFile::addTracks(int count) {
 //
 
 void MidiFile::allocateEvents(int track, int aSize) {
+	makeTrackUnique(track);
 	int oldsize = m_events[track]->size();
 	if (oldsize < aSize) {
 		m_events[track]->reserve(aSize);
@@ -2068,7 +2366,9 @@ void MidiFile::deleteTrack(int aTrack) {
 	if (length == 1) {
 		return;
 	}
-	delete m_events[aTrack];
+	invalidateTimeMap();
+	releaseList(m_events[aTrack]);
+	m_storagegeneration++;
 	for (int i=aTrack; i<length-1; i++) {
 		m_events[i] = m_events[i+1];
 	}
@@ -2088,15 +2388,16 @@ void MidiFile::deleteTrack(int aTrack) {
 void MidiFile::clear(void) {
 	int length = getNumTracks();
 	for (int i=0; i<length; i++) {
-		delete m_events[i];
+		releaseList(m_events[i]);
 		m_events[i] = NULL;
 	}
 	m_events.resize(1);
 	m_events[0] = new MidiEventList;
-	m_timemapvalid=0;
-	m_timemap.clear();
+	m_tempomap.clear();
+	invalidateTimeMap();
 	m_theTrackState = TRACK_STATE_SPLIT;
 	m_theTimeState = TIME_STATE_ABSOLUTE;
+	m_storagegeneration++;
 }
 
 
@@ -2113,6 +2414,7 @@ void MidiFile::erase(void) {
 //
 
 MidiEvent& MidiFile::getEvent(int aTrack, int anIndex) {
+	makeTrackUnique(aTrack);
 	return (*m_events[aTrack])[anIndex];
 }
 
@@ -2179,6 +2481,9 @@ int MidiFile::getNumEvents(int aTrack) const {
 //
 
 void MidiFile::mergeTracks(int aTrack1, int aTrack2) {
+	invalidateTimeMap();
+	makeTracksUnique();
+	m_storagegeneration++;
 	MidiEventList* mergedTrack;
 	mergedTrack = new MidiEventList;
 	int oldTimeState = getTickState();
@@ -2224,6 +2529,7 @@ void MidiFile::mergeTracks(int aTrack1, int aTrack2) {
 
 void MidiFile::setTicksPerQuarterNote(int ticks) {
 	m_ticksPerQuarterNote = ticks;
+	invalidateTimeMap();
 }
 
 //
@@ -2252,6 +2558,7 @@ void MidiFile::setTPQ(int ticks) {
 
 void MidiFile::setMillisecondTicks(void) {
 	m_ticksPerQuarterNote = 0xE728;
+	invalidateTimeMap();
 }
 
 
@@ -2267,6 +2574,7 @@ void MidiFile::setMillisecondTicks(void) {
 
 void MidiFile::sortTrack(int track) {
 	if ((track >= 0) && (track < getTrackCount())) {
+		makeTrackUnique(track);
 		m_events.at(track)->sort();
 	} else {
 		std::cerr << "Warning: track " << track << " does not exist." << std::endl;
@@ -2282,9 +2590,10 @@ void MidiFile::sortTrack(int track) {
 
 void MidiFile::sortTracks(void) {
 	if (m_theTimeState == TIME_STATE_ABSOLUTE) {
-		for (int i=0; i<getTrackCount(); i++) {
-			m_events.at(i)->sort();
-		}
+		makeTracksUnique();
+		processTracks([this](int track) {
+			m_events[track]->sort();
+		});
 	} else {
 		std::cerr << "Warning: Sorting only allowed in absolute tick mode.";
 	}
@@ -2305,8 +2614,8 @@ int MidiFile::getTrackCountAsType1(void) {
 		int output = 0;
 		int i;
 		for (i=0; i<(int)m_events[0]->size(); i++) {
-			if (getEvent(0,i).track > output) {
-				output = getEvent(0,i).track;
+			if ((*m_events[0])[i].track > output) {
+				output = (*m_events[0])[i].track;
 			}
 		}
 		return output+1;  // I think the track values are 0 offset...
@@ -2323,239 +2632,109 @@ int MidiFile::getTrackCountAsType1(void) {
 //
 
 void MidiFile::clearLinks(void) {
-	for (int i=0; i<getTrackCount(); i++) {
-		if (m_events[i] == NULL) {
-			continue;
+	makeTracksUnique();
+	processTracks([this](int track) {
+		if (m_events[track] != NULL) {
+			m_events[track]->clearLinks();
 		}
-		m_events[i]->clearLinks();
-	}
+	});
 	m_linkedEventsQ = false;
 }
 
 
 
-///////////////////////////////////////////////////////////////////////////
-//
-// private functions
-//
-
 //////////////////////////////
 //
-// MidiFile::linearTickInterpolationAtSecond -- return the tick value at the
-//    given input time.
+// MidiFile::setThreadCount -- Set the number of threads used by this
+//    MidiFile's functions which process each track separately
+//    (sortTracks(), linkNotePairs(), clearLinks(), removeEmpties(),
+//    markSequence(), makeDeltaTicks() and makeAbsoluteTicks()).  A count
+//    of 1 processes the tracks one at a time, and 0 (the default) uses
+//    one thread per processor core.  The setting belongs to the object,
+//    so it is not copied, moved or swapped with the contents.
 //
 
-double MidiFile::linearTickInterpolationAtSecond(double seconds) {
-	if (m_timemapvalid == 0) {
-		buildTimeMap();
-		if (m_timemapvalid == 0) {
-			return -1.0;    // something went wrong
-		}
-	}
-
-	int i;
-	double lasttime = m_timemap[m_timemap.size()-1].seconds;
-	// give an error value of -1 if time is out of range of data.
-	if (seconds < 0.0) {
-		return -1.0;
-	}
-	if (seconds > m_timemap[m_timemap.size()-1].seconds) {
-		return -1.0;
-	}
-
-	// Guess which side of the list is closest to target:
-	// Could do a more efficient algorithm since time values are sorted,
-	// but good enough for now...
-	int startindex = -1;
-	if (seconds < lasttime / 2) {
-		for (i=0; i<(int)m_timemap.size(); i++) {
-			if (m_timemap[i].seconds > seconds) {
-				startindex = i-1;
-				break;
-			} else if (m_timemap[i].seconds == seconds) {
-				startindex = i;
-				break;
-			}
-		}
-	} else {
-		for (i=(int)m_timemap.size()-1; i>0; i--) {
-			if (m_timemap[i].seconds < seconds) {
-				startindex = i+1;
-				break;
-			} else if (m_timemap[i].seconds == seconds) {
-				startindex = i;
-				break;
-			}
-		}
-	}
-
-	if (startindex < 0) {
-		return -1.0;
-	}
-	if (startindex >= (int)m_timemap.size()-1) {
-		return -1.0;
-	}
-
-	double x1 = m_timemap[startindex].seconds;
-	double x2 = m_timemap[startindex+1].seconds;
-	double y1 = m_timemap[startindex].tick;
-	double y2 = m_timemap[startindex+1].tick;
-	double xi = seconds;
-
-	return (xi-x1) * ((y2-y1)/(x2-x1)) + y1;
+void MidiFile::setThreadCount(int count) {
+	m_threadcount = count < 0 ? 0 : count;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::linearSecondInterpolationAtTick -- return the time in seconds
-//    value at the given input tick time. (Ticks input could be made double).
+// MidiFile::getThreadCount -- Return the number of threads used to
+//    process tracks (0 for one per processor core).
 //
 
-double MidiFile::linearSecondInterpolationAtTick(int ticktime) {
-	if (m_timemapvalid == 0) {
-		buildTimeMap();
-		if (m_timemapvalid == 0) {
-			return -1.0;    // something went wrong
-		}
-	}
-
-	int i;
-	double lasttick = m_timemap[m_timemap.size()-1].tick;
-	// give an error value of -1 if time is out of range of data.
-	if (ticktime < 0.0) {
-		return -1;
-	}
-	if (ticktime > m_timemap.back().tick) {
-		return -1;  // don't try to extrapolate
-	}
-
-	// Guess which side of the list is closest to target:
-	// Could do a more efficient algorithm since time values are sorted,
-	// but good enough for now...
-	int startindex = -1;
-	if (ticktime < lasttick / 2) {
-		for (i=0; i<(int)m_timemap.size(); i++) {
-			if (m_timemap[i].tick > ticktime) {
-				startindex = i-1;
-				break;
-			} else if (m_timemap[i].tick == ticktime) {
-				startindex = i;
-				break;
-			}
-		}
-	} else {
-		for (i=(int)m_timemap.size()-1; i>0; i--) {
-			if (m_timemap[i].tick < ticktime) {
-				startindex = i;
-				break;
-			} else if (m_timemap[i].tick == ticktime) {
-				startindex = i;
-				break;
-			}
-		}
-	}
+int MidiFile::getThreadCount(void) const {
+	return m_threadcount;
+}
 
-	if (startindex < 0) {
-		return -1;
-	}
-	if (startindex >= (int)m_timemap.size()-1) {
-		return -1;
-	}
 
-	if (m_timemap[startindex].tick == ticktime) {
-		return m_timemap[startindex].seconds;
-	}
 
-	double x1 = m_timemap[startindex].tick;
-	double x2 = m_timemap[startindex+1].tick;
-	double y1 = m_timemap[startindex].seconds;
-	double y2 = m_timemap[startindex+1].seconds;
-	double xi = ticktime;
+//////////////////////////////
+//
+// MidiFile::setParallelThreshold -- Set the smallest total number of
+//    events for which tracks are processed in parallel.  Smaller files
+//    are processed one track at a time, since handing the tracks to
+//    other threads would take longer than the work itself.
+//
+//    default value: PARALLEL_TRACK_EVENTS
+//
 
-	return (xi-x1) * ((y2-y1)/(x2-x1)) + y1;
+void MidiFile::setParallelThreshold(int events) {
+	parallelThreshold = events < 0 ? 0 : events;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::buildTimeMap -- build an index of the absolute tick values
-//      found in a MIDI file, and their corresponding time values in
-//      seconds, taking into consideration tempo change messages.  If no
-//      tempo messages are given (or untill they are given, then the
-//      tempo is set to 120 beats per minute).  If SMPTE time code is
-//      used, then ticks are actually time values.  So don't build
-//      a time map for SMPTE ticks, and just calculate the time in
-//      seconds from the tick value (1000 ticks per second SMPTE
-//      is the only mode tested (25 frames per second and 40 subframes
-//      per frame).
+// MidiFile::getParallelThreshold -- Return the smallest total number
+//    of events for which tracks are processed in parallel.
 //
 
-void MidiFile::buildTimeMap(void) {
-
-	// convert the MIDI file to absolute time representation
-	// in single track mode (and undo if the MIDI file was not
-	// in that state when this function was called.
-	//
-	int trackstate = getTrackState();
-	int timestate  = getTickState();
+int MidiFile::getParallelThreshold(void) {
+	return parallelThreshold;
+}
 
-	makeAbsoluteTicks();
-	joinTracks();
 
-	int allocsize = getNumEvents(0);
-	m_timemap.reserve(allocsize+10);
-	m_timemap.clear();
 
-	_TickTime value;
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
 
-	int lasttick = 0;
-	int tickinit = 0;
+//////////////////////////////
+//
+// MidiFile::buildTimeMap -- update the tempo map of the file and store
+//      the time in seconds of all events in MidiEvent::seconds.  The
+//      tracks are not joined for this, since the tempo map already
+//      holds the tempo changes of all tracks.  If no tempo messages are
+//      given (or untill they are given, then the tempo is set to 120 beats
+//      per minute).  If SMPTE time code is used, then ticks are actually
+//      time values.  1000 ticks per second SMPTE is the only mode tested
+//      (25 frames per second and 40 subframes per frame).
+//
 
-	int i;
-	int tpq = getTicksPerQuarterNote();
-	double defaultTempo = 120.0;
-	double secondsPerTick = 60.0 / (defaultTempo * tpq);
-
-	double lastsec = 0.0;
-	double cursec = 0.0;
-
-	for (i=0; i<getNumEvents(0); i++) {
-		int curtick = getEvent(0, i).tick;
-		getEvent(0, i).seconds = cursec;
-		if ((curtick > lasttick) || !tickinit) {
-			tickinit = 1;
-
-			// calculate the current time in seconds:
-			cursec = lastsec + (curtick - lasttick) * secondsPerTick;
-			getEvent(0, i).seconds = cursec;
-
-			// store the new tick to second mapping
-			value.tick = curtick;
-			value.seconds = cursec;
-			m_timemap.push_back(value);
-			lasttick   = curtick;
-			lastsec    = cursec;
-		}
+void MidiFile::buildTimeMap(void) {
+	const TempoMap& tempomap = getTempoMap();
 
-		// update the tempo if needed:
-		if (getEvent(0,i).isTempo()) {
-			secondsPerTick = getEvent(0,i).getTempoSPT(getTicksPerQuarterNote());
-		}
+	bool revertToDelta = false;
+	if (isDeltaTicks()) {
+		makeAbsoluteTicks();
+		revertToDelta = true;
 	}
-
-	// reset the states of the tracks or time values if necessary here:
-	if (timestate == TIME_STATE_DELTA) {
-		deltaTicks();
+	for (int i=0; i<getTrackCount(); i++) {
+		makeTrackUnique(i);
+		MidiEventList& track = *m_events[i];
+		for (int j=0; j<track.getEventCount(); j++) {
+			track[j].seconds = tempomap.getTimeInSeconds(track[j].tick);
+		}
 	}
-	if (trackstate == TRACK_STATE_SPLIT) {
-		splitTracks();
+	if (revertToDelta) {
+		makeDeltaTicks();
 	}
-
-	m_timemapvalid = 1;
-
 }
 
 
@@ -2839,8 +3018,9 @@ void MidiFile::clear_no_deallocate(void) {
 	}
 	m_events.resize(1);
 	m_events[0] = new MidiEventList;
-	m_timemapvalid=0;
-	m_timemap.clear();
+	m_tempomap.clear();
+	invalidateTimeMap();
+	m_storagegeneration++;
 	// m_events.resize(0);   // causes a memory leak [20150205 Jorden Thatcher]
 }
 
@@ -2848,41 +3028,59 @@ void MidiFile::clear_no_deallocate(void) {
 
 //////////////////////////////
 //
-// MidiFile::ticksearch -- for finding a tick entry in the time map.
+// MidiFile::processTracks -- Call a function for each track index.  If
+//    the file is large enough and more than one thread is allowed,
+//    the tracks are shared out between the threads of the track pool,
+//    otherwise they are processed in order.  The function must only access its own track,
+//    and the tracks must already be unique (see makeTracksUnique()).
 //
 
-int MidiFile::ticksearch(const void* A, const void* B) {
-	_TickTime& a = *((_TickTime*)A);
-	_TickTime& b = *((_TickTime*)B);
-
-	if (a.tick < b.tick) {
-		return -1;
-	} else if (a.tick > b.tick) {
-		return 1;
+void MidiFile::processTracks(const std::function<void(int)>& function) {
+	int trackcount = (int)m_events.size();
+	int threads = m_threadcount;
+	if (threads == 0) {
+		threads = (int)std::thread::hardware_concurrency();
 	}
-	return 0;
+	if (threads > trackcount) {
+		threads = trackcount;
+	}
+	int events = 0;
+	if (threads > 1) {
+		for (int i=0; i<trackcount; i++) {
+			events += m_events[i]->getEventCount();
+		}
+	}
+	if ((threads <= 1) || (events < parallelThreshold)) {
+		for (int i=0; i<trackcount; i++) {
+			function(i);
+		}
+		return;
+	}
+
+	// Tracks can be very different in size, so each thread takes the
+	// next unprocessed track when it finishes its current one:
+	TrackPool::get().run(trackcount, threads, function);
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::secondsearch -- for finding a second entry in the time map.
+// MidiFile::releaseList -- Give up ownership of a track list, deleting
+//   it if no other MidiFile is sharing it.
 //
 
-int MidiFile::secondsearch(const void* A, const void* B) {
-	_TickTime& a = *((_TickTime*)A);
-	_TickTime& b = *((_TickTime*)B);
-
-	if (a.seconds < b.seconds) {
-		return -1;
-	} else if (a.seconds > b.seconds) {
-		return 1;
+void MidiFile::releaseList(MidiEventList* list) {
+	if (list == NULL) {
+		return;
+	}
+	if (list->m_refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete list;
 	}
-	return 0;
 }
 
 
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // Static functions:
@@ -31,13 +31,14 @@ MidiMessage::MidiMessage(void) : vector<uchar>() {
 
 
 MidiMessage::MidiMessage(int command) : vector<uchar>(1, (uchar)command) {
-	// do nothing
+	updateEventKind();
 }
 
 
 MidiMessage::MidiMessage(int command, int p1) : vector<uchar>(2) {
 	(*this)[0] = (uchar)command;
 	(*this)[1] = (uchar)p1;
+	updateEventKind();
 }
 
 
@@ -45,6 +46,7 @@ MidiMessage::MidiMessage(int command, int p1, int p2) : vector<uchar>(3) {
 	(*this)[0] = (uchar)command;
 	(*this)[1] = (uchar)p1;
 	(*this)[2] = (uchar)p2;
+	updateEventKind();
 }
 
 
@@ -89,7 +91,8 @@ MidiMessage& MidiMessage::operator=(const MidiMessage& message) {
 	if (this == &message) {
 		return *this;
 	}
-	(*this) = message;
+	std::vector<uchar>::operator=(message);
+	m_kind = message.m_kind;
 	return *this;
 }
 
@@ -125,6 +128,7 @@ MidiMessage& MidiMessage::operator=(const std::vector<int>& bytes) {
 
 void MidiMessage::setSize(int asize) {
 	this->resize(asize);
+	updateEventKind();
 }
 
 
@@ -177,6 +181,7 @@ int MidiMessage::setSizeToCommand(void) {
 			(*this)[i] = 0;
 		}
 	}
+	updateEventKind();
 
 	return (int)size();
 }
@@ -935,6 +940,7 @@ void MidiMessage::setP0(int value) {
 		resize(1);
 	}
 	(*this)[0] = value;
+	updateEventKind();
 }
 
 
@@ -953,6 +959,7 @@ void MidiMessage::setP1(int value) {
 		resize(2);
 	}
 	(*this)[1] = value;
+	updateEventKind();
 }
 
 
@@ -972,6 +979,7 @@ void MidiMessage::setP2(int value) {
 		resize(3);
 	}
 	(*this)[2] = value;
+	updateEventKind();
 }
 
 
@@ -991,6 +999,7 @@ void MidiMessage::setP3(int value) {
 		resize(4);
 	}
 	(*this)[3] = value;
+	updateEventKind();
 }
 
 
@@ -1095,6 +1104,7 @@ void MidiMessage::setCommandByte(int value) {
 	} else {
 		(*this)[0] = (uchar)(value & 0xff);
 	}
+	updateEventKind();
 }
 
 void MidiMessage::setCommand(int value) {
@@ -1114,6 +1124,7 @@ void MidiMessage::setCommand(int value, int p1) {
 	this->resize(2);
 	(*this)[0] = (uchar)value;
 	(*this)[1] = (uchar)p1;
+	updateEventKind();
 }
 
 
@@ -1122,6 +1133,7 @@ void MidiMessage::setCommand(int value, int p1, int p2) {
 	(*this)[0] = (uchar)value;
 	(*this)[1] = (uchar)p1;
 	(*this)[2] = (uchar)p2;
+	updateEventKind();
 }
 
 
@@ -1140,6 +1152,7 @@ void MidiMessage::setCommandNibble(int value) {
 	} else {
 		(*this)[0] = ((*this)[0] & 0x0f) | ((uchar)(value & 0xf0));
 	}
+	updateEventKind();
 }
 
 
@@ -1178,6 +1191,7 @@ void MidiMessage::setParameters(int p1) {
 	if (oldsize < 1) {
 		(*this)[0] = 0;
 	}
+	updateEventKind();
 }
 
 
@@ -1189,6 +1203,7 @@ void MidiMessage::setParameters(int p1, int p2) {
 	if (oldsize < 1) {
 		(*this)[0] = 0;
 	}
+	updateEventKind();
 }
 
 
@@ -1203,6 +1218,7 @@ void MidiMessage::setMessage(const std::vector<uchar>& message) {
 	for (int i=0; i<(int)this->size(); i++) {
 		(*this)[i] = message[i];
 	}
+	updateEventKind();
 }
 
 
@@ -1211,6 +1227,7 @@ void MidiMessage::setMessage(const std::vector<char>& message) {
 	for (int i=0; i<(int)size(); i++) {
 		(*this)[i] = (uchar)message[i];
 	}
+	updateEventKind();
 }
 
 
@@ -1219,6 +1236,7 @@ void MidiMessage::setMessage(const std::vector<int>& message) {
 	for (int i=0; i<(int)size(); i++) {
 		(*this)[i] = (uchar)message[i];
 	}
+	updateEventKind();
 }
 
 
@@ -1571,6 +1589,7 @@ void MidiMessage::setMetaContent(const std::string& content) {
 		push_back(byte1);
 	}
 	std::copy(content.begin(), content.end(), std::back_inserter(*this));
+	updateEventKind();
 }
 
 
@@ -1613,6 +1632,7 @@ void MidiMessage::setTempoMicroseconds(int microseconds) {
 	(*this)[3] = (microseconds >> 16) & 0xff;
 	(*this)[4] = (microseconds >>  8) & 0xff;
 	(*this)[5] = (microseconds >>  0) & 0xff;
+	updateEventKind();
 }
 
 
@@ -1653,6 +1673,7 @@ void MidiMessage::makeTimeSignature(int top, int bottom, int clocksPerClick,
 	(*this)[4] = 0xff & base2;
 	(*this)[5] = 0xff & clocksPerClick;
 	(*this)[6] = 0xff & num32ndsPerQuarter;
+	updateEventKind();
 }
 
 
@@ -1678,6 +1699,7 @@ void MidiMessage::makeNoteOn(int channel, int key, int velocity) {
 	(*this)[0] = 0x90 | (0x0f & channel);
 	(*this)[1] = key & 0x7f;
 	(*this)[2] = velocity & 0x7f;
+	updateEventKind();
 }
 
 
@@ -1700,6 +1722,7 @@ void MidiMessage::makeNoteOff(int channel, int key, int velocity) {
 	(*this)[0] = 0x80 | (0x0f & channel);
 	(*this)[1] = key & 0x7f;
 	(*this)[2] = velocity & 0x7f;
+	updateEventKind();
 }
 
 
@@ -1708,6 +1731,7 @@ void MidiMessage::makeNoteOff(int channel, int key) {
 	(*this)[0] = 0x90 | (0x0f & channel);
 	(*this)[1] = key & 0x7f;
 	(*this)[2] = 0x00;
+	updateEventKind();
 }
 
 //
@@ -1724,6 +1748,7 @@ void MidiMessage::makeNoteOff(void) {
 	} else {
 		(*this)[2] = 0;
 	}
+	updateEventKind();
 }
 
 
@@ -1737,6 +1762,7 @@ void MidiMessage::makePatchChange(int channel, int patchnum) {
 	resize(0);
 	push_back(0xc0 | (0x0f & channel));
 	push_back(0x7f & patchnum);
+	updateEventKind();
 }
 
 //
@@ -1758,6 +1784,7 @@ void MidiMessage::makeController(int channel, int num, int value) {
 	push_back(0xb0 | (0x0f & channel));
 	push_back(0x7f & num);
 	push_back(0x7f & value);
+	updateEventKind();
 }
 
 
@@ -1928,6 +1955,67 @@ void MidiMessage::makeCue(const std::string& text) {
 }
 
 
+
+//////////////////////////////
+//
+// MidiMessage::clear -- Remove all bytes from the message, making it
+//    empty (see MidiFile::removeEmpties()).
+//
+
+void MidiMessage::clear(void) {
+	std::vector<uchar>::clear();
+	m_kind = EVENT_KIND_EMPTY;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::getEventKind -- Return the kind of message, as one of the
+//    EVENT_KIND_* values.  The kind is stored whenever the bytes are set
+//    by a MidiMessage function, so call updateEventKind() after changing
+//    the bytes directly through the std::vector interface.
+//
+
+int MidiMessage::getEventKind(void) const {
+	return m_kind;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::updateEventKind -- Store the kind of message from its
+//    current bytes.
+//
+
+void MidiMessage::updateEventKind(void) {
+	if (empty()) {
+		m_kind = EVENT_KIND_EMPTY;
+	} else if (isNoteOn()) {
+		m_kind = EVENT_KIND_NOTEON;
+	} else if (isNoteOff()) {
+		m_kind = EVENT_KIND_NOTEOFF;
+	} else if (isController()) {
+		m_kind = EVENT_KIND_CONTROLLER;
+	} else if (isPatchChange()) {
+		m_kind = EVENT_KIND_PATCH;
+	} else if (isPitchbend()) {
+		m_kind = EVENT_KIND_PITCHBEND;
+	} else if (isTempo()) {
+		m_kind = EVENT_KIND_TEMPO;
+	} else if (isText()) {
+		m_kind = EVENT_KIND_TEXT;
+	} else if (isMetaMessage()) {
+		m_kind = EVENT_KIND_META;
+	} else if (((*this)[0] == 0xf0) || ((*this)[0] == 0xf7)) {
+		m_kind = EVENT_KIND_SYSEX;
+	} else {
+		m_kind = EVENT_KIND_OTHER;
+	}
+}
+
+
 } // end namespace smf
 
 
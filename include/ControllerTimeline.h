@@ -0,0 +1,68 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:07:57 PDT 2026
+// Last Modified: Sun Oct 18 16:12:24 PDT 2026
+// Filename:      midiroll/include/ControllerTimeline.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   On/off intervals of controllers (such as the sustain
+//                and soft pedals) for each MIDI channel.
+//
+
+#ifndef _CONTROLLERTIMELINE_H_INCLUDED
+#define _CONTROLLERTIMELINE_H_INCLUDED
+
+#include "MidiFile.h"
+
+#include <vector>
+
+namespace smf {
+
+class ControllerInterval {
+	public:
+		int        starttick;     // absolute tick of the on message
+		int        endtick;       // absolute tick of the off message
+		double     startseconds;  // time in seconds of the on message
+		double     endseconds;    // time in seconds of the off message
+		MidiEvent* on;
+		MidiEvent* off;           // NULL if never turned off
+};
+
+
+class ControllerTimeline {
+	public:
+		                  ControllerTimeline (void);
+		                 ~ControllerTimeline ();
+
+		void              build             (MidiFile& midifile);
+		void              clear             (void);
+		void              swap              (ControllerTimeline& other) noexcept;
+
+		bool              isOn              (int channel, int controller,
+		                                     int tick) const;
+		bool              isOnAtSeconds     (int channel, int controller,
+		                                     double seconds) const;
+		bool              isSustainOn       (int channel, int tick) const;
+		bool              isSoftOn          (int channel, int tick) const;
+
+		const ControllerInterval* getInterval (int channel, int controller,
+		                                     int tick) const;
+		const ControllerInterval* getIntervalAtSeconds (int channel,
+		                                     int controller,
+		                                     double seconds) const;
+		const std::vector<ControllerInterval>& getIntervals (int channel,
+		                                     int controller) const;
+
+	private:
+		// m_intervals == on/off intervals in time order for each channel
+		// and controller number (indexed by channel * 128 + controller).
+		std::vector<std::vector<ControllerInterval>> m_intervals;
+};
+
+} // end smf namespace
+
+#endif /* _CONTROLLERTIMELINE_H_INCLUDED */
+
+
+
@@ -0,0 +1,78 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:48:18 PDT 2026
+// Last Modified: Sun Oct 18 16:48:18 PDT 2026
+// Filename:      midiroll/include/FrozenRoll.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   An immutable, fully analyzed copy of a MIDI roll which
+//                can be queried from several threads at the same time.
+//
+
+#ifndef _FROZENROLL_H_INCLUDED
+#define _FROZENROLL_H_INCLUDED
+
+#include "MidiRoll.h"
+#include "RollTimeView.h"
+
+#include <vector>
+
+namespace smf {
+
+class FrozenRoll {
+	public:
+		                    FrozenRoll       (const MidiRoll& roll);
+		                    FrozenRoll       (const FrozenRoll& other) = delete;
+		                   ~FrozenRoll       ();
+
+		FrozenRoll&         operator=        (const FrozenRoll& other) = delete;
+
+		int                 getTrackCount    (void) const;
+		int                 getEventCount    (int track) const;
+		const MidiEventList& getTrack        (int track) const;
+		const MidiEventList& operator[]      (int track) const;
+		const MidiEvent&    getEvent         (int track, int index) const;
+		const std::vector<MidiEvent*>& getEventsOfKind (int track,
+		                                      int kind) const;
+
+		int                 getTicksPerQuarterNote (void) const;
+		double              getTimeInSeconds (double tick) const;
+		double              getAbsoluteTickTime (double seconds) const;
+		int                 getFileDurationInTicks (void) const;
+		double              getFileDurationInSeconds (void) const;
+		const RollTimeView& getTimeView      (void) const;
+
+		const NoteIndex&    getNoteIndex     (void) const;
+		const ControllerTimeline& getControllerTimeline (void) const;
+
+		double              getLengthDpi     (void) const;
+		double              getWidthDpi      (void) const;
+		bool                hasAccelerationModel (void) const;
+		double              getAccelerationInches (void) const;
+		double              getAccelerationPercent (void) const;
+
+	private:
+		// m_roll == private copy of the roll in absolute ticks with
+		// linked notes, event times and event kind lists.  It is not
+		// modified after the constructor.
+		MidiRoll m_roll;
+
+		// m_times == timing of m_roll, calculated in the constructor so
+		// that its queries no longer write to its cached state.
+		RollTimeView m_times;
+
+		// Analysis indexes owned by m_roll:
+		const NoteIndex*          m_noteindex   = NULL;
+		const ControllerTimeline* m_controllers = NULL;
+
+		// m_durationticks == largest tick in any track.
+		int m_durationticks = 0;
+};
+
+} // end smf namespace
+
+#endif /* _FROZENROLL_H_INCLUDED */
+
+
+
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Fri Apr 13 06:56:36 PDT 2018
-// Last Modified: Mon Apr 23 10:51:16 PDT 2018
+// Last Modified: Sun Oct 18 19:32:57 PDT 2026
 // Filename:      midiroll/include/MidiRoll.h
 // Syntax:        C++11
 // vim:           ts=3 expandtab
@@ -13,11 +13,19 @@
 #define _MIDIROLL_H_INCLUDED
 
 #include "MidiFile.h"
+#include "NoteIndex.h"
+#include "ControllerTimeline.h"
 
 #include <string>
 #include <vector>
+#include <utility>
+#include <unordered_map>
 #include <iostream>
 
+// Metadata keys for the parameters of the acceleration model:
+#define ACCELERATION_STEP_KEY     "ACCELERATION_STEP"
+#define ACCELERATION_PERCENT_KEY  "ACCELERATION_PERCENT"
+
 namespace smf {
 
 class MidiRoll : public MidiFile {
@@ -27,11 +35,30 @@ class MidiRoll : public MidiFile {
 		                       MidiRoll   (const std::string& aFile);
 		                       MidiRoll   (std::istream& input);
 		                       MidiRoll   (const MidiRoll& other);
-		                       MidiRoll   (MidiRoll&& other);
+		                       MidiRoll   (MidiRoll&& other) noexcept;
 		                      ~MidiRoll   ();
 
 		MidiRoll&               operator=  (const MidiRoll& other);
 		MidiRoll&               operator=  (const MidiFile& other);
+		MidiRoll&               operator=  (MidiRoll&& other) noexcept;
+		void                    swap       (MidiRoll& other) noexcept;
+
+		MidiRoll                fork               (void) const;
+
+		bool                    read               (const std::string& filename);
+		bool                    read               (std::istream& instream);
+
+		// writing functions (which add the acceleration tempo steps):
+		bool                    write              (const std::string& filename);
+		bool                    write              (std::ostream& out);
+		bool                    writeHex           (const std::string& filename,
+		                                            int width = 25);
+		bool                    writeHex           (std::ostream& out,
+		                                            int width = 25);
+		bool                    writeBinasc        (const std::string& filename);
+		bool                    writeBinasc        (std::ostream& out);
+		bool                    writeBinascWithComments (const std::string& filename);
+		bool                    writeBinascWithComments (std::ostream& out);
 
 		void                    setRollTempo       (double tempo,
 		                                            double dpi = 300.0);
@@ -42,33 +69,137 @@ class MidiRoll : public MidiFile {
 		std::string             getMetadata        (const std::string& key);
 		int                     setMetadata        (const std::string& key,
 		                                            const std::string& value);
+		int                     deleteMetadata     (const std::string& key);
 
 		// tracker bar emulation:
 		void                    trackerize         (int trakerheight);
 
+		// pedal emulation:
+		void                    applyPedal         (int controller = 64);
+
+		// register and expression transforms:
+		void                    shiftHoles         (int transpose,
+		                                            bool green = false);
+		bool                    setRegisterBreak   (double breakpoint,
+		                                            int trebletrack = 2,
+		                                            int basstrack = 1);
+		void                    setInstrument      (int instrument);
+		void                    getAttackVelocityRange (int& minimum,
+		                                            int& maximum);
+		void                    rescaleAttackVelocities (double oldmin,
+		                                            double oldmax,
+		                                            double newmin,
+		                                            double newmax);
+
 		// acceleration emulation:
 		void                    removeAcceleration (void);
 		void                    applyAcceleration  (double inches,
 		                                            double percent);
-      // tick conversions:
+		void                    setAccelerationModel (double inches,
+		                                            double percent);
+		void                    clearAccelerationModel (void);
+		bool                    hasAccelerationModel (void) const;
+		double                  getAccelerationInches (void) const;
+		double                  getAccelerationPercent (void) const;
+		void                    materializeAcceleration (void);
+		void                    getAccelerationTempos (std::vector<std::pair<int, int>>& tempos) const;
+		const TempoMap&         getRollTempoMap    (void);
+		double                  getRollTimeInSeconds (double tick);
+		double                  getRollTickTime    (double seconds);
+		double                  simplifyTempos     (double tolerance);
+
+		// tick conversions:
 		void                    convertToMillisecondTicks (void);
+		void                    convertToRateTicks (double rate);
 
 		// variable accessor functions:
-		double                  getLengthDpi       (void);
+		double                  getLengthDpi       (void) const;
 		void                    setLengthDpi       (double value);
-		double                  getWidthDpi        (void);
+		double                  getWidthDpi        (void) const;
 		void                    setWidthDpi        (double value);
 		std::string             getMetadataMarker  (void);
 		void                    setMetadataMarker  (const std::string& value);
 
+		// analysis indexes:
+		const NoteIndex&        getNoteIndex       (void);
+		const ControllerTimeline& getControllerTimeline (void);
+		void                    invalidateIndexes  (void);
+
 	private:
+		class _MetadataEntry {
+			public:
+				MidiEvent* event;   // text event containing the key/value pair
+				int        start;   // start of the value in the event text
+				int        length;  // length of the value (trimmed)
+		};
+
 		double m_lengthdpi           = 300.0;
 		double m_widthdpi            = 300.0;
 		std::string m_metadatamarker = "@";
+
+		// m_accelinches, m_accelpercent == continuous acceleration model:
+		// the roll speeds up by m_accelpercent percent every m_accelinches
+		// of roll.  The model is inactive if either value is zero.
+		double m_accelinches         = 0.0;
+		double m_accelpercent        = 0.0;
+
+		// m_acceldirty == true if the acceleration model was set by
+		// setAccelerationModel() and its tempo steps have not yet been
+		// added to the first track.
+		bool m_acceldirty            = false;
+
+		// m_accelmap == tempo map of the tempo steps of the acceleration
+		// model, built by getRollTempoMap() from the model parameters,
+		// length DPI and last tick stored with it.
+		TempoMap m_accelmap;
+		double m_accelmapinches      = 0.0;
+		double m_accelmappercent     = 0.0;
+		double m_accelmapdpi         = 0.0;
+		int    m_accelmaptick        = -1;
+
+		// m_noteindex == interval index of linked notes, built on demand
+		// by getNoteIndex().
+		NoteIndex m_noteindex;
+		bool m_noteindexvalid        = false;
+
+		// m_controllers == controller on/off intervals, built on demand
+		// by getControllerTimeline().
+		ControllerTimeline m_controllers;
+		bool m_controllersvalid      = false;
+
+		// m_metadata == metadata key/value pairs in the first track, built
+		// on demand.  Each key lists its events in track order.
+		std::unordered_map<std::string, std::vector<_MetadataEntry>> m_metadata;
+		bool m_metadatavalid         = false;
+
+		// m_indexgeneration == storage generation of the MidiFile when
+		// the indexes were last checked.
+		int m_indexgeneration        = 0;
+
+		void                    buildMetadataIndex (void);
+		void                    loadAccelerationModel (void);
+		int                     getLastTick        (void) const;
+		void                    removeTempoSteps   (void);
+		void                    applyRegisterSplits (int bass, int treble,
+		                                            int trebleexp);
+		int                     trackerizeTrack    (MidiEventList& track,
+		                                            int trackerheight);
+		void                    insertInOrder      (std::vector<MidiEvent*>& list,
+		                                            MidiEvent* event);
+		void                    checkIndexes       (void);
+		void                    copyRollSettings   (const MidiRoll& other);
+		void                    swapRollData       (MidiRoll& other) noexcept;
+		bool                    parseMetadata      (MidiEvent* event,
+		                                            std::string& key,
+		                                            _MetadataEntry& entry);
+	// RollSegmenter copies the roll settings into the segments of a roll.
+	friend class RollSegmenter;
 };
 
 } // end smf namespace
 
+std::ostream& operator<<(std::ostream& out, smf::MidiRoll& aRoll);
+
 #endif /* _MIDIROLL_H_INCLUDED */
 
 
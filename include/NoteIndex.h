@@ -0,0 +1,99 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:04:34 PDT 2026
+// Last Modified: Sun Oct 18 16:12:24 PDT 2026
+// Filename:      midiroll/include/NoteIndex.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   An interval index of the linked notes in a MIDI roll,
+//                used to find which holes are open at a given tick or
+//                within a range of ticks.
+//
+
+#ifndef _NOTEINDEX_H_INCLUDED
+#define _NOTEINDEX_H_INCLUDED
+
+#include "MidiFile.h"
+
+#include <vector>
+
+namespace smf {
+
+class NoteInterval {
+	public:
+		int        starttick;  // absolute tick of the note-on
+		int        endtick;    // absolute tick of the note-off
+		int        key;        // MIDI key number of the note
+		int        channel;    // MIDI channel of the note
+		int        track;      // [original] track of the note
+		MidiEvent* noteon;
+		MidiEvent* noteoff;
+};
+
+
+class NoteIndex {
+	public:
+		                    NoteIndex        (void);
+		                   ~NoteIndex        ();
+
+		void                build            (MidiFile& midifile);
+		void                clear            (void);
+		void                swap             (NoteIndex& other) noexcept;
+		int                 getNoteCount     (void) const;
+		const NoteInterval& getNote          (int index) const;
+
+		// queries for all keys:
+		int                 getSoundingNotes (std::vector<const NoteInterval*>& output,
+		                                      int tick) const;
+		int                 getNotesInRange  (std::vector<const NoteInterval*>& output,
+		                                      int starttick, int endtick) const;
+
+		// queries for a single key:
+		int                 getSoundingNotes (std::vector<const NoteInterval*>& output,
+		                                      int key, int tick) const;
+		int                 getNotesInRange  (std::vector<const NoteInterval*>& output,
+		                                      int key, int starttick,
+		                                      int endtick) const;
+
+	private:
+		class _IntervalNode {
+			public:
+				int center;  // tick which all intervals in node contain
+				int left;    // node index of intervals before center
+				int right;   // node index of intervals after center
+				int begin;   // start of node's intervals in m_bystart/m_byend
+				int count;   // number of intervals stored in node
+		};
+
+		// m_notes == all notes sorted by starting tick.
+		std::vector<NoteInterval> m_notes;
+
+		// m_keynotes == indexes into m_notes for each key, in start order.
+		std::vector<std::vector<int>> m_keynotes;
+
+		// m_keymaxend == running maximum of the last tick of the notes
+		// in m_keynotes, used for binary searching overlaps on a key.
+		std::vector<std::vector<int>> m_keymaxend;
+
+		// centered interval tree over all keys:
+		std::vector<_IntervalNode> m_nodes;
+		std::vector<int>           m_bystart;  // ascending first tick
+		std::vector<int>           m_byend;    // descending last tick
+		int                        m_root = -1;
+
+		int        getFirstTick    (int index) const;
+		int        getLastTick     (int index) const;
+		int        buildNode       (std::vector<int>& items);
+		void       searchNode      (std::vector<const NoteInterval*>& output,
+		                            int node, int first, int last) const;
+		void       searchKey       (std::vector<const NoteInterval*>& output,
+		                            int key, int first, int last) const;
+};
+
+} // end smf namespace
+
+#endif /* _NOTEINDEX_H_INCLUDED */
+
+
+
@@ -0,0 +1,129 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:11:07 PDT 2026
+// Last Modified: Sun Oct 18 17:11:07 PDT 2026
+// Filename:      midiroll/include/RollAccumulator.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Statistics which are collected separately for groups of
+//                files and then merged into a single result.
+//
+
+#ifndef _ROLLACCUMULATOR_H_INCLUDED
+#define _ROLLACCUMULATOR_H_INCLUDED
+
+#include <map>
+#include <vector>
+
+namespace smf {
+
+class RollAccumulator {
+	public:
+		virtual                 ~RollAccumulator  () { }
+
+		virtual RollAccumulator* makeEmpty       (void) const = 0;
+		virtual void             merge           (const RollAccumulator& other) = 0;
+		virtual void             clear           (void) = 0;
+};
+
+
+class RollHistogram : public RollAccumulator {
+	public:
+		                    RollHistogram    (int minimum = 0, int maximum = 127);
+
+		RollAccumulator*    makeEmpty        (void) const;
+		void                merge            (const RollAccumulator& other);
+		void                clear            (void);
+
+		void                add              (int value, long long count = 1);
+		long long           getCount         (int value) const;
+		int                 getMinimum       (void) const;
+		int                 getMaximum       (void) const;
+		long long           getTotal         (void) const;
+		long long           getUnderflow     (void) const;
+		long long           getOverflow      (void) const;
+
+	private:
+		int m_minimum;
+		std::vector<long long> m_bins;   // counts for m_minimum to maximum
+		long long m_underflow = 0;       // count of values below the minimum
+		long long m_overflow  = 0;       // count of values above the maximum
+};
+
+
+class RollCounts : public RollAccumulator {
+	public:
+		                    RollCounts       (int size = 1);
+
+		RollAccumulator*    makeEmpty        (void) const;
+		void                merge            (const RollAccumulator& other);
+		void                clear            (void);
+
+		void                add              (int index = 0, long long count = 1);
+		long long           getCount         (int index = 0) const;
+		int                 getSize          (void) const;
+		long long           getTotal         (void) const;
+
+	private:
+		std::vector<long long> m_counts;
+};
+
+
+class RollRange : public RollAccumulator {
+	public:
+		                    RollRange        (void);
+
+		RollAccumulator*    makeEmpty        (void) const;
+		void                merge            (const RollAccumulator& other);
+		void                clear            (void);
+
+		void                add              (double value);
+		bool                isEmpty          (void) const;
+		double              getMinimum       (void) const;
+		double              getMaximum       (void) const;
+		long long           getCount         (void) const;
+
+	private:
+		double m_minimum;
+		double m_maximum;
+		long long m_count = 0;
+};
+
+
+class RollQuantiles : public RollAccumulator {
+	public:
+		                    RollQuantiles    (double accuracy = 0.01);
+
+		RollAccumulator*    makeEmpty        (void) const;
+		void                merge            (const RollAccumulator& other);
+		void                clear            (void);
+
+		void                add              (double value, long long count = 1);
+		double              getQuantile      (double fraction) const;
+		double              getAccuracy      (void) const;
+		long long           getCount         (void) const;
+
+	private:
+		// m_accuracy == maximum relative error of a quantile.
+		double m_accuracy;
+
+		// m_gamma == ratio between the edges of neighboring buckets.
+		double m_gamma;
+
+		// Bucket i holds values in the range (gamma^(i-1), gamma^i]:
+		std::map<int, long long> m_positive;
+		std::map<int, long long> m_negative;  // buckets for -value
+		long long m_zero  = 0;
+		long long m_count = 0;
+
+		int                 getBucket        (double value) const;
+		double              getBucketValue   (int bucket) const;
+};
+
+} // end smf namespace
+
+#endif /* _ROLLACCUMULATOR_H_INCLUDED */
+
+
+
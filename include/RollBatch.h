@@ -0,0 +1,77 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:07:19 PDT 2026
+// Last Modified: Sun Oct 18 19:32:11 PDT 2026
+// Filename:      midiroll/include/RollBatch.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Apply a change to many MIDI roll files in place, using
+//                several threads.
+//
+
+#ifndef _ROLLBATCH_H_INCLUDED
+#define _ROLLBATCH_H_INCLUDED
+
+#include "MidiRoll.h"
+#include "Options.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace smf {
+
+class RollBatch {
+	public:
+		                    RollBatch        (void);
+		                   ~RollBatch        ();
+
+		void                setThreadCount   (int count);
+		int                 getThreadCount   (void) const;
+		void                setProgress      (bool state);
+		bool                getProgress      (void) const;
+		void                setWrite         (bool state);
+		bool                getWrite         (void) const;
+
+		int                 run              (const std::vector<std::string>& filenames,
+		                                      const std::function<bool(MidiRoll&)>& function);
+		int                 run              (Options& options,
+		                                      const std::function<bool(MidiRoll&)>& function);
+
+		int                 getFileCount     (void) const;
+		int                 getFailureCount  (void) const;
+		const std::vector<std::string>& getFailures (void) const;
+		double              getSeconds       (void) const;
+
+	private:
+		// m_threads == number of files processed at the same time (0 for
+		// one per processor core).
+		int m_threads     = 0;
+
+		// m_progress == print each file as it is finished and a summary
+		// at the end to standard error.
+		bool m_progress   = false;
+
+		// m_write == write each changed file back to the same filename
+		// (false to only read the files).
+		bool m_write      = true;
+
+		// Results of the last run:
+		int m_filecount   = 0;
+		double m_seconds  = 0.0;
+		long long m_bytes = 0;
+		std::vector<std::string> m_failures;  // "filename: reason"
+
+		std::string         processFile      (const std::string& filename,
+		                                      const std::function<bool(MidiRoll&)>& function,
+		                                      int trackthreads);
+		void                printSummary     (void) const;
+};
+
+} // end smf namespace
+
+#endif /* _ROLLBATCH_H_INCLUDED */
+
+
+
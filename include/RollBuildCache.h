@@ -0,0 +1,74 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:35:58 PDT 2026
+// Last Modified: Sun Oct 18 18:38:48 PDT 2026
+// Filename:      midiroll/include/RollBuildCache.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Store the results of processing MIDI rolls in a
+//                directory, found by a hash of the input file and the
+//                processing done to it, so that unchanged inputs do not
+//                have to be processed again.
+//
+
+#ifndef _ROLLBUILDCACHE_H_INCLUDED
+#define _ROLLBUILDCACHE_H_INCLUDED
+
+#include "MidiRoll.h"
+
+#include <functional>
+#include <string>
+
+// Change ROLL_BUILD_VERSION when the output of any transform changes, so
+// that results from older versions of the library are not reused:
+#define ROLL_BUILD_VERSION "midiroll-2"
+
+namespace smf {
+
+class RollBuildCache {
+	public:
+		                    RollBuildCache   (void);
+		                    RollBuildCache   (const std::string& directory);
+		                   ~RollBuildCache   ();
+
+		void                setDirectory     (const std::string& directory);
+		const std::string&  getDirectory     (void) const;
+
+		bool                build            (const std::string& infile,
+		                                      const std::string& outfile,
+		                                      const std::string& recipe,
+		                                      const std::function<bool(MidiRoll&)>& function,
+		                                      bool* hit = NULL);
+
+		std::string         getKey           (const std::string& input,
+		                                      const std::string& recipe) const;
+		bool                fetch            (const std::string& key,
+		                                      std::string& output) const;
+		bool                store            (const std::string& key,
+		                                      const std::string& output) const;
+
+		int                 getHits          (void) const;
+		int                 getMisses        (void) const;
+
+		static std::string  sha256           (const std::string& data);
+		static bool         readFile         (const std::string& filename,
+		                                      std::string& contents);
+		static bool         writeFile        (const std::string& filename,
+		                                      const std::string& contents);
+
+	private:
+		std::string m_directory;
+		int m_hits   = 0;
+		int m_misses = 0;
+
+		std::string         getPath          (const std::string& key) const;
+		void                makeDirectory    (const std::string& key) const;
+};
+
+} // end smf namespace
+
+#endif /* _ROLLBUILDCACHE_H_INCLUDED */
+
+
+
@@ -0,0 +1,98 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:31:09 PDT 2026
+// Last Modified: Sun Oct 18 17:31:09 PDT 2026
+// Filename:      midiroll/include/RollCache.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Keep recently used MIDI rolls in memory, so that they
+//                do not have to be read and parsed again.
+//
+
+#ifndef _ROLLCACHE_H_INCLUDED
+#define _ROLLCACHE_H_INCLUDED
+
+#include "MidiRoll.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define ROLL_CACHE_BYTES (256LL * 1024 * 1024)
+
+namespace smf {
+
+class CachedRoll {
+	public:
+		std::string filename;
+		long long   filesize  = 0;     // size of file when read
+		long long   filetime  = 0;     // modification time of file when read
+		long long   bytes     = 0;     // estimated memory used by the entry
+
+		MidiRoll    roll;              // as read from the file
+		MidiRoll    joined;            // tracks joined, time analysis done,
+		                               // and notes linked
+
+		// answers == output of queries on the roll, by query.
+		std::map<std::string, std::string> answers;
+
+		// mutex == lock while using the rolls, since some queries
+		// calculate and store information in them.
+		std::mutex  mutex;
+};
+
+
+class RollCache {
+	public:
+		                    RollCache        (long long maxbytes = ROLL_CACHE_BYTES);
+		                    RollCache        (const RollCache& other) = delete;
+		                   ~RollCache        ();
+
+		RollCache&          operator=        (const RollCache& other) = delete;
+
+		std::shared_ptr<CachedRoll> get      (const std::string& filename);
+		void                addBytes         (const std::shared_ptr<CachedRoll>& roll,
+		                                      long long bytes);
+		void                clear            (void);
+
+		void                setMaxBytes      (long long maxbytes);
+		long long           getMaxBytes      (void) const;
+		long long           getBytes         (void);
+		int                 getRollCount     (void);
+		long long           getHits          (void);
+		long long           getMisses        (void);
+
+	private:
+		class _Entry {
+			public:
+				std::shared_ptr<CachedRoll> roll;
+				std::list<std::string>::iterator position;
+		};
+
+		long long m_maxbytes;
+		long long m_bytes  = 0;
+		long long m_hits   = 0;
+		long long m_misses = 0;
+
+		// m_order == filenames from most to least recently used.
+		std::list<std::string> m_order;
+		std::unordered_map<std::string, _Entry> m_entries;
+		std::mutex m_mutex;
+
+		std::shared_ptr<CachedRoll> load     (const std::string& filename,
+		                                      long long filesize, long long filetime);
+		void                remove           (const std::string& filename);
+		void                evict            (const std::string& keep);
+		static long long    estimateBytes    (MidiFile& midifile);
+};
+
+} // end smf namespace
+
+#endif /* _ROLLCACHE_H_INCLUDED */
+
+
+
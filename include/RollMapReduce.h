@@ -0,0 +1,100 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:11:07 PDT 2026
+// Last Modified: Sun Oct 18 17:11:07 PDT 2026
+// Filename:      midiroll/include/RollMapReduce.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Collect statistics from many MIDI roll files using
+//                several threads.
+//
+
+#ifndef _ROLLMAPREDUCE_H_INCLUDED
+#define _ROLLMAPREDUCE_H_INCLUDED
+
+#include "MidiRoll.h"
+#include "Options.h"
+#include "RollAccumulator.h"
+#include "RollBatch.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace smf {
+
+class RollMapReduce {
+	public:
+		                    RollMapReduce    (void);
+		                   ~RollMapReduce    ();
+
+		void                setThreadCount   (int count);
+		int                 getThreadCount   (void) const;
+		void                setProgress      (bool state);
+		bool                getProgress      (void) const;
+
+		template <class ACCUMULATOR>
+		int                 run              (const std::vector<std::string>& filenames,
+		                                      ACCUMULATOR& result,
+		                                      const std::function<void(MidiRoll&, ACCUMULATOR&)>& map);
+		template <class ACCUMULATOR>
+		int                 run              (Options& options, ACCUMULATOR& result,
+		                                      const std::function<void(MidiRoll&, ACCUMULATOR&)>& map);
+
+		int                 getFileCount     (void) const;
+		int                 getFailureCount  (void) const;
+		const std::vector<std::string>& getFailures (void) const;
+		double              getSeconds       (void) const;
+
+	private:
+		// m_batch == reads the files (without writing them back).
+		RollBatch m_batch;
+
+		int                 runAccumulators  (const std::vector<std::string>& filenames,
+		                                      RollAccumulator& result,
+		                                      const std::function<void(MidiRoll&, RollAccumulator&)>& map);
+};
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::run -- Read each file and give it to the map function
+//     along with an accumulator for the function to add to.  Each thread
+//     fills in its own empty copy of the result, and the copies are
+//     merged into the result at the end.  Returns the number of files
+//     which could not be read.
+//
+
+template <class ACCUMULATOR>
+int RollMapReduce::run(const std::vector<std::string>& filenames,
+		ACCUMULATOR& result,
+		const std::function<void(MidiRoll&, ACCUMULATOR&)>& map) {
+	return runAccumulators(filenames, result,
+		[&map](MidiRoll& roll, RollAccumulator& accumulator) {
+			map(roll, static_cast<ACCUMULATOR&>(accumulator));
+		});
+}
+
+//
+// Options version of run(): process the files given as arguments on
+// the command line.
+//
+
+template <class ACCUMULATOR>
+int RollMapReduce::run(Options& options, ACCUMULATOR& result,
+		const std::function<void(MidiRoll&, ACCUMULATOR&)>& map) {
+	std::vector<std::string> filenames;
+	for (int i=0; i<options.getArgCount(); i++) {
+		filenames.push_back(options.getArg(i+1));
+	}
+	return run(filenames, result, map);
+}
+
+} // end smf namespace
+
+#endif /* _ROLLMAPREDUCE_H_INCLUDED */
+
+
+
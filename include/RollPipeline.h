@@ -0,0 +1,66 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:01:05 PDT 2026
+// Last Modified: Sun Oct 18 17:35:58 PDT 2026
+// Filename:      midiroll/include/RollPipeline.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   An ordered list of roll transforms (using the same names
+//                and options as the command-line tools) which are applied
+//                to a roll in memory.
+//
+
+#ifndef _ROLLPIPELINE_H_INCLUDED
+#define _ROLLPIPELINE_H_INCLUDED
+
+#include "MidiRoll.h"
+#include "Options.h"
+
+#include <string>
+#include <vector>
+
+namespace smf {
+
+class RollPipeline {
+	public:
+		                    RollPipeline     (void);
+		                    RollPipeline     (const std::string& pipeline);
+		                    RollPipeline     (const RollPipeline& other) = delete;
+		                   ~RollPipeline     ();
+
+		RollPipeline&       operator=        (const RollPipeline& other) = delete;
+
+		bool                parse            (const std::string& pipeline);
+		bool                addStage         (const std::string& command);
+		void                clear            (void);
+		int                 getStageCount    (void) const;
+		const std::string&  getStageCommand  (int index) const;
+		std::string         getRecipe        (void) const;
+		bool                run              (MidiRoll& roll);
+
+		static bool         isStage          (const std::string& name);
+		static std::vector<std::string> getStageNames (void);
+
+	private:
+		class _Stage {
+			public:
+				std::string name;     // name of the transform (tool name)
+				std::string command;  // the stage as given to addStage()
+				Options     options;  // parsed options of the stage
+		};
+
+		// m_stages == transforms in the order that they are applied.
+		std::vector<_Stage*> m_stages;
+
+		static bool         defineOptions    (const std::string& name,
+		                                      Options& options);
+		bool                runStage         (_Stage& stage, MidiRoll& roll);
+};
+
+} // end smf namespace
+
+#endif /* _ROLLPIPELINE_H_INCLUDED */
+
+
+
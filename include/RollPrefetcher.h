@@ -0,0 +1,91 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:14:59 PDT 2026
+// Last Modified: Sun Oct 18 17:14:59 PDT 2026
+// Filename:      midiroll/include/RollPrefetcher.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Read MIDI roll files on background threads ahead of
+//                their use, and write results on a background thread.
+//
+
+#ifndef _ROLLPREFETCHER_H_INCLUDED
+#define _ROLLPREFETCHER_H_INCLUDED
+
+#include "MidiRoll.h"
+#include "Options.h"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define PREFETCH_QUEUE_SIZE 4
+
+namespace smf {
+
+class RollPrefetcher {
+	public:
+		                    RollPrefetcher   (void);
+		                    RollPrefetcher   (const RollPrefetcher& other) = delete;
+		                   ~RollPrefetcher   ();
+
+		RollPrefetcher&     operator=        (const RollPrefetcher& other) = delete;
+
+		void                setQueueSize     (int size);
+		int                 getQueueSize     (void) const;
+		void                setThreadCount   (int count);
+		int                 getThreadCount   (void) const;
+
+		void                start            (const std::vector<std::string>& filenames);
+		void                start            (Options& options);
+		bool                next             (MidiRoll& roll);
+		int                 getIndex         (void) const;
+		const std::string&  getFilename      (void) const;
+
+		void                write            (MidiRoll& roll, const std::string& filename);
+		int                 finish           (void);
+		const std::vector<std::string>& getWriteFailures (void) const;
+
+	private:
+		// m_queuesize == largest number of files read ahead of next(), and
+		// largest number of rolls waiting to be written.
+		int m_queuesize = PREFETCH_QUEUE_SIZE;
+
+		// m_threadcount == number of threads reading files.
+		int m_threadcount = 2;
+
+		std::vector<std::string> m_filenames;
+		int m_current  = -1;                 // index of the last roll from next()
+		int m_reading  = 0;                  // index of the next file to read
+		int m_consumed = 0;                  // index of the next roll for next()
+		std::map<int, MidiRoll*> m_ready;    // rolls read but not yet taken
+		std::vector<std::thread> m_readers;
+
+		std::deque<std::pair<MidiRoll*, std::string>> m_writes;
+		std::vector<std::string> m_writefailures;
+		std::thread m_writer;
+		bool m_closing = false;              // writer ends when queue is empty
+
+		bool m_stop = false;                 // readers end
+		std::mutex m_mutex;
+		std::condition_variable m_readycondition;
+		std::condition_variable m_readcondition;
+		std::condition_variable m_writecondition;
+
+		void                readFiles        (void);
+		void                writeFiles       (void);
+		void                stopReaders      (void);
+};
+
+} // end smf namespace
+
+#endif /* _ROLLPREFETCHER_H_INCLUDED */
+
+
+
@@ -0,0 +1,42 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 19:05:38 PDT 2026
+// Last Modified: Sun Oct 18 19:05:38 PDT 2026
+// Filename:      midiroll/include/RollReport.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Text reports on MIDI rolls, shared by the notelist,
+//                tick2time, rolltext and countnotes tools and by the
+//                roll query server.
+//
+
+#ifndef _ROLLREPORT_H_INCLUDED
+#define _ROLLREPORT_H_INCLUDED
+
+#include "MidiRoll.h"
+
+#include <ostream>
+#include <vector>
+
+namespace smf {
+
+class RollReport {
+	public:
+		static void         printNoteList      (MidiFile& joined, std::ostream& out);
+		static void         printSoundingNotes (MidiRoll& midiroll, int tick,
+		                                        std::ostream& out);
+		static void         printTickToTime    (MidiFile& joined, std::ostream& out);
+		static void         printText          (MidiRoll& midiroll, bool metadataQ,
+		                                        bool ticksQ, std::ostream& out);
+		static int          countNotes         (MidiFile& midifile,
+		                                        std::vector<int>& keycount,
+		                                        std::vector<int>& firsttick);
+		static void         printNoteCounts    (const std::vector<int>& keycount,
+		                                        const std::vector<int>& firsttick,
+		                                        int duration, std::ostream& out);
+};
+
+} // end smf namespace
+
+#endif /* _ROLLREPORT_H_INCLUDED */
@@ -0,0 +1,94 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:44:37 PDT 2026
+// Last Modified: Sun Oct 18 17:58:38 PDT 2026
+// Filename:      midiroll/include/RollSegmenter.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Split a long MIDI roll into time segments which can be
+//                processed at the same time in several threads, and join
+//                the segments back into the roll afterwards.
+//
+
+#ifndef _ROLLSEGMENTER_H_INCLUDED
+#define _ROLLSEGMENTER_H_INCLUDED
+
+#include "MidiRoll.h"
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Number of note-ons tried on each side of a segment start to find one
+// which avoids notes in the margin:
+#define SEGMENT_SEARCH 256
+
+namespace smf {
+
+class RollSegmenter {
+	public:
+		                    RollSegmenter    (void);
+		                   ~RollSegmenter    ();
+
+		void                setThreadCount   (int count);
+		int                 getThreadCount   (void) const;
+		void                setWindow        (int ticks);
+		int                 getWindow        (void) const;
+		void                setMargin        (int ticks);
+		int                 getMargin        (void) const;
+
+		int                 split            (MidiRoll& roll);
+		void                join             (MidiRoll& roll);
+		bool                run              (MidiRoll& roll,
+		                                      const std::function<bool(MidiRoll&)>& function);
+
+		int                 getSegmentCount  (void) const;
+		MidiRoll&           getSegment       (int index);
+		int                 getSegmentStart  (int index) const;
+		int                 getSegmentEnd    (int index) const;
+		void                clear            (void);
+
+	private:
+		// SegmentNote == a linked note used to place the segment starts.
+		struct SegmentNote {
+			int start;
+			int end;
+			int key;
+		};
+
+		// m_threads == number of segments processed at the same time by
+		// run() (0 for one per processor core).
+		int m_threads = 0;
+
+		// m_window == length of each segment in ticks (0 to split the
+		// roll into one segment per thread with equal numbers of events).
+		int m_window  = 0;
+
+		// m_margin == ticks around the start of a segment where a key
+		// should not end a note and start another (see setMargin()).
+		int m_margin  = 0;
+
+		std::vector<MidiRoll> m_segments;
+
+		// m_starts == starting tick of each segment.  A segment ends at
+		// the start of the next one.
+		std::vector<int> m_starts;
+
+		void                makeStarts       (MidiRoll& roll);
+		int                 findSegment      (int tick) const;
+		int                 findQuietTick    (const std::vector<SegmentNote>& notes,
+		                                      int longest, int tick) const;
+		bool                isQuiet          (const std::vector<SegmentNote>& notes,
+		                                      int longest, int tick) const;
+		int                 findNote         (const std::vector<SegmentNote>& notes,
+		                                      int tick) const;
+		int                 getThreads       (void) const;
+};
+
+} // end smf namespace
+
+#endif /* _ROLLSEGMENTER_H_INCLUDED */
+
+
+
@@ -0,0 +1,72 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:31:09 PDT 2026
+// Last Modified: Sun Oct 18 19:27:07 PDT 2026
+// Filename:      midiroll/include/RollService.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Answer queries about MIDI rolls (the same as the output
+//                of notelist, tick2time, rolltext and countnotes) from a
+//                cache of parsed rolls, over a Unix-domain socket.
+//
+
+#ifndef _ROLLSERVICE_H_INCLUDED
+#define _ROLLSERVICE_H_INCLUDED
+
+#include "RollCache.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define ROLL_SOCKET     "rolld.socket"
+#define ROLL_FRAME_MAX  (64 * 1024 * 1024)
+#define ROLL_THREADS    16
+
+namespace smf {
+
+class RollService {
+	public:
+		                    RollService      (long long cachebytes = ROLL_CACHE_BYTES);
+		                    RollService      (const RollService& other) = delete;
+		                   ~RollService      ();
+
+		RollService&        operator=        (const RollService& other) = delete;
+
+		bool                answer           (const std::string& request,
+		                                      std::string& output);
+		int                 serve            (const std::string& socketpath = "");
+		RollCache&          getCache         (void);
+		void                setThreadCount   (int count);
+		int                 getThreadCount   (void) const;
+
+		static std::string  getDefaultSocket (void);
+		static int          connect          (const std::string& socketpath = "");
+		static bool         request          (int fd, const std::string& request,
+		                                      std::string& output, bool& status);
+		static bool         readFrame        (int fd, std::string& data);
+		static bool         writeFrame       (int fd, const std::string& data);
+
+	private:
+		RollCache m_cache;
+
+		// m_threads == number of connections answered at the same time
+		// (0 for ROLL_THREADS).
+		int m_threads = 0;
+
+		void                acceptConnections (int server);
+		void                handleConnection (int fd);
+		static bool         makeSocketDirectory (const std::string& socketpath);
+		bool                parseRequest     (const std::string& request,
+		                                      std::string& command,
+		                                      std::vector<std::string>& options,
+		                                      std::string& filename);
+};
+
+} // end smf namespace
+
+#endif /* _ROLLSERVICE_H_INCLUDED */
+
+
+
@@ -0,0 +1,70 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:38:48 PDT 2026
+// Last Modified: Sun Oct 18 18:53:12 PDT 2026
+// Filename:      midiroll/include/RollTimeView.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   A read-only view of the event times of a MIDI roll in
+//                seconds, milliseconds or any other rate, optionally
+//                scaled by a tempo factor, without changing the roll.
+//
+
+#ifndef _ROLLTIMEVIEW_H_INCLUDED
+#define _ROLLTIMEVIEW_H_INCLUDED
+
+#include "MidiRoll.h"
+#include "TempoMap.h"
+
+#include <cstddef>
+
+namespace smf {
+
+class RollTimeView {
+	public:
+		                    RollTimeView     (void);
+		                    RollTimeView     (const MidiRoll& roll,
+		                                      double rate = 1.0,
+		                                      double tempofactor = 1.0);
+		                   ~RollTimeView     ();
+
+		void                setRoll          (const MidiRoll& roll);
+		const MidiRoll*     getRoll          (void) const;
+		void                setRate          (double rate);
+		double              getRate          (void) const;
+		void                setTempoFactor   (double factor);
+		double              getTempoFactor   (void) const;
+		void                refresh          (void);
+
+		double              getTime          (double tick) const;
+		double              getTime          (const MidiEvent& event) const;
+		double              getTime          (int track, int index) const;
+		double              getTick          (double time) const;
+		double              getDuration      (void) const;
+
+	private:
+		// m_roll == the roll being viewed, which is not modified.
+		const MidiRoll* m_roll = NULL;
+
+		// m_rate == time units per second (1.0 for seconds, 1000.0
+		// for milliseconds).
+		double m_rate          = 1.0;
+
+		// m_tempofactor == speed-up of the roll: a factor of 2.0
+		// halves all times.
+		double m_tempofactor   = 1.0;
+
+		// m_tempomap == timing of the roll, calculated when the roll is
+		// set or refreshed.
+		TempoMap m_tempomap;
+
+		double              getSeconds       (double tick) const;
+};
+
+} // end smf namespace
+
+#endif /* _ROLLTIMEVIEW_H_INCLUDED */
+
+
+
@@ -0,0 +1,85 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:25:30 PDT 2026
+// Last Modified: Sun Oct 18 19:24:16 PDT 2026
+// Filename:      midiroll/include/TempoMap.h
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   A class which converts between absolute ticks and
+//                time in seconds using the tempo messages of a MidiFile.
+//
+
+#ifndef _TEMPOMAP_H_INCLUDED
+#define _TEMPOMAP_H_INCLUDED
+
+#include <vector>
+#include <utility>
+
+namespace smf {
+
+class MidiFile;
+
+class TempoSegment {
+	public:
+		int    tick;     // absolute tick where the segment starts
+		double seconds;  // time in seconds at the start of the segment
+		double spt;      // seconds per tick in the segment
+		double tps;      // ticks per second in the segment
+};
+
+
+class TempoMap {
+	public:
+		                    TempoMap               (void);
+		                   ~TempoMap               ();
+
+		void                build                  (const MidiFile& midifile);
+		void                build                  (int tpq,
+		                                            const std::vector<std::pair<int, int>>& tempos);
+		void                update                 (const MidiFile& midifile,
+		                                            int fromtick);
+		void                clear                  (void);
+		void                swap                   (TempoMap& other);
+
+		double              getTimeInSeconds       (double tick) const;
+		double              getAbsoluteTickTime    (double seconds) const;
+		double              getSecondsPerTick      (double tick) const;
+		void                convertTicks           (const int* ticks,
+		                                            int* output, int count,
+		                                            double rate) const;
+
+		void                simplify               (double tolerance,
+		                                            int endtick,
+		                                            std::vector<std::pair<int, int>>& tempos) const;
+
+		int                 getSegmentCount        (void) const;
+		const TempoSegment& getSegment             (int index) const;
+		int                 getTicksPerQuarterNote (void) const;
+
+	protected:
+		// m_segments == tempo segments in tick order.  The first segment
+		// starts at tick 0 with the default tempo of 120 bpm if there is
+		// no tempo message at tick 0.
+		std::vector<TempoSegment> m_segments;
+
+		// m_tpq == ticks per quarter note used to calculate the segments.
+		int m_tpq = 120;
+
+		void                addTempos              (const MidiFile& midifile,
+		                                            int fromtick);
+		void                appendTempos           (const std::vector<std::pair<int, double>>& tempos);
+		static void         convertSegmentTicks    (const int* ticks,
+		                                            int* output, int count,
+		                                            const TempoSegment& segment,
+		                                            double rate);
+		int                 findSegmentByTick      (double tick) const;
+		int                 findSegmentBySeconds   (double seconds) const;
+};
+
+} // end of namespace smf
+
+#endif /* _TEMPOMAP_H_INCLUDED */
+
+
+
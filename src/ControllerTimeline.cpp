@@ -0,0 +1,274 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:07:57 PDT 2026
+// Last Modified: Sun Oct 18 18:43:21 PDT 2026
+// Filename:      midiroll/src/ControllerTimeline.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   On/off intervals of controllers (such as the sustain
+//                and soft pedals) for each MIDI channel.
+//
+//                A controller is on when its value is 64 or more, and off
+//                otherwise.  Repeated on messages (or off messages) do not
+//                change the state of the controller, so each interval
+//                starts at the first on message after an off state and
+//                ends at the next off message.  An interval includes its
+//                starting tick but not its ending tick.  A controller which
+//                is never turned off stays on until the end of the file.
+//                Intervals for a controller do not overlap, so the state at
+//                a given time is found with a binary search.
+//
+
+#include "ControllerTimeline.h"
+
+#include <vector>
+#include <algorithm>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// ControllerTimeline::ControllerTimeline -- Class constructor.
+//
+
+ControllerTimeline::ControllerTimeline(void) {
+	m_intervals.resize(16 * 128);
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::~ControllerTimeline -- Class deconstructor.
+//
+
+ControllerTimeline::~ControllerTimeline() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::clear -- Remove all intervals from the timeline.
+//
+
+void ControllerTimeline::clear(void) {
+	for (int i=0; i<(int)m_intervals.size(); i++) {
+		m_intervals[i].clear();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::swap -- Exchange the contents of two timelines.
+//
+
+void ControllerTimeline::swap(ControllerTimeline& other) noexcept {
+	m_intervals.swap(other.m_intervals);
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::build -- Extract the controller intervals from a MIDI
+//     file, which can be in a split or joined track state.  Times are
+//     taken from the tempo map rather than from MidiEvent::seconds, so
+//     the events are not changed and tracks shared with a fork are not
+//     copied.  The timeline stores pointers to the MidiEvents in the file,
+//     so it must be rebuilt after events are added to or removed from the
+//     file, or after ticks or tempos change.
+//
+
+void ControllerTimeline::build(MidiFile& midifile) {
+	clear();
+
+	bool revertToDelta = false;
+	if (midifile.isDeltaTicks()) {
+		midifile.makeAbsoluteTicks();
+		revertToDelta = true;
+	}
+
+	// Collect the controller messages for each channel/controller, and
+	// note the end time of the file for controllers left on:
+	const MidiFile& input = midifile;
+	std::vector<std::vector<MidiEvent*>> events(m_intervals.size());
+	int lasttick = 0;
+	for (int i=0; i<input.getTrackCount(); i++) {
+		const MidiEventList& track = input[i];
+		for (int j=0; j<track.getEventCount(); j++) {
+			MidiEvent* me = const_cast<MidiEvent*>(&track[j]);
+			if (me->tick >= lasttick) {
+				lasttick = me->tick;
+			}
+			if (!me->isController()) {
+				continue;
+			}
+			int index = me->getChannel() * 128 + me->getP1();
+			events[index].push_back(me);
+		}
+	}
+
+	double lastseconds = midifile.getTimeInSeconds(lasttick);
+	for (int i=0; i<(int)events.size(); i++) {
+		if (events[i].empty()) {
+			continue;
+		}
+		if (midifile.getTrackCount() > 1) {
+			std::stable_sort(events[i].begin(), events[i].end(),
+				[](const MidiEvent* a, const MidiEvent* b) -> bool {
+					return a->tick < b->tick;
+				}
+			);
+		}
+		std::vector<ControllerInterval>& intervals = m_intervals[i];
+		bool state = false;
+		for (int j=0; j<(int)events[i].size(); j++) {
+			MidiEvent* me = events[i][j];
+			bool value = me->getP2() >= 64;
+			if (value == state) {
+				continue;
+			}
+			state = value;
+			if (state) {
+				ControllerInterval interval;
+				interval.starttick    = me->tick;
+				interval.endtick      = lasttick;
+				interval.startseconds = midifile.getTimeInSeconds(me->tick);
+				interval.endseconds   = lastseconds;
+				interval.on           = me;
+				interval.off          = NULL;
+				intervals.push_back(interval);
+			} else {
+				intervals.back().endtick    = me->tick;
+				intervals.back().endseconds = midifile.getTimeInSeconds(me->tick);
+				intervals.back().off        = me;
+			}
+		}
+	}
+
+	if (revertToDelta) {
+		midifile.makeDeltaTicks();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::isOn -- Return true if the controller is on at the
+//     given tick (or time in seconds for isOnAtSeconds).
+//
+
+bool ControllerTimeline::isOn(int channel, int controller, int tick) const {
+	return getInterval(channel, controller, tick) != NULL;
+}
+
+
+bool ControllerTimeline::isOnAtSeconds(int channel, int controller,
+		double seconds) const {
+	return getIntervalAtSeconds(channel, controller, seconds) != NULL;
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::isSustainOn -- Return true if the sustain pedal
+//     (controller 64) is down at the given tick.
+//
+
+bool ControllerTimeline::isSustainOn(int channel, int tick) const {
+	return isOn(channel, 64, tick);
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::isSoftOn -- Return true if the soft pedal
+//     (controller 67) is down at the given tick.
+//
+
+bool ControllerTimeline::isSoftOn(int channel, int tick) const {
+	return isOn(channel, 67, tick);
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::getInterval -- Return the interval during which
+//     the controller is on at the given tick (or time in seconds for
+//     getIntervalAtSeconds), or NULL if the controller is off.  Controllers
+//     which are never turned off stay on after the end of the file.
+//
+
+const ControllerInterval* ControllerTimeline::getInterval(int channel,
+		int controller, int tick) const {
+	const std::vector<ControllerInterval>& intervals = getIntervals(channel,
+			controller);
+	auto it = std::upper_bound(intervals.begin(), intervals.end(), tick,
+		[](int value, const ControllerInterval& interval) -> bool {
+			return value < interval.starttick;
+		}
+	);
+	if (it == intervals.begin()) {
+		return NULL;
+	}
+	--it;
+	if ((it->off != NULL) && (tick >= it->endtick)) {
+		return NULL;
+	}
+	return &(*it);
+}
+
+
+const ControllerInterval* ControllerTimeline::getIntervalAtSeconds(
+		int channel, int controller, double seconds) const {
+	const std::vector<ControllerInterval>& intervals = getIntervals(channel,
+			controller);
+	auto it = std::upper_bound(intervals.begin(), intervals.end(), seconds,
+		[](double value, const ControllerInterval& interval) -> bool {
+			return value < interval.startseconds;
+		}
+	);
+	if (it == intervals.begin()) {
+		return NULL;
+	}
+	--it;
+	if ((it->off != NULL) && (seconds >= it->endseconds)) {
+		return NULL;
+	}
+	return &(*it);
+}
+
+
+
+//////////////////////////////
+//
+// ControllerTimeline::getIntervals -- Return the on intervals of a
+//     controller in time order.  An empty list is returned for invalid
+//     channel or controller numbers.
+//
+
+const std::vector<ControllerInterval>& ControllerTimeline::getIntervals(
+		int channel, int controller) const {
+	static const std::vector<ControllerInterval> empty;
+	if ((channel < 0) || (channel > 15) || (controller < 0) ||
+			(controller > 127)) {
+		return empty;
+	}
+	return m_intervals[channel * 128 + controller];
+}
+
+
+} // end smf namespace
+
+
+
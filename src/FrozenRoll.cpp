@@ -0,0 +1,294 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:48:18 PDT 2026
+// Last Modified: Sun Oct 18 18:53:12 PDT 2026
+// Filename:      midiroll/src/FrozenRoll.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   An immutable, fully analyzed copy of a MIDI roll which
+//                can be queried from several threads at the same time.
+//
+//                Many query functions of MidiRoll and MidiFile build
+//                their data on demand (time map, note index, controller
+//                timeline, event kind lists), so even a roll which is
+//                not being edited cannot be read by several threads.  A
+//                FrozenRoll does all of that work in its constructor on
+//                its own copy of the tracks, after which every query is
+//                const and only reads memory.  Share a frozen roll
+//                between threads with a pointer (such as a
+//                std::shared_ptr<const FrozenRoll>); it cannot be copied.
+//                The original roll can be edited or deleted afterwards
+//                without affecting the frozen copy.
+//
+
+#include "FrozenRoll.h"
+
+namespace smf {
+
+//////////////////////////////
+//
+// FrozenRoll::FrozenRoll -- Class constructor.  Copy and analyze the roll.
+//
+
+FrozenRoll::FrozenRoll(const MidiRoll& roll) : m_roll(roll.fork()) {
+	// Don't share tracks with the original roll, whose edits or
+	// queries could otherwise write to them:
+	m_roll.makeTracksUnique();
+	m_roll.makeAbsoluteTicks();
+	m_roll.doTimeAnalysis();
+	m_roll.linkNotePairs();
+
+	m_times.setRoll(m_roll);
+	if (m_roll.hasAccelerationModel()) {
+		// event times from the acceleration model rather than tempos:
+		for (int i=0; i<m_roll.getTrackCount(); i++) {
+			for (int j=0; j<m_roll[i].getEventCount(); j++) {
+				m_roll[i][j].seconds = m_times.getTime(m_roll[i][j]);
+			}
+		}
+	}
+
+	m_noteindex   = &m_roll.getNoteIndex();
+	m_controllers = &m_roll.getControllerTimeline();
+	m_durationticks = m_roll.getFileDurationInTicks();
+	for (int i=0; i<m_roll.getTrackCount(); i++) {
+		m_roll[i].updateEventKinds();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::~FrozenRoll -- Class deconstructor.
+//
+
+FrozenRoll::~FrozenRoll() {
+	m_noteindex   = NULL;
+	m_controllers = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getTrackCount -- Return the number of tracks in the roll.
+//
+
+int FrozenRoll::getTrackCount(void) const {
+	return m_roll.getTrackCount();
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getEventCount -- Return the number of events in a track.
+//
+
+int FrozenRoll::getEventCount(int track) const {
+	return m_roll[track].getEventCount();
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getTrack -- Return a track of the roll.  Ticks are absolute
+//     and note events are linked.
+//
+
+const MidiEventList& FrozenRoll::getTrack(int track) const {
+	return m_roll[track];
+}
+
+
+const MidiEventList& FrozenRoll::operator[](int track) const {
+	return m_roll[track];
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getEvent -- Return an event in a track.
+//
+
+const MidiEvent& FrozenRoll::getEvent(int track, int index) const {
+	return m_roll[track][index];
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getEventsOfKind -- Return the events of a track which are
+//     of the given message kind (EVENT_KIND_* in MidiMessage.h).
+//
+
+const std::vector<MidiEvent*>& FrozenRoll::getEventsOfKind(int track,
+		int kind) const {
+	return m_roll[track].getEventsOfKind(kind);
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getTicksPerQuarterNote -- Return the ticks per quarter
+//     note of the roll.
+//
+
+int FrozenRoll::getTicksPerQuarterNote(void) const {
+	return m_roll.getTicksPerQuarterNote();
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getTimeInSeconds -- Return the time in seconds of an
+//     absolute tick, using the acceleration model if the roll has one.
+//     Returns -1.0 for negative ticks.
+//
+
+double FrozenRoll::getTimeInSeconds(double tick) const {
+	return m_times.getTime(tick);
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getAbsoluteTickTime -- Return the (fractional) absolute
+//     tick at a time in seconds.  Returns -1.0 for negative times or
+//     times which an accelerating roll never reaches.
+//
+
+double FrozenRoll::getAbsoluteTickTime(double seconds) const {
+	return m_times.getTick(seconds);
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getFileDurationInTicks -- Return the largest tick in any
+//     track.
+//
+
+int FrozenRoll::getFileDurationInTicks(void) const {
+	return m_durationticks;
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getFileDurationInSeconds -- Return the time of the largest
+//     tick in any track.
+//
+
+double FrozenRoll::getFileDurationInSeconds(void) const {
+	return m_times.getTime(m_durationticks);
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getTimeView -- Return the timing of the roll in seconds.
+//     The view can be copied to change its rate or tempo factor.
+//
+
+const RollTimeView& FrozenRoll::getTimeView(void) const {
+	return m_times;
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getNoteIndex -- Return the interval index of the notes.
+//
+
+const NoteIndex& FrozenRoll::getNoteIndex(void) const {
+	return *m_noteindex;
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getControllerTimeline -- Return the on/off intervals of
+//     the controllers.
+//
+
+const ControllerTimeline& FrozenRoll::getControllerTimeline(void) const {
+	return *m_controllers;
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getLengthDpi -- Return the length resolution of the roll.
+//
+
+double FrozenRoll::getLengthDpi(void) const {
+	return m_roll.getLengthDpi();
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getWidthDpi -- Return the width resolution of the roll.
+//
+
+double FrozenRoll::getWidthDpi(void) const {
+	return m_roll.getWidthDpi();
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::hasAccelerationModel -- Return true if the roll timing
+//     comes from a continuous acceleration model.
+//
+
+bool FrozenRoll::hasAccelerationModel(void) const {
+	return m_roll.hasAccelerationModel();
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getAccelerationInches -- Return the roll length over which
+//     the acceleration model speeds up by getAccelerationPercent().
+//
+
+double FrozenRoll::getAccelerationInches(void) const {
+	return m_roll.getAccelerationInches();
+}
+
+
+
+//////////////////////////////
+//
+// FrozenRoll::getAccelerationPercent -- Return the speed-up of the
+//     acceleration model.
+//
+
+double FrozenRoll::getAccelerationPercent(void) const {
+	return m_roll.getAccelerationPercent();
+}
+
+
+} // end smf namespace
+
+
+
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Fri Apr 13 06:56:36 PDT 2018
-// Last Modified: Fri Apr 13 08:11:17 PDT 2018
+// Last Modified: Sun Oct 18 19:20:12 PDT 2026
 // Filename:      midiroll/src/MidiRoll.cpp
 // Syntax:        C++11
 // vim:           ts=3 expandtab
@@ -14,8 +14,13 @@
 
 #include <iostream>
 #include <vector>
-#include <regex>
 #include <string>
+#include <utility>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include <deque>
 
 
 namespace smf {
@@ -26,11 +31,25 @@ namespace smf {
 //
 
 MidiRoll::MidiRoll(void) : MidiFile() { }
-MidiRoll::MidiRoll(const char* aFile) : MidiFile(aFile) { }
-MidiRoll::MidiRoll(const std::string& aFile) : MidiFile(aFile) { }
-MidiRoll::MidiRoll(std::istream& input) : MidiFile(input) { }
-MidiRoll::MidiRoll(const MidiRoll& other) : MidiFile(other) { }
-MidiRoll::MidiRoll(MidiRoll&& other) : MidiFile(other) { }
+MidiRoll::MidiRoll(const char* aFile) : MidiFile(aFile) {
+	loadAccelerationModel();
+}
+
+MidiRoll::MidiRoll(const std::string& aFile) : MidiFile(aFile) {
+	loadAccelerationModel();
+}
+
+MidiRoll::MidiRoll(std::istream& input) : MidiFile(input) {
+	loadAccelerationModel();
+}
+
+MidiRoll::MidiRoll(const MidiRoll& other) : MidiFile(other) {
+	copyRollSettings(other);
+}
+
+MidiRoll::MidiRoll(MidiRoll&& other) noexcept : MidiFile(std::move(other)) {
+	swapRollData(other);
+}
 
 
 
@@ -52,15 +71,160 @@ MidiRoll& MidiRoll::operator=(const MidiRoll& other) {
 	if (this == &other) {
 		return *this;
 	}
+	invalidateIndexes();
 	MidiFile::operator=(other);
+	copyRollSettings(other);
 	return *this;
 }
 
 MidiRoll& MidiRoll::operator=(const MidiFile& other) {
+	invalidateIndexes();
 	MidiFile::operator=(other);
 	return *this;
 }
 
+MidiRoll& MidiRoll::operator=(MidiRoll&& other) noexcept {
+	if (this == &other) {
+		return *this;
+	}
+	MidiFile::operator=(std::move(other));
+	swapRollData(other);
+	other.invalidateIndexes();
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::swap -- Exchange the contents of two rolls without copying
+//     their events.  The analysis indexes are exchanged as well since
+//     they still refer to the same events.
+//
+
+void MidiRoll::swap(MidiRoll& other) noexcept {
+	MidiFile::swap(other);
+	swapRollData(other);
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::fork -- Return a copy of the roll which shares the event
+//     storage of this roll.  Tracks are only copied when one of the rolls
+//     modifies them, so forking takes time proportional to the number of
+//     tracks, and several variants of a roll use memory in proportion to
+//     the tracks which they change.  Reading events through a non-const
+//     roll counts as a modification, so use a const reference to a fork
+//     for read-only access.
+//
+
+MidiRoll MidiRoll::fork(void) const {
+	MidiRoll output;
+	output.shareTracks(*this);
+	output.copyRollSettings(*this);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::read -- Read a MIDI file, discarding any analysis indexes
+//     of the previous contents.
+//
+
+bool MidiRoll::read(const std::string& filename) {
+	invalidateIndexes();
+	bool status = MidiFile::read(filename);
+	loadAccelerationModel();
+	return status;
+}
+
+
+bool MidiRoll::read(std::istream& instream) {
+	invalidateIndexes();
+	bool status = MidiFile::read(instream);
+	loadAccelerationModel();
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::write -- Write the roll as a MIDI file (or as hex or binasc
+//     for the other functions).  If an acceleration model was set with
+//     setAccelerationModel() and its tempo steps have not been added yet,
+//     they are added to the first track before writing, so that MIDI
+//     players will hear the acceleration.  Tempo messages which are
+//     already in the roll are otherwise written unchanged.
+//
+
+bool MidiRoll::write(const std::string& filename) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::write(filename);
+}
+
+
+bool MidiRoll::write(std::ostream& out) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::write(out);
+}
+
+
+bool MidiRoll::writeHex(const std::string& filename, int width) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::writeHex(filename, width);
+}
+
+
+bool MidiRoll::writeHex(std::ostream& out, int width) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::writeHex(out, width);
+}
+
+
+bool MidiRoll::writeBinasc(const std::string& filename) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::writeBinasc(filename);
+}
+
+
+bool MidiRoll::writeBinasc(std::ostream& out) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::writeBinasc(out);
+}
+
+
+bool MidiRoll::writeBinascWithComments(const std::string& filename) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::writeBinascWithComments(filename);
+}
+
+
+bool MidiRoll::writeBinascWithComments(std::ostream& out) {
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	return MidiFile::writeBinascWithComments(out);
+}
+
 
 
 //////////////////////////////
@@ -70,7 +234,8 @@ MidiRoll& MidiRoll::operator=(const MidiFile& other) {
 //      the MIDI header rather than by a tempo meta message.  The tempo
 //      meta messages are instead used to control an emulation of the
 //      roll acceleration over time.  The final TPQ value will be rounded
-//      to the nearest integer.
+//      to the nearest integer.  Any acceleration model is replaced by its
+//      tempo steps (see clearAccelerationModel()).
 //
 // default value: dpi = 300.0
 // The default dpi of the rolls is set to 300 since this is the scanning
@@ -93,6 +258,7 @@ void MidiRoll::setRollTempo(double tempo, double dpi) {
 		std::cerr << "Error: tpq is too large: " << tpq << std::endl;
 		return;
 	}
+	clearAccelerationModel();
 	MidiFile::setTicksPerQuarterNote(tpq);
 }
 
@@ -121,17 +287,9 @@ double MidiRoll::getRollTempo(double dpi) {
 std::vector<MidiEvent*> MidiRoll::getTextEvents(void) {
 	std::vector<MidiEvent*> mes;
 	for (int i=0; i<getTrackCount(); i++) {
-		for (int j=0; j<operator[](i).getSize(); j++) {
-			MidiEvent* mm = &operator[](i)[j];
-			if (!mm->isMetaMessage()) {
-				continue;
-			}
-			int mtype = mm->getMetaType();
-			if (mtype != 0x01) {
-				continue;
-			}
-			mes.push_back(mm);
-		}
+		const std::vector<MidiEvent*>& texts =
+				operator[](i).getEventsOfKind(EVENT_KIND_TEXT);
+		mes.insert(mes.end(), texts.begin(), texts.end());
 	}
 	return mes;
 }
@@ -149,15 +307,10 @@ std::vector<MidiEvent*> MidiRoll::getMetadataEvents(void) {
 	std::vector<MidiEvent*> mes;
 	std::string marker = getMetadataMarker();
 	for (int i=0; i<getTrackCount(); i++) {
-		for (int j=0; j<operator[](i).getSize(); j++) {
-			MidiEvent* mm = &operator[](i)[j];
-			if (!mm->isMetaMessage()) {
-				continue;
-			}
-			int mtype = mm->getMetaType();
-			if (mtype != 0x01) {
-				continue;
-			}
+		const std::vector<MidiEvent*>& texts =
+				operator[](i).getEventsOfKind(EVENT_KIND_TEXT);
+		for (int j=0; j<(int)texts.size(); j++) {
+			MidiEvent* mm = texts[j];
 			std::string content = mm->getMetaContent();
 			if (content.compare(0, marker.size(), marker) != 0) {
 				continue;
@@ -183,29 +336,17 @@ std::vector<MidiEvent*> MidiRoll::getMetadataEvents(void) {
 //
 
 std::string MidiRoll::getMetadata(const std::string& key) {
-	std::string output;
-	std::string query;
-	query += getMetadataMarker();
-	query += key;
-	query += ":\\s*(.*)\\s*$";
-	std::regex re(query);
-	std::smatch match;
-	MidiRoll& mr = *this;
-	for (int i=0; i<mr[0].size(); i++) {
-		if (!mr[0][i].isText()) {
-			continue;
-		}
-		std::string content = mr[0][i].getMetaContent();
-		try {
-			if (std::regex_search(content, match, re) && (match.size() > 1)) {
-				output = match.str(1);
-				break;
-			}
-		} catch (std::regex_error& e) {
-			std::cerr << "PROBLEM SEARCHING FOR METADATA" << std::endl;
-		}
+	checkIndexes();
+	if (!m_metadatavalid) {
+		buildMetadataIndex();
 	}
-	return output;
+	auto it = m_metadata.find(key);
+	if (it == m_metadata.end()) {
+		return "";
+	}
+	const _MetadataEntry& entry = it->second[0];
+	std::string content = entry.event->getMetaContent();
+	return content.substr(entry.start, entry.length);
 }
 
 
@@ -221,42 +362,27 @@ int MidiRoll::setMetadata(const std::string& key, const std::string& value) {
 		std::cerr << "KEY CANNOT BE EMPTY" << std::endl;
 		return -1;
 	}
-	bool found = false;
-	int output = 0;
-	std::string query;
-	query += getMetadataMarker();
-	query += key;
-	query += ":\\s*(.*)\\s*$";
-	std::regex re(query);
-	std::smatch match;
-	MidiRoll& mr = *this;
-	for (int i=0; i<mr[0].size(); i++) {
-		if (!mr[0][i].isText()) {
-			continue;
-		}
-		std::string content = mr[0][i].getMetaContent();
-		try {
-			if (std::regex_search(content, match, re) && (match.size() > 1)) {
-				std::string newline;
-				newline += getMetadataMarker();
-				newline += key;
-				newline += ":";
-            if ((!value.empty()) && (!isspace(value[0]))) {
-            } else {
-               newline += " ";
-            }
-				newline += value;
-				mr[0][i].setMetaContent(newline);
-				found = true;
-				output = mr[0][i].tick;
-				break;
-			}
-		} catch (std::regex_error& e) {
-			std::cerr << "PROBLEM SEARCHING FOR METADATA" << std::endl;
-		}
+	makeTrackUnique(0);
+	checkIndexes();
+	if (!m_metadatavalid) {
+		buildMetadataIndex();
 	}
-	if (found) {
-		return output;
+	std::string newkey;
+	auto it = m_metadata.find(key);
+	if (it != m_metadata.end()) {
+		_MetadataEntry& entry = it->second[0];
+		std::string newline;
+		newline += getMetadataMarker();
+		newline += key;
+		newline += ":";
+		if ((!value.empty()) && (!isspace(value[0]))) {
+		} else {
+			newline += " ";
+		}
+		newline += value;
+		entry.event->setMetaContent(newline);
+		parseMetadata(entry.event, newkey, entry);
+		return entry.event->tick;
 	}
 
 	std::string newline;
@@ -265,9 +391,43 @@ int MidiRoll::setMetadata(const std::string& key, const std::string& value) {
 	newline += ": ";
 	newline += value;
 
-	mr.addText(0, 0, newline);
+	MidiRoll& mr = *this;
+	_MetadataEntry entry;
+	entry.event = mr.addText(0, 0, newline);
 	mr.sortTrack(0);
+	if (parseMetadata(entry.event, newkey, entry)) {
+		m_metadata[newkey].push_back(entry);
+	}
+
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::deleteMetadata -- Remove all occurrences of a metadata key
+//    (and its value) from the first track.  Returns the number of
+//    events which were removed.
+//
 
+int MidiRoll::deleteMetadata(const std::string& key) {
+	makeTrackUnique(0);
+	checkIndexes();
+	if (!m_metadatavalid) {
+		buildMetadataIndex();
+	}
+	auto it = m_metadata.find(key);
+	if (it == m_metadata.end()) {
+		return 0;
+	}
+	int output = (int)it->second.size();
+	for (int i=0; i<output; i++) {
+		it->second[i].event->clear();
+	}
+	m_metadata.erase(it);
+	MidiRoll& mr = *this;
+	mr[0].removeEmpties();
 	return output;
 }
 
@@ -276,175 +436,1237 @@ int MidiRoll::setMetadata(const std::string& key, const std::string& value) {
 //////////////////////////////
 //
 // MidiRoll::trackerize -- Emulate tracker bar extension
-//     of holes on scan.
+//     of holes on scan.  Each note-off is moved later by the tracker
+//     height, except that it is not moved past the next note-on of the
+//     same key (and channel) in the track, since the hole is then read
+//     as the start of the next note.  The tracks are processed in one
+//     pass each and stay in sorted order, with their notes linked.
 //
 
 void MidiRoll::trackerize(int trackerheight) {
 	MidiRoll& mr = *this;
+	int firsttick = -1;
+	for (int i=0; i<getTrackCount(); i++) {
+		int tick = trackerizeTrack(mr[i], trackerheight);
+		if ((tick >= 0) && ((firsttick < 0) || (tick < firsttick))) {
+			firsttick = tick;
+		}
+	}
+	if (firsttick >= 0) {
+		invalidateTimeMap(firsttick);
+	}
+	invalidateIndexes();
+}
+
 
-	mr.joinTracks();   // make a single list of events
-	mr.linkNotePairs();
 
-	for (int i=0; i<mr[0].getSize(); i++) {
-		if (!mr[0][i].isNoteOn()) {
+//////////////////////////////
+//
+// MidiRoll::applyPedal -- Emulate a pedal controller (default the
+//     sustain pedal, controller 64) by extending the notes which end
+//     while the pedal is down on their channel to the release of the
+//     pedal, and then removing the pedal events.  A note which is struck
+//     again while held by the pedal ends when it is struck again.  The
+//     pedal applies to the notes of all tracks; the tracks are read
+//     together in one pass in sorted order, and the extended note-offs
+//     are put in place in their own tracks, so that the tracks stay
+//     sorted.  Notes still held when the roll ends without a release of
+//     the pedal are not extended.
+//
+
+void MidiRoll::applyPedal(int controller) {
+	MidiRoll& mr = *this;
+	int trackcount = getTrackCount();
+
+	// outputs == events of each track in their new order.
+	std::vector<std::vector<MidiEvent*>> outputs(trackcount);
+	// positions == index of the next input event in each track.
+	std::vector<int> positions(trackcount, 0);
+	// pedals == pedal state of each channel.
+	std::vector<bool> pedals(16, false);
+	// offs == note-offs held by the pedal with their tracks, by channel
+	// and key.
+	std::vector<std::vector<std::pair<int, MidiEvent*>>> offs(16 * 128);
+
+	// release == end the held notes of a channel and key at the tick.
+	auto release = [&](int index, int tick) {
+		for (int i=0; i<(int)offs[index].size(); i++) {
+			MidiEvent* off = offs[index][i].second;
+			off->tick = tick;
+			insertInOrder(outputs[offs[index][i].first], off);
+		}
+		offs[index].clear();
+	};
+
+	int firsttick = -1;
+	while (true) {
+		// next event of the roll, in the order of MidiFile::joinTracks():
+		MidiEvent* event = NULL;
+		int track = -1;
+		for (int i=0; i<trackcount; i++) {
+			if (positions[i] >= mr[i].getEventCount()) {
+				continue;
+			}
+			MidiEvent* candidate = &mr[i][positions[i]];
+			if ((event == NULL) || (eventcompare(&candidate, &event) < 0)) {
+				event = candidate;
+				track = i;
+			}
+		}
+		if (event == NULL) {
+			break;
+		}
+		positions[track]++;
+
+		int channel = event->getChannel();
+		if (event->isController() && (event->getP1() == controller)) {
+			pedals[channel] = event->getP2() >= 64;
+			if (!pedals[channel]) {
+				for (int key=0; key<128; key++) {
+					release(channel * 128 + key, event->tick);
+				}
+			}
+			if (firsttick < 0) {
+				firsttick = event->tick;
+			}
+			event->unlinkEvent();
+			delete event;
 			continue;
 		}
-		MidiEvent* me = mr[0][i].getLinkedEvent();
-		if (!me) {
-			std::cerr << "MISSING NOTE OFF" << std::endl;
+		if (event->isNoteOn()) {
+			release(channel * 128 + event->getKeyNumber(), event->tick);
+		} else if (event->isNoteOff() && pedals[channel]) {
+			offs[channel * 128 + event->getKeyNumber()].push_back(
+					std::make_pair(track, event));
 			continue;
 		}
-		me->tick += trackerheight;
+		outputs[track].push_back(event);
+	}
+
+	// Notes held by a pedal which is not released keep their endings:
+	for (int i=0; i<(int)offs.size(); i++) {
+		for (int j=0; j<(int)offs[i].size(); j++) {
+			insertInOrder(outputs[offs[i][j].first], offs[i][j].second);
+		}
 	}
 
-	mr.splitTracks(); // split events into separate tracks again
-	mr.sortTracks();  // necessary since timestamps have been changed
+	for (int i=0; i<trackcount; i++) {
+		mr[i].detach();
+		for (int j=0; j<(int)outputs[i].size(); j++) {
+			mr[i].push_back_no_copy(outputs[i][j]);
+		}
+	}
+	if (firsttick >= 0) {
+		invalidateTimeMap(firsttick);
+	}
+	invalidateIndexes();
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::removeAcceleration -- Remove any tempo meta messages
-//    which are intended to emulate roll acceleration on the pickup
-//    spool of a player piano.
+// MidiRoll::shiftHoles -- Transpose all notes when the hole positions
+//     are off from the correct position for some reason when extracting
+//     from the roll images.  The notes are then moved to the register
+//     tracks and channels of their new key numbers (currently only for
+//     red and green Welte rolls), and the shift is stored in the
+//     HOLE_SHIFT metadata.
+//
+// default value: green = false (red Welte roll)
 //
 
-void MidiRoll::removeAcceleration (void) {
+void MidiRoll::shiftHoles(int transpose, bool green) {
+	for (int i=0; i<getTrackCount(); i++) {
+		MidiEventList& mel = operator[](i);
+		for (int j=0; j<mel.getEventCount(); j++) {
+			if (!mel[j].isNote()) {
+				continue;
+			}
+			mel[j].setKeyNumber(mel[j].getKeyNumber() + transpose);
+		}
+	}
+
+	// See RollOptions.cpp source code for where the numbers came from.
+	if (green) {
+		// 0 = always lower region of bass expression.
+		// 21 = first note of bass-note region.
+		// 67 = first note of treble-note region (G4)
+		// 109 = first note of treble-expression.
+		applyRegisterSplits(21, 67, 109);
+	} else {
+		// 0 = always lower region of bass expression.
+		// 24 = first note of bass-note region.
+		// 67 = first note of treble-note region (G4)
+		// 104 = first note of treble-expression.
+		applyRegisterSplits(24, 67, 104);
+	}
+
+	setMetadata("HOLE_SHIFT", "\t\t" + std::to_string(transpose));
+	invalidateIndexes();
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::setRegisterBreak -- Change the break point between the bass
+//     and treble registers: treble-track notes below the break point are
+//     moved to the bass track (channel 1), and bass-track notes above it
+//     to the treble track (channel 2).  Returns false without changing
+//     the roll if the break point is not between 20 and 80.
+//
+// default values: trebletrack = 2, basstrack = 1
+//
+
+bool MidiRoll::setRegisterBreak(double breakpoint, int trebletrack,
+		int basstrack) {
+	if ((breakpoint < 20) || (breakpoint > 80)) {
+		return false;
+	}
+	int basschannel   = 1;
+	int treblechannel = 2;
+
 	MidiRoll& mr = *this;
-	for (int i=0; i<mr[0].size(); i++) {
-		if (!mr[0][i].isTempo()) {
+	mr.joinTracks();
+	for (int i=0; i<mr[0].getEventCount(); i++) {
+		if (!mr[0][i].isNote()) {
 			continue;
 		}
-		mr[0][i].clear();
+		int key = mr[0][i].getKeyNumber();
+		int track = mr[0][i].track;
+		if (track == trebletrack) {
+			if (key < breakpoint) {
+				mr[0][i].track = basstrack;
+				mr[0][i].setChannel(basschannel);
+			}
+		}
+		if (track == basstrack) {
+			if (key > breakpoint) {
+				mr[0][i].track = trebletrack;
+				mr[0][i].setChannel(treblechannel);
+			}
+		}
 	}
-	// Need to add tempo = 60 at tick 0
-	MidiFile::addTempo(0, 0, 60.0);
-	MidiFile::sortTrack(0);
+	mr.splitTracks();
+	invalidateIndexes();
+	return true;
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::applyAcceleration -- Emulate roll acceleration according
-//    to the input paramters.
-// default values:
-//      inches  = 12.0;
-//      percent = 0.04;
+// MidiRoll::setInstrument -- Set the instrument of all tracks.  Existing
+//     patch changes are changed to the new instrument, and tracks with
+//     notes but no patch change are given one at the start of the track
+//     on the channel of their first note.
 //
 
-void MidiRoll::applyAcceleration(double inches, double percent) {
-	removeAcceleration();  // adds first tempo at 60.0
-	double factor  = 1.0 + percent / 100.0;
-	int    maxtick = getFileDurationInTicks();
-	double step    = getLengthDpi() * inches;
-	int    count   = int(maxtick / step);
-	double tempo   = 60.0 * factor;
-	for (int i=1; i<count; i++) {
-		addTempo(0, (int)(i*step+0.5), tempo);
-		tempo *= factor;
+void MidiRoll::setInstrument(int instrument) {
+	if (instrument < 0) {
+		instrument = 0;
 	}
-	sortTrack(0);
+	if (instrument > 127) {
+		instrument = 127;
+	}
+
+	MidiRoll& mr = *this;
+	bool needsSort = false;
+	int trackcount = getTrackCount();
+	for (int i=0; i<trackcount; i++) {
+		bool found = false;
+		int channel = -1;
+		for (int j=0; j<mr[i].getEventCount(); j++) {
+			if (mr[i][j].isTimbre()) {
+				mr[i][j].setP1(instrument);
+				found = true;
+			} else if ((channel < 0) && mr[i][j].isNote()) {
+				channel = mr[i][j].getChannel();
+			}
+		}
+		if ((!found) && (channel >= 0)) {
+			addPatchChange(i, 0, channel, instrument);
+			needsSort = true;
+		}
+	}
+
+	if (needsSort) {
+		sortTracks();
+	}
+	invalidateIndexes();
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::convertToMillisecondTicks -- Convert from ticks representing
-//     image pixel rows into ticks representing milliseconds.  MIDI file
-//     is assumed to be in absolute tick mode before calling this function.
+// MidiRoll::getAttackVelocityRange -- Find the smallest and largest
+//     note-on velocities in the note tracks (tracks 1 and 2).  Both
+//     are -1 if there are no notes.
 //
 
-void MidiRoll::convertToMillisecondTicks(void) {
-   doTimeAnalysis();
-   setMillisecondTicks();
-   MidiRoll& mr = *this;
-   for (int i=0; i<mr.getTrackCount(); i++) {
-      for (int j=0; j<mr[i].getEventCount(); j++) {
-         mr[i][j].tick = int(mr[i][j].seconds * 1000.0 + 0.5);
-      }
-   }
-	removeAcceleration();
+void MidiRoll::getAttackVelocityRange(int& minimum, int& maximum) {
+	minimum = -1;
+	maximum = -1;
+	MidiRoll& mr = *this;
+	for (int i=1; (i<=2) && (i<getTrackCount()); i++) {
+		for (int j=0; j<mr[i].getEventCount(); j++) {
+			if (!mr[i][j].isNoteOn()) {
+				continue;
+			}
+			int velocity = mr[i][j].getVelocity();
+			if ((minimum < 0) || (velocity < minimum)) {
+				minimum = velocity;
+			}
+			if ((maximum < 0) || (velocity > maximum)) {
+				maximum = velocity;
+			}
+		}
+	}
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::getLengthDpi -- Get the DPI resolution of the original scan
-//    along the length of the piano roll.
+// MidiRoll::rescaleAttackVelocities -- Map the velocities of notes in
+//     the note tracks (tracks 1 and 2) linearly from one range onto
+//     another.  Note-offs with a velocity of 0 are not changed.  All
+//     values are limited to the range from 1 to 127.
 //
 
-double MidiRoll::getLengthDpi(void) {
-	return m_lengthdpi;
+void MidiRoll::rescaleAttackVelocities(double oldmin, double oldmax,
+		double newmin, double newmax) {
+	double* values[4] = {&oldmin, &oldmax, &newmin, &newmax};
+	for (int i=0; i<4; i++) {
+		if (*values[i] < 1) {
+			*values[i] = 1;
+		}
+		if (*values[i] > 127) {
+			*values[i] = 127;
+		}
+	}
+	double slope = (newmax - newmin) / (oldmax - oldmin);
+	double zero = newmax - slope * oldmax;
+
+	MidiRoll& mr = *this;
+	for (int i=1; (i<=2) && (i<getTrackCount()); i++) {
+		for (int j=0; j<mr[i].getEventCount(); j++) {
+			if (!mr[i][j].isNote()) {
+				continue;
+			}
+			if (mr[i][j].isNoteOff()) {
+				if (mr[i][j].getVelocity() == 0) {
+					continue;
+				}
+			}
+			int velocity = int(slope * mr[i][j].getVelocity() + zero + 0.5);
+			if (velocity < 1) {
+				velocity = 1;
+			}
+			if (velocity > 127) {
+				velocity = 127;
+			}
+			mr[i][j].setVelocity(velocity);
+		}
+	}
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::setLengthDpi -- Set the DPI resolution of the original scan
-//     along the length of the piano roll.
+// MidiRoll::removeAcceleration -- Remove any tempo meta messages
+//    which are intended to emulate roll acceleration on the pickup
+//    spool of a player piano, as well as the acceleration model.
 //
 
-void MidiRoll::setLengthDpi(double value) {
-	if (value > 0) {
-		m_lengthdpi = value;
+void MidiRoll::removeAcceleration (void) {
+	if (hasAccelerationModel()) {
+		m_accelinches  = 0.0;
+		m_accelpercent = 0.0;
+		m_acceldirty   = false;
+		deleteMetadata(ACCELERATION_STEP_KEY);
+		deleteMetadata(ACCELERATION_PERCENT_KEY);
 	}
+	removeTempoSteps();
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::getWidthDpi -- Get the DPI resolution of the original
-//    scan across the width of the piano roll.
+// MidiRoll::clearAccelerationModel -- Remove the acceleration model (and
+//    its metadata) but keep its tempo steps as ordinary tempo messages,
+//    adding them first if they have not been added yet.  Call this
+//    before editing tempo messages directly, since the model would
+//    otherwise no longer describe the tempos of the roll.
 //
 
-double MidiRoll::getWidthDpi(void) {
-	return m_widthdpi;
+void MidiRoll::clearAccelerationModel(void) {
+	if (!hasAccelerationModel()) {
+		return;
+	}
+	if (m_acceldirty) {
+		materializeAcceleration();
+	}
+	m_accelinches  = 0.0;
+	m_accelpercent = 0.0;
+	deleteMetadata(ACCELERATION_STEP_KEY);
+	deleteMetadata(ACCELERATION_PERCENT_KEY);
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::setWidthDpi -- Set the DPI resolution of the original scan
-//     across the width of the piano roll.
+// MidiRoll::applyAcceleration -- Emulate roll acceleration according
+//    to the input paramters.  This sets the acceleration model of the
+//    roll and immediately adds the tempo steps for it (see
+//    setAccelerationModel() and materializeAcceleration()).
+// default values:
+//      inches  = 12.0;
+//      percent = 0.04;
 //
 
-void MidiRoll::setWidthDpi(double value) {
-	if (value > 0) {
-		m_widthdpi = value;
-	}
+void MidiRoll::applyAcceleration(double inches, double percent) {
+	setAccelerationModel(inches, percent);
+	materializeAcceleration();
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::getMetadataMarker --
+// MidiRoll::setAccelerationModel -- Emulate roll acceleration with a
+//    continuous model, where the roll speeds up by the given percent
+//    every given inches of roll.  Tempo steps for the acceleration are
+//    removed from the first track: they are only added back when the
+//    roll is written (or by materializeAcceleration()).  The model
+//    parameters are stored in the roll as metadata.  A zero (or negative)
+//    value for either parameter removes the acceleration.
 //
 
-std::string MidiRoll::getMetadataMarker(void) {
-	return m_metadatamarker;
+void MidiRoll::setAccelerationModel(double inches, double percent) {
+	if ((inches <= 0.0) || (percent <= 0.0)) {
+		removeAcceleration();
+		return;
+	}
+	removeTempoSteps();
+	m_accelinches  = inches;
+	m_accelpercent = percent;
+	m_acceldirty   = true;
+	std::stringstream step;
+	step << inches << "in";
+	std::stringstream factor;
+	factor << percent << "%";
+	setMetadata(ACCELERATION_STEP_KEY, step.str());
+	setMetadata(ACCELERATION_PERCENT_KEY, factor.str());
 }
 
 
 
 //////////////////////////////
 //
-// MidiRoll::getMetadataMarker --
+// MidiRoll::hasAccelerationModel -- Return true if the roll has an
+//    acceleration model.
 //
 
-void MidiRoll::setMetadataMarker(const std::string& value) {
-	m_metadatamarker = value;
+bool MidiRoll::hasAccelerationModel(void) const {
+	return (m_accelinches > 0.0) && (m_accelpercent > 0.0);
 }
 
 
-} // end smf namespace
+
+//////////////////////////////
+//
+// MidiRoll::getAccelerationInches -- Return the length of roll over
+//    which the acceleration model speeds up by getAccelerationPercent(),
+//    or 0.0 if there is no acceleration model.
+//
+
+double MidiRoll::getAccelerationInches(void) const {
+	return m_accelinches;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getAccelerationPercent -- Return the percent increase in roll
+//    speed over each getAccelerationInches() length of roll, or 0.0 if
+//    there is no acceleration model.
+//
+
+double MidiRoll::getAccelerationPercent(void) const {
+	return m_accelpercent;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::materializeAcceleration -- Replace the tempo messages in the
+//    first track with the tempo steps of the acceleration model (see
+//    getAccelerationTempos()).  Nothing is changed if there is no
+//    acceleration model.
+//
+
+void MidiRoll::materializeAcceleration(void) {
+	if (!hasAccelerationModel()) {
+		return;
+	}
+	std::vector<std::pair<int, int>> tempos;
+	getAccelerationTempos(tempos);
+	removeTempoSteps();  // adds first tempo at 60.0
+	for (int i=1; i<(int)tempos.size(); i++) {
+		MidiEvent* me = addTempo(0, tempos[i].first, 60.0);
+		me->setTempoMicroseconds(tempos[i].second);
+	}
+	sortTrack(0);
+	invalidateIndexes();
+	m_acceldirty = false;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getAccelerationTempos -- Return the tempo steps of the
+//    acceleration model as pairs of (absolute tick, microseconds per
+//    quarter note), which are the tempo messages that are written with
+//    the roll.  The tempo starts at 60 and increases by the acceleration
+//    percent at every step of roll up to the end of the roll.  The list
+//    is empty if there is no acceleration model.  MIDI file is assumed
+//    to be in absolute tick mode before calling this function.
+//
+
+void MidiRoll::getAccelerationTempos(std::vector<std::pair<int, int>>& tempos) const {
+	tempos.clear();
+	if (!hasAccelerationModel()) {
+		return;
+	}
+	int    maxtick = getLastTick();
+	double factor = 1.0 + m_accelpercent / 100.0;
+	double step   = getLengthDpi() * m_accelinches;
+	int    count  = int(maxtick / step);
+	double tempo  = 60.0 * factor;
+	tempos.emplace_back(0, 1000000);
+	for (int i=1; i<count; i++) {
+		// same rounding as MidiMessage::setTempo():
+		tempos.emplace_back((int)(i*step+0.5), (int)(60.0 / tempo * 1000000.0 + 0.5));
+		tempo *= factor;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getRollTempoMap -- Return the tempo map used for the times
+//    of the roll.  If the roll has an acceleration model, this is the map
+//    of its tempo steps (see getAccelerationTempos()), so that times
+//    are the same as those of the written roll; otherwise it is the tempo
+//    map of the tempo messages.  The map of the tempo steps is only
+//    rebuilt when one of the values which determine the steps changes.
+//
+
+const TempoMap& MidiRoll::getRollTempoMap(void) {
+	if (!hasAccelerationModel()) {
+		return getTempoMap();
+	}
+	int lasttick = getLastTick();
+	if ((m_accelmapinches != m_accelinches) ||
+			(m_accelmappercent != m_accelpercent) ||
+			(m_accelmapdpi != m_lengthdpi) ||
+			(m_accelmaptick != lasttick) ||
+			(m_accelmap.getTicksPerQuarterNote() != getTicksPerQuarterNote())) {
+		std::vector<std::pair<int, int>> tempos;
+		getAccelerationTempos(tempos);
+		m_accelmap.build(getTicksPerQuarterNote(), tempos);
+		m_accelmapinches  = m_accelinches;
+		m_accelmappercent = m_accelpercent;
+		m_accelmapdpi     = m_lengthdpi;
+		m_accelmaptick    = lasttick;
+	}
+	return m_accelmap;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getRollTimeInSeconds -- Return the time in seconds of an
+//    absolute tick, using the tempo steps of the acceleration model if
+//    the roll has one (see getRollTempoMap()).  Returns -1.0 for negative
+//    ticks.
+//
+
+double MidiRoll::getRollTimeInSeconds(double tick) {
+	return getRollTempoMap().getTimeInSeconds(tick);
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getRollTickTime -- Return the (fractional) absolute tick at
+//    a time in seconds.  This is the inverse of getRollTimeInSeconds().
+//    Returns -1.0 for negative times.
+//
+
+double MidiRoll::getRollTickTime(double seconds) {
+	return getRollTempoMap().getAbsoluteTickTime(seconds);
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::simplifyTempos -- Replace the tempo messages with as few
+//    tempo messages as possible while keeping the time of every event
+//    within the given tolerance in seconds (see TempoMap::simplify()).
+//    All tempo messages are moved to the first track.  If the roll has
+//    an acceleration model, its tempo steps are simplified and the
+//    model is removed, since it would otherwise replace the simplified
+//    tempos when writing.  Returns the largest change in the time of
+//    any event in seconds.  MIDI file is assumed to be in absolute tick
+//    mode before calling this function.
+//
+
+double MidiRoll::simplifyTempos(double tolerance) {
+	clearAccelerationModel();
+	TempoMap oldmap = getTempoMap();
+	std::vector<std::pair<int, int>> tempos;
+	oldmap.simplify(tolerance, getFileDurationInTicks(), tempos);
+
+	MidiRoll& mr = *this;
+	for (int i=0; i<mr.getTrackCount(); i++) {
+		const std::vector<MidiEvent*>& events =
+				mr[i].getEventsOfKind(EVENT_KIND_TEMPO);
+		for (int j=0; j<(int)events.size(); j++) {
+			events[j]->clear();
+		}
+	}
+	removeEmpties();
+	for (int i=0; i<(int)tempos.size(); i++) {
+		MidiEvent* me = addTempo(0, tempos[i].first, 60.0);
+		me->setTempoMicroseconds(tempos[i].second);
+	}
+	sortTrack(0);
+	invalidateIndexes();
+
+	const TempoMap& newmap = getTempoMap();
+	double maxerror = 0.0;
+	for (int i=0; i<mr.getTrackCount(); i++) {
+		for (int j=0; j<mr[i].getEventCount(); j++) {
+			int tick = mr[i][j].tick;
+			double error = fabs(newmap.getTimeInSeconds(tick) -
+					oldmap.getTimeInSeconds(tick));
+			if (error > maxerror) {
+				maxerror = error;
+			}
+		}
+	}
+	return maxerror;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::convertToMillisecondTicks -- Convert from ticks representing
+//     image pixel rows into ticks representing milliseconds.  MIDI file
+//     is assumed to be in absolute tick mode before calling this function.
+//
+
+void MidiRoll::convertToMillisecondTicks(void) {
+	convertToRateTicks(1000.0);
+	setMillisecondTicks();
+	removeAcceleration();
+	invalidateIndexes();
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::convertToRateTicks -- Convert from ticks representing image
+//     pixel rows into ticks at the given rate per second (such as 1000.0
+//     for milliseconds).  The ticks of each track are converted as one
+//     batch with TempoMap::convertTicks(), using the tempo steps of the
+//     acceleration model if the roll has one (see getRollTempoMap()).
+//     The acceleration is then part of the ticks, so the acceleration
+//     model is removed, but the tempo messages and ticks-per-quarter-note
+//     value are left for the caller to adjust.  MIDI file is assumed to be
+//     in absolute tick mode before calling this function.
+//
+
+void MidiRoll::convertToRateTicks(double rate) {
+	MidiRoll& mr = *this;
+	const TempoMap& tempomap = getRollTempoMap();
+	std::vector<int> ticks;
+	for (int i=0; i<mr.getTrackCount(); i++) {
+		MidiEventList& track = mr[i];
+		int count = track.getEventCount();
+		ticks.resize(count);
+		for (int j=0; j<count; j++) {
+			ticks[j] = track[j].tick;
+		}
+		tempomap.convertTicks(ticks.data(), ticks.data(), count, rate);
+		for (int j=0; j<count; j++) {
+			track[j].tick = ticks[j];
+		}
+	}
+	if (hasAccelerationModel()) {
+		m_accelinches  = 0.0;
+		m_accelpercent = 0.0;
+		m_acceldirty   = false;
+		deleteMetadata(ACCELERATION_STEP_KEY);
+		deleteMetadata(ACCELERATION_PERCENT_KEY);
+	}
+	invalidateTimeMap();
+	invalidateIndexes();
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getLengthDpi -- Get the DPI resolution of the original scan
+//    along the length of the piano roll.
+//
+
+double MidiRoll::getLengthDpi(void) const {
+	return m_lengthdpi;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::setLengthDpi -- Set the DPI resolution of the original scan
+//     along the length of the piano roll.
+//
+
+void MidiRoll::setLengthDpi(double value) {
+	if (value > 0) {
+		m_lengthdpi = value;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getWidthDpi -- Get the DPI resolution of the original
+//    scan across the width of the piano roll.
+//
+
+double MidiRoll::getWidthDpi(void) const {
+	return m_widthdpi;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::setWidthDpi -- Set the DPI resolution of the original scan
+//     across the width of the piano roll.
+//
+
+void MidiRoll::setWidthDpi(double value) {
+	if (value > 0) {
+		m_widthdpi = value;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getMetadataMarker --
+//
+
+std::string MidiRoll::getMetadataMarker(void) {
+	return m_metadatamarker;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getMetadataMarker --
+//
+
+void MidiRoll::setMetadataMarker(const std::string& value) {
+	m_metadatamarker = value;
+	m_metadatavalid = false;
+	m_metadata.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getNoteIndex -- Return an interval index of the linked notes
+//     in the roll, for finding which holes are open at a given tick or
+//     range of ticks.  The index is built when first requested and then
+//     kept until the roll is changed by a MidiRoll function, or until
+//     events are added or removed through the MidiFile interface.  Call
+//     invalidateIndexes() after editing events in place so that the index
+//     will be rebuilt.  Building the index does not copy tracks shared
+//     with a fork, so the events in the index may belong to other rolls
+//     as well and should not be changed through it.
+//
+
+const NoteIndex& MidiRoll::getNoteIndex(void) {
+	checkIndexes();
+	if (!m_noteindexvalid) {
+		m_noteindex.build(*this);
+		m_noteindexvalid = true;
+	}
+	return m_noteindex;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getControllerTimeline -- Return the on/off intervals of the
+//     controllers (such as the sustain and soft pedals) in the roll.  The
+//     timeline is built when first requested and kept in the same way as
+//     the note index.
+//
+
+const ControllerTimeline& MidiRoll::getControllerTimeline(void) {
+	checkIndexes();
+	if (!m_controllersvalid) {
+		m_controllers.build(*this);
+		m_controllersvalid = true;
+	}
+	return m_controllers;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::invalidateIndexes -- Mark the analysis indexes of the roll
+//     as out of date, so that they will be rebuilt when next requested.
+//
+
+void MidiRoll::invalidateIndexes(void) {
+	m_noteindexvalid = false;
+	m_noteindex.clear();
+	m_controllersvalid = false;
+	m_controllers.clear();
+	m_metadatavalid = false;
+	m_metadata.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// MidiRoll::checkIndexes -- Discard the analysis indexes if the event
+//    storage has changed since they were built, such as when a track
+//    shared with a fork has been copied or when events have been added
+//    or removed through the MidiFile interface.  Shared tracks are not copied
+//    here, since building and reading the indexes does not change the
+//    events; functions which change events through the indexes must
+//    first copy the tracks which they change.
+//
+
+void MidiRoll::checkIndexes(void) {
+	if (m_indexgeneration != m_storagegeneration) {
+		invalidateIndexes();
+		m_indexgeneration = m_storagegeneration;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::copyRollSettings -- Copy the roll dimensions and metadata
+//    marker from another roll.
+//
+
+void MidiRoll::copyRollSettings(const MidiRoll& other) {
+	m_lengthdpi      = other.m_lengthdpi;
+	m_widthdpi       = other.m_widthdpi;
+	m_metadatamarker = other.m_metadatamarker;
+	m_accelinches    = other.m_accelinches;
+	m_accelpercent   = other.m_accelpercent;
+	m_acceldirty     = other.m_acceldirty;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::swapRollData -- Exchange the roll settings and analysis
+//    indexes with another roll.  Used when the events of the rolls
+//    have been moved or swapped, so the indexes remain valid for the
+//    roll holding the events.
+//
+
+void MidiRoll::swapRollData(MidiRoll& other) noexcept {
+	std::swap(m_lengthdpi, other.m_lengthdpi);
+	std::swap(m_widthdpi, other.m_widthdpi);
+	m_metadatamarker.swap(other.m_metadatamarker);
+	std::swap(m_accelinches, other.m_accelinches);
+	std::swap(m_accelpercent, other.m_accelpercent);
+	std::swap(m_acceldirty, other.m_acceldirty);
+	m_noteindex.swap(other.m_noteindex);
+	std::swap(m_noteindexvalid, other.m_noteindexvalid);
+	m_controllers.swap(other.m_controllers);
+	std::swap(m_controllersvalid, other.m_controllersvalid);
+	m_metadata.swap(other.m_metadata);
+	std::swap(m_metadatavalid, other.m_metadatavalid);
+	std::swap(m_indexgeneration, other.m_indexgeneration);
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::buildMetadataIndex -- Index the metadata key/value pairs
+//    in the first track of the roll.
+//
+
+void MidiRoll::buildMetadataIndex(void) {
+	m_metadata.clear();
+	const MidiRoll& mr = *this;
+	std::string key;
+	_MetadataEntry entry;
+	const std::vector<MidiEvent*>& texts =
+			mr[0].getEventsOfKind(EVENT_KIND_TEXT);
+	for (int i=0; i<(int)texts.size(); i++) {
+		entry.event = texts[i];
+		if (parseMetadata(entry.event, key, entry)) {
+			m_metadata[key].push_back(entry);
+		}
+	}
+	m_metadatavalid = true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::parseMetadata -- Extract the key and the location of the value
+//    from a text event in the form:
+//        @KEY: value
+//    where "@" is the metadata marker.  Whitespace around the value is not
+//    included in the value span.  Returns false if the event is not
+//    a metadata key/value pair.
+//
+
+bool MidiRoll::parseMetadata(MidiEvent* event, std::string& key,
+		_MetadataEntry& entry) {
+	std::string content = event->getMetaContent();
+	const std::string& marker = m_metadatamarker;
+	if (content.compare(0, marker.size(), marker) != 0) {
+		return false;
+	}
+	size_t colon = content.find(':', marker.size());
+	if ((colon == std::string::npos) || (colon == marker.size())) {
+		return false;
+	}
+	key = content.substr(marker.size(), colon - marker.size());
+
+	size_t start = colon + 1;
+	size_t end = content.size();
+	while ((start < end) && isspace(content[start])) {
+		start++;
+	}
+	while ((end > start) && isspace(content[end-1])) {
+		end--;
+	}
+	entry.event  = event;
+	entry.start  = (int)start;
+	entry.length = (int)(end - start);
+	return true;
+}
+
+
+//////////////////////////////
+//
+// MidiRoll::loadAccelerationModel -- Read the acceleration model
+//    parameters from the metadata of the roll.  The model is ignored if
+//    the tempo messages in the first track are not its tempo steps,
+//    which happens when a program has changed the tempos without
+//    updating the metadata.
+//
+
+void MidiRoll::loadAccelerationModel(void) {
+	m_accelinches  = 0.0;
+	m_accelpercent = 0.0;
+	m_acceldirty   = false;
+	std::string step   = getMetadata(ACCELERATION_STEP_KEY);
+	std::string factor = getMetadata(ACCELERATION_PERCENT_KEY);
+	if (step.empty() || factor.empty()) {
+		return;
+	}
+	double inches  = strtod(step.c_str(), NULL);
+	double percent = strtod(factor.c_str(), NULL);
+	if ((inches <= 0.0) || (percent <= 0.0)) {
+		return;
+	}
+	m_accelinches  = inches;
+	m_accelpercent = percent;
+
+	std::vector<std::pair<int, int>> steps;
+	getAccelerationTempos(steps);
+	const MidiRoll& mr = *this;
+	const std::vector<MidiEvent*>& tempos =
+			mr[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	bool matchQ = tempos.size() == steps.size();
+	for (int i=0; matchQ && (i<(int)tempos.size()); i++) {
+		matchQ = (tempos[i]->tick == steps[i].first) &&
+				(tempos[i]->getTempoMicroseconds() == steps[i].second);
+	}
+	if (!matchQ) {
+		m_accelinches  = 0.0;
+		m_accelpercent = 0.0;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::getLastTick -- Return the largest absolute tick of the events
+//    in the roll.
+//
+
+int MidiRoll::getLastTick(void) const {
+	const MidiRoll& mr = *this;
+	int maxtick = 0;
+	for (int i=0; i<mr.getTrackCount(); i++) {
+		if ((mr[i].getEventCount() > 0) && (mr[i].back().tick > maxtick)) {
+			maxtick = mr[i].back().tick;
+		}
+	}
+	return maxtick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::removeTempoSteps -- Remove the tempo messages from the
+//    first track, leaving a tempo of 60 at tick 0.
+//
+
+void MidiRoll::removeTempoSteps(void) {
+	MidiRoll& mr = *this;
+	const std::vector<MidiEvent*>& tempos =
+			mr[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)tempos.size(); i++) {
+		tempos[i]->clear();
+	}
+	// Need to add tempo = 60 at tick 0
+	MidiFile::addTempo(0, 0, 60.0);
+	MidiFile::sortTrack(0);
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::trackerizeTrack -- Move the note-offs of a (sorted) track
+//     later by the tracker height, keeping the track sorted.  Each note-off
+//     is paired with the last unpaired note-on of its key, as in
+//     MidiEventList::linkNotePairs().  Moved note-offs wait in a queue
+//     until the events before them have been output; since they are all
+//     moved by the same amount, the queue stays in time order.  A waiting
+//     note-off is output early, at the tick of the next note-on of its
+//     key, if the note-on comes first.  Returns the earliest original tick
+//     of a moved note-off, or -1 if none were moved.
+//
+
+int MidiRoll::trackerizeTrack(MidiEventList& track, int trackerheight) {
+	std::vector<MidiEvent*> input(track.getEventCount());
+	for (int i=0; i<(int)input.size(); i++) {
+		input[i] = &track[i];
+	}
+	std::vector<MidiEvent*> output;
+	output.reserve(input.size());
+
+	// notes == note-ons waiting for their note-offs, by channel and key.
+	std::vector<std::vector<MidiEvent*>> notes(16 * 128);
+	// offs == moved note-offs not yet output, by channel and key.
+	std::vector<std::vector<MidiEvent*>> offs(16 * 128);
+	// pending == moved note-offs not yet output in time order (NULL when
+	// output early).
+	std::deque<MidiEvent*> pending;
+
+	// flush == output the moved note-offs which go before the event (all
+	// of them if the event is NULL).  At the same tick, they go in the
+	// order of MidiFile::sortTracks(), and before unmoved note-offs.
+	auto flush = [&](MidiEvent* event) {
+		while (!pending.empty()) {
+			MidiEvent* off = pending.front();
+			if (off && event) {
+				if (off->tick > event->tick) {
+					break;
+				}
+				if ((off->tick == event->tick) && !event->isNoteOff()
+						&& (eventcompare(&off, &event) >= 0)) {
+					break;
+				}
+			}
+			if (off) {
+				std::vector<MidiEvent*>& list = offs[off->getChannel() * 128
+						+ off->getKeyNumber()];
+				list.erase(std::find(list.begin(), list.end(), off));
+				output.push_back(off);
+			}
+			pending.pop_front();
+		}
+	};
+
+	int firsttick = -1;
+	for (int i=0; i<(int)input.size(); i++) {
+		MidiEvent* event = input[i];
+		flush(event);
+
+		if (event->isNoteOn()) {
+			int index = event->getChannel() * 128 + event->getKeyNumber();
+			// The hole is opened again before the moved note-off of the
+			// previous note, so end the previous note here (in sorted
+			// order among the events already output at this tick):
+			for (int j=0; j<(int)offs[index].size(); j++) {
+				MidiEvent* off = offs[index][j];
+				off->tick = event->tick;
+				insertInOrder(output, off);
+				*std::find(pending.begin(), pending.end(), off) = NULL;
+			}
+			offs[index].clear();
+			notes[index].push_back(event);
+			output.push_back(event);
+		} else if (event->isNoteOff()) {
+			int index = event->getChannel() * 128 + event->getKeyNumber();
+			if (notes[index].empty()) {
+				output.push_back(event);
+				continue;
+			}
+			notes[index].back()->linkEvent(event);
+			notes[index].pop_back();
+			if ((firsttick < 0) || (event->tick < firsttick)) {
+				firsttick = event->tick;
+			}
+			event->tick += trackerheight;
+			pending.push_back(event);
+			offs[index].push_back(event);
+		} else {
+			output.push_back(event);
+		}
+	}
+	flush(NULL);
+
+	track.detach();
+	for (int i=0; i<(int)output.size(); i++) {
+		track.push_back_no_copy(output[i]);
+	}
+
+	for (int i=0; i<(int)notes.size(); i++) {
+		for (int j=0; j<(int)notes[i].size(); j++) {
+			std::cerr << "MISSING NOTE OFF" << std::endl;
+		}
+	}
+	return firsttick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::insertInOrder -- Insert an event into a sorted list of
+//     events, after the events which go before it in the order of
+//     MidiFile::sortTracks().
+//
+
+void MidiRoll::insertInOrder(std::vector<MidiEvent*>& list, MidiEvent* event) {
+	int position = (int)list.size();
+	while ((position > 0) && (eventcompare(&event, &list[position-1]) < 0)) {
+		position--;
+	}
+	list.insert(list.begin() + position, event);
+}
+
+
+
+//////////////////////////////
+//
+// MidiRoll::applyRegisterSplits -- Move the notes to the track and
+//    channel of their register, given the first key of the bass-note,
+//    treble-note and treble-expression regions:
+//    track 0: no notes
+//    track 1: bass notes, channel 1
+//    track 2: treble notes, channel 2
+//    track 3: bass expression channel 0
+//    track 4: treble expression, channel 3
+//
+
+void MidiRoll::applyRegisterSplits(int bass, int treble, int trebleexp) {
+	// region:             bass-exp  bass  treble  treble-exp
+	int regiontrack[4]   = {3,       1,    2,      4};
+	int regionchannel[4] = {0,       1,    2,      3};
+
+	MidiRoll& mr = *this;
+	mr.joinTracks();
+	for (int i=0; i<mr.getTrackCount(); i++) {
+		MidiEventList& mel = mr[i];
+		for (int j=0; j<mel.getEventCount(); j++) {
+			MidiEvent* me = &mel[j];
+			if (!me->isNote()) {
+				continue;
+			}
+			int key = me->getKeyNumber();
+			int region = 3;
+			if (key < bass) {
+				region = 0;
+			} else if (key < treble) {
+				region = 1;
+			} else if (key < trebleexp) {
+				region = 2;
+			}
+			if (regionchannel[region] != me->getChannel()) {
+				me->setChannel(regionchannel[region]);
+			}
+			if (regiontrack[region] != me->track) {
+				me->track = regiontrack[region];
+			}
+		}
+	}
+	mr.splitTracks();
+	mr.sortTracks();
+}
+
+
+} // end smf namespace
+
+
+
+//////////////////////////////
+//
+// operator<< -- Print the roll in binasc format, including the tempo
+//    steps of any acceleration model.
+//
+
+std::ostream& operator<<(std::ostream& out, smf::MidiRoll& aRoll) {
+	aRoll.writeBinascWithComments(out);
+	return out;
+}
 
 
 
@@ -0,0 +1,436 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:04:34 PDT 2026
+// Last Modified: Sun Oct 18 18:43:21 PDT 2026
+// Filename:      midiroll/src/NoteIndex.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   An interval index of the linked notes in a MIDI roll,
+//                used to find which holes are open at a given tick or
+//                within a range of ticks.
+//
+//                A note occupies the ticks from its note-on up to (but
+//                not including) its note-off.  Each key has a list of
+//                notes in starting order along with a running maximum
+//                of their ending ticks, so a binary search finds the first
+//                candidate note on that key.  Notes on a single key do not
+//                normally overlap on a roll, so per-key queries take
+//                O(log n + k) time for k results.  Queries over all keys
+//                use a centered interval tree, which also takes
+//                O(log n + k) time.
+//
+
+#include "NoteIndex.h"
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// NoteIndex::NoteIndex -- Class constructor.
+//
+
+NoteIndex::NoteIndex(void) {
+	m_keynotes.resize(128);
+	m_keymaxend.resize(128);
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::~NoteIndex -- Class deconstructor.
+//
+
+NoteIndex::~NoteIndex() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::clear -- Remove all notes from the index.
+//
+
+void NoteIndex::clear(void) {
+	m_notes.clear();
+	for (int i=0; i<(int)m_keynotes.size(); i++) {
+		m_keynotes[i].clear();
+		m_keymaxend[i].clear();
+	}
+	m_nodes.clear();
+	m_bystart.clear();
+	m_byend.clear();
+	m_root = -1;
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::swap -- Exchange the contents of two indexes.
+//
+
+void NoteIndex::swap(NoteIndex& other) noexcept {
+	m_notes.swap(other.m_notes);
+	m_keynotes.swap(other.m_keynotes);
+	m_keymaxend.swap(other.m_keymaxend);
+	m_nodes.swap(other.m_nodes);
+	m_bystart.swap(other.m_bystart);
+	m_byend.swap(other.m_byend);
+	std::swap(m_root, other.m_root);
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::build -- Index the notes in a MIDI file.  Note-offs are
+//     paired with note-ons in each track in the same way as
+//     MidiFile::linkNotePairs() (so the MIDI file can be in a split or
+//     joined track state), but the links of the events are not changed,
+//     so that tracks shared with a fork are not copied.  Note-ons
+//     without a matching note-off are not indexed.  The index stores
+//     pointers to the MidiEvents in the file, so it must be rebuilt after
+//     events are added to or removed from the file, or after ticks
+//     change.
+//
+
+void NoteIndex::build(MidiFile& midifile) {
+	clear();
+
+	bool revertToDelta = false;
+	if (midifile.isDeltaTicks()) {
+		midifile.makeAbsoluteTicks();
+		revertToDelta = true;
+	}
+	const MidiFile& input = midifile;
+
+	// noteons == the unpaired notes for each channel and key (as indexes
+	// into m_notes), the last of which is paired with the next note-off.
+	std::vector<std::vector<int>> noteons(16 * 128);
+	for (int i=0; i<input.getTrackCount(); i++) {
+		const MidiEventList& track = input[i];
+		int first = (int)m_notes.size();
+		for (int j=0; j<track.getEventCount(); j++) {
+			MidiEvent* me = const_cast<MidiEvent*>(&track[j]);
+			if (me->isNoteOn()) {
+				NoteInterval note;
+				note.starttick = me->tick;
+				note.endtick   = me->tick;
+				note.key       = me->getKeyNumber();
+				note.channel   = me->getChannel();
+				note.track     = input.getSplitTrack(i, j);
+				note.noteon    = me;
+				note.noteoff   = NULL;
+				noteons[note.channel * 128 + note.key].push_back((int)m_notes.size());
+				m_notes.push_back(note);
+			} else if (me->isNoteOff()) {
+				std::vector<int>& active = noteons[me->getChannel() * 128
+						+ me->getKeyNumber()];
+				if (active.empty()) {
+					continue;
+				}
+				NoteInterval& note = m_notes[active.back()];
+				active.pop_back();
+				note.endtick = me->tick;
+				note.noteoff = me;
+			}
+		}
+		for (int k=0; k<(int)noteons.size(); k++) {
+			noteons[k].clear();
+		}
+		m_notes.erase(std::remove_if(m_notes.begin() + first, m_notes.end(),
+			[](const NoteInterval& note) -> bool {
+				return note.noteoff == NULL;
+			}), m_notes.end());
+	}
+
+	if (revertToDelta) {
+		midifile.makeDeltaTicks();
+	}
+
+	std::stable_sort(m_notes.begin(), m_notes.end(),
+		[](const NoteInterval& a, const NoteInterval& b) -> bool {
+			return a.starttick < b.starttick;
+		}
+	);
+
+	for (int i=0; i<(int)m_notes.size(); i++) {
+		int key = m_notes[i].key;
+		int last = getLastTick(i);
+		if (!m_keymaxend[key].empty() && (m_keymaxend[key].back() > last)) {
+			last = m_keymaxend[key].back();
+		}
+		m_keynotes[key].push_back(i);
+		m_keymaxend[key].push_back(last);
+	}
+
+	std::vector<int> items(m_notes.size());
+	for (int i=0; i<(int)items.size(); i++) {
+		items[i] = i;
+	}
+	m_bystart.reserve(m_notes.size());
+	m_byend.reserve(m_notes.size());
+	m_root = buildNode(items);
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::getNoteCount -- Return the number of indexed notes.
+//
+
+int NoteIndex::getNoteCount(void) const {
+	return (int)m_notes.size();
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::getNote -- Return an indexed note.  Notes are sorted
+//     by starting tick.
+//
+
+const NoteInterval& NoteIndex::getNote(int index) const {
+	return m_notes[index];
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::getSoundingNotes -- Return the notes which are sounding
+//     at the given tick.  If a key is given, then only search for notes
+//     on that key (and the notes are returned in starting order).  Notes
+//     for all keys are returned in no particular order.  Returns the
+//     number of notes found.
+//
+
+int NoteIndex::getSoundingNotes(std::vector<const NoteInterval*>& output,
+		int tick) const {
+	output.clear();
+	if (m_root >= 0) {
+		searchNode(output, m_root, tick, tick);
+	}
+	return (int)output.size();
+}
+
+
+int NoteIndex::getSoundingNotes(std::vector<const NoteInterval*>& output,
+		int key, int tick) const {
+	output.clear();
+	searchKey(output, key, tick, tick);
+	return (int)output.size();
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::getNotesInRange -- Return the notes which are sounding
+//     at any point from starttick up to (but not including) endtick.
+//     If a key is given, then only search for notes on that key (and the
+//     notes are returned in starting order).  Notes for all keys are
+//     returned in no particular order.  Returns the number of notes found.
+//
+
+int NoteIndex::getNotesInRange(std::vector<const NoteInterval*>& output,
+		int starttick, int endtick) const {
+	output.clear();
+	if (endtick <= starttick) {
+		return 0;
+	}
+	if (m_root >= 0) {
+		searchNode(output, m_root, starttick, endtick - 1);
+	}
+	return (int)output.size();
+}
+
+
+int NoteIndex::getNotesInRange(std::vector<const NoteInterval*>& output,
+		int key, int starttick, int endtick) const {
+	output.clear();
+	if (endtick <= starttick) {
+		return 0;
+	}
+	searchKey(output, key, starttick, endtick - 1);
+	return (int)output.size();
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// NoteIndex::getFirstTick -- Return the first tick occupied by a note.
+//
+
+int NoteIndex::getFirstTick(int index) const {
+	return m_notes[index].starttick;
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::getLastTick -- Return the last tick occupied by a note.
+//     Zero-length notes occupy their starting tick.
+//
+
+int NoteIndex::getLastTick(int index) const {
+	const NoteInterval& note = m_notes[index];
+	if (note.endtick > note.starttick) {
+		return note.endtick - 1;
+	}
+	return note.starttick;
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::buildNode -- Build a node of the interval tree for the given
+//     notes, returning the index of the node (or -1 if there are no notes).
+//     The center of the node is the median of the note endpoints, so at
+//     most half of the notes go to each child node.
+//
+
+int NoteIndex::buildNode(std::vector<int>& items) {
+	if (items.empty()) {
+		return -1;
+	}
+
+	std::vector<int> endpoints;
+	endpoints.reserve(items.size() * 2);
+	for (int i=0; i<(int)items.size(); i++) {
+		endpoints.push_back(getFirstTick(items[i]));
+		endpoints.push_back(getLastTick(items[i]));
+	}
+	int middle = (int)endpoints.size() / 2;
+	std::nth_element(endpoints.begin(), endpoints.begin() + middle,
+			endpoints.end());
+	int center = endpoints[middle];
+
+	std::vector<int> before;
+	std::vector<int> after;
+	std::vector<int> here;
+	for (int i=0; i<(int)items.size(); i++) {
+		if (getLastTick(items[i]) < center) {
+			before.push_back(items[i]);
+		} else if (getFirstTick(items[i]) > center) {
+			after.push_back(items[i]);
+		} else {
+			here.push_back(items[i]);
+		}
+	}
+	items.clear();
+
+	int node = (int)m_nodes.size();
+	m_nodes.resize(node + 1);
+	m_nodes[node].center = center;
+	m_nodes[node].begin  = (int)m_bystart.size();
+	m_nodes[node].count  = (int)here.size();
+
+	// items are in m_notes order, so already sorted by first tick:
+	m_bystart.insert(m_bystart.end(), here.begin(), here.end());
+	std::stable_sort(here.begin(), here.end(),
+		[this](int a, int b) -> bool {
+			return getLastTick(a) > getLastTick(b);
+		}
+	);
+	m_byend.insert(m_byend.end(), here.begin(), here.end());
+
+	int left = buildNode(before);
+	int right = buildNode(after);
+	m_nodes[node].left = left;
+	m_nodes[node].right = right;
+	return node;
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::searchNode -- Find notes in the interval tree which occupy
+//     any tick from first to last (inclusive).
+//
+
+void NoteIndex::searchNode(std::vector<const NoteInterval*>& output,
+		int node, int first, int last) const {
+	while (node >= 0) {
+		const _IntervalNode& nd = m_nodes[node];
+		if (last < nd.center) {
+			// All notes in the node end at or after the center, so only
+			// their starting ticks need to be checked.
+			for (int i=nd.begin; i<nd.begin+nd.count; i++) {
+				if (getFirstTick(m_bystart[i]) > last) {
+					break;
+				}
+				output.push_back(&m_notes[m_bystart[i]]);
+			}
+			node = nd.left;
+		} else if (first > nd.center) {
+			// All notes in the node start at or before the center, so only
+			// their ending ticks need to be checked.
+			for (int i=nd.begin; i<nd.begin+nd.count; i++) {
+				if (getLastTick(m_byend[i]) < first) {
+					break;
+				}
+				output.push_back(&m_notes[m_byend[i]]);
+			}
+			node = nd.right;
+		} else {
+			// The center is in the query range, so all notes overlap.
+			for (int i=nd.begin; i<nd.begin+nd.count; i++) {
+				output.push_back(&m_notes[m_bystart[i]]);
+			}
+			searchNode(output, nd.left, first, last);
+			node = nd.right;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// NoteIndex::searchKey -- Find notes on a key which occupy any tick
+//     from first to last (inclusive).
+//
+
+void NoteIndex::searchKey(std::vector<const NoteInterval*>& output,
+		int key, int first, int last) const {
+	if ((key < 0) || (key >= (int)m_keynotes.size())) {
+		return;
+	}
+	const std::vector<int>& notes = m_keynotes[key];
+	const std::vector<int>& maxend = m_keymaxend[key];
+	int start = int(std::lower_bound(maxend.begin(), maxend.end(), first)
+			- maxend.begin());
+	for (int i=start; i<(int)notes.size(); i++) {
+		if (getFirstTick(notes[i]) > last) {
+			break;
+		}
+		if (getLastTick(notes[i]) >= first) {
+			output.push_back(&m_notes[notes[i]]);
+		}
+	}
+}
+
+
+} // end smf namespace
+
+
+
@@ -0,0 +1,623 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:11:07 PDT 2026
+// Last Modified: Sun Oct 18 17:11:07 PDT 2026
+// Filename:      midiroll/src/RollAccumulator.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Statistics which are collected separately for groups of
+//                files and then merged into a single result.
+//
+//                Each accumulator can make an empty copy of itself with
+//                the same settings (for another thread to fill in), and
+//                can merge another accumulator of the same type into
+//                itself.  Merging only adds counts together or compares
+//                values, so the merged result does not depend on the
+//                order in which the groups were merged:
+//
+//                   RollHistogram  Counts of integer values in a range,
+//                                  such as the gaps between holes.
+//                   RollCounts     Counts for a list of indexes, such as
+//                                  notes for each key number.
+//                   RollRange      Minimum and maximum values.
+//                   RollQuantiles  Approximate quantiles (median, etc.) of
+//                                  a large number of values, where each
+//                                  quantile is within a given relative
+//                                  error of the exact value.
+//
+
+#include "RollAccumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollHistogram::RollHistogram -- Class constructor.  Values from the
+//     minimum to the maximum (inclusive) are counted separately.  Values
+//     outside of that range are only counted as underflow or overflow.
+//
+
+RollHistogram::RollHistogram(int minimum, int maximum) {
+	if (maximum < minimum) {
+		maximum = minimum;
+	}
+	m_minimum = minimum;
+	m_bins.resize(maximum - minimum + 1, 0);
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::makeEmpty -- Return a new histogram with the same range
+//     and no counts.  The caller must delete it.
+//
+
+RollAccumulator* RollHistogram::makeEmpty(void) const {
+	return new RollHistogram(getMinimum(), getMaximum());
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::merge -- Add the counts of another histogram.  Counts
+//     in the other histogram which are outside of this range are added to
+//     the underflow or overflow.
+//
+
+void RollHistogram::merge(const RollAccumulator& other) {
+	const RollHistogram* histogram = dynamic_cast<const RollHistogram*>(&other);
+	if (histogram == NULL) {
+		return;
+	}
+	if ((histogram->getMinimum() == getMinimum())
+			&& (histogram->getMaximum() == getMaximum())) {
+		for (int i=0; i<(int)m_bins.size(); i++) {
+			m_bins[i] += histogram->m_bins[i];
+		}
+	} else {
+		for (int i=0; i<(int)histogram->m_bins.size(); i++) {
+			add(histogram->m_minimum + i, histogram->m_bins[i]);
+		}
+	}
+	m_underflow += histogram->m_underflow;
+	m_overflow  += histogram->m_overflow;
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::clear -- Set all counts to zero.
+//
+
+void RollHistogram::clear(void) {
+	std::fill(m_bins.begin(), m_bins.end(), 0);
+	m_underflow = 0;
+	m_overflow  = 0;
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::add -- Count a value (one or more times).
+//
+
+void RollHistogram::add(int value, long long count) {
+	if (count == 0) {
+		return;
+	}
+	if (value < getMinimum()) {
+		m_underflow += count;
+	} else if (value > getMaximum()) {
+		m_overflow += count;
+	} else {
+		m_bins[value - m_minimum] += count;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::getCount -- Return the number of times that a value
+//     was added.  Returns 0 for values outside of the range.
+//
+
+long long RollHistogram::getCount(int value) const {
+	if ((value < getMinimum()) || (value > getMaximum())) {
+		return 0;
+	}
+	return m_bins[value - m_minimum];
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::getMinimum -- Return the smallest value in the range.
+//
+
+int RollHistogram::getMinimum(void) const {
+	return m_minimum;
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::getMaximum -- Return the largest value in the range.
+//
+
+int RollHistogram::getMaximum(void) const {
+	return m_minimum + (int)m_bins.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::getTotal -- Return the number of values in the range.
+//
+
+long long RollHistogram::getTotal(void) const {
+	long long sum = 0;
+	for (int i=0; i<(int)m_bins.size(); i++) {
+		sum += m_bins[i];
+	}
+	return sum;
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::getUnderflow -- Return the number of values below the
+//     range.
+//
+
+long long RollHistogram::getUnderflow(void) const {
+	return m_underflow;
+}
+
+
+
+//////////////////////////////
+//
+// RollHistogram::getOverflow -- Return the number of values above the
+//     range.
+//
+
+long long RollHistogram::getOverflow(void) const {
+	return m_overflow;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// RollCounts::RollCounts -- Class constructor.  The size is the number
+//     of separate counts, such as 128 for counting each key number.
+//
+
+RollCounts::RollCounts(int size) {
+	if (size < 1) {
+		size = 1;
+	}
+	m_counts.resize(size, 0);
+}
+
+
+
+//////////////////////////////
+//
+// RollCounts::makeEmpty -- Return a new set of counts with the same size
+//     and all counts set to zero.  The caller must delete it.
+//
+
+RollAccumulator* RollCounts::makeEmpty(void) const {
+	return new RollCounts(getSize());
+}
+
+
+
+//////////////////////////////
+//
+// RollCounts::merge -- Add the counts of another set of counts (only the
+//     indexes which are in both are added).
+//
+
+void RollCounts::merge(const RollAccumulator& other) {
+	const RollCounts* counts = dynamic_cast<const RollCounts*>(&other);
+	if (counts == NULL) {
+		return;
+	}
+	int size = std::min(getSize(), counts->getSize());
+	for (int i=0; i<size; i++) {
+		m_counts[i] += counts->m_counts[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollCounts::clear -- Set all counts to zero.
+//
+
+void RollCounts::clear(void) {
+	std::fill(m_counts.begin(), m_counts.end(), 0);
+}
+
+
+
+//////////////////////////////
+//
+// RollCounts::add -- Add to the count at the given index.  Indexes
+//     outside of the size are ignored.
+//
+
+void RollCounts::add(int index, long long count) {
+	if ((index < 0) || (index >= getSize())) {
+		return;
+	}
+	m_counts[index] += count;
+}
+
+
+
+//////////////////////////////
+//
+// RollCounts::getCount -- Return the count at the given index.
+//
+
+long long RollCounts::getCount(int index) const {
+	if ((index < 0) || (index >= getSize())) {
+		return 0;
+	}
+	return m_counts[index];
+}
+
+
+
+//////////////////////////////
+//
+// RollCounts::getSize -- Return the number of separate counts.
+//
+
+int RollCounts::getSize(void) const {
+	return (int)m_counts.size();
+}
+
+
+
+//////////////////////////////
+//
+// RollCounts::getTotal -- Return the sum of all counts.
+//
+
+long long RollCounts::getTotal(void) const {
+	long long sum = 0;
+	for (int i=0; i<(int)m_counts.size(); i++) {
+		sum += m_counts[i];
+	}
+	return sum;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// RollRange::RollRange -- Class constructor.
+//
+
+RollRange::RollRange(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::makeEmpty -- Return a new empty range.  The caller must
+//     delete it.
+//
+
+RollAccumulator* RollRange::makeEmpty(void) const {
+	return new RollRange;
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::merge -- Extend the range to include another range.
+//
+
+void RollRange::merge(const RollAccumulator& other) {
+	const RollRange* range = dynamic_cast<const RollRange*>(&other);
+	if ((range == NULL) || range->isEmpty()) {
+		return;
+	}
+	m_minimum = std::min(m_minimum, range->m_minimum);
+	m_maximum = std::max(m_maximum, range->m_maximum);
+	m_count  += range->m_count;
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::clear -- Remove all values from the range.
+//
+
+void RollRange::clear(void) {
+	m_minimum = std::numeric_limits<double>::infinity();
+	m_maximum = -std::numeric_limits<double>::infinity();
+	m_count   = 0;
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::add -- Extend the range to include the value.
+//
+
+void RollRange::add(double value) {
+	m_minimum = std::min(m_minimum, value);
+	m_maximum = std::max(m_maximum, value);
+	m_count++;
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::isEmpty -- Return true if no values have been added.
+//
+
+bool RollRange::isEmpty(void) const {
+	return m_count == 0;
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::getMinimum -- Return the smallest value added (infinity
+//     if empty).
+//
+
+double RollRange::getMinimum(void) const {
+	return m_minimum;
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::getMaximum -- Return the largest value added (-infinity
+//     if empty).
+//
+
+double RollRange::getMaximum(void) const {
+	return m_maximum;
+}
+
+
+
+//////////////////////////////
+//
+// RollRange::getCount -- Return the number of values added.
+//
+
+long long RollRange::getCount(void) const {
+	return m_count;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// RollQuantiles::RollQuantiles -- Class constructor.  The accuracy is
+//     the largest relative error of a quantile: 0.01 means that a median
+//     of 100.0 will be reported between 99.0 and 101.0.  Values are
+//     counted in buckets whose edges increase geometrically, so memory
+//     grows with the logarithm of the range of values rather than the
+//     number of values.
+//
+
+RollQuantiles::RollQuantiles(double accuracy) {
+	if ((accuracy <= 0.0) || (accuracy >= 1.0)) {
+		accuracy = 0.01;
+	}
+	m_accuracy = accuracy;
+	m_gamma = (1.0 + accuracy) / (1.0 - accuracy);
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::makeEmpty -- Return a new sketch with the same accuracy
+//     and no values.  The caller must delete it.
+//
+
+RollAccumulator* RollQuantiles::makeEmpty(void) const {
+	return new RollQuantiles(m_accuracy);
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::merge -- Add the values of another sketch.  If the other
+//     sketch has a different accuracy, its buckets are added as values,
+//     so the merged accuracy is the sum of the two accuracies.
+//
+
+void RollQuantiles::merge(const RollAccumulator& other) {
+	const RollQuantiles* sketch = dynamic_cast<const RollQuantiles*>(&other);
+	if (sketch == NULL) {
+		return;
+	}
+	if (sketch->m_accuracy == m_accuracy) {
+		for (auto& it : sketch->m_positive) {
+			m_positive[it.first] += it.second;
+		}
+		for (auto& it : sketch->m_negative) {
+			m_negative[it.first] += it.second;
+		}
+		m_zero  += sketch->m_zero;
+		m_count += sketch->m_count;
+	} else {
+		for (auto& it : sketch->m_positive) {
+			add(sketch->getBucketValue(it.first), it.second);
+		}
+		for (auto& it : sketch->m_negative) {
+			add(-sketch->getBucketValue(it.first), it.second);
+		}
+		add(0.0, sketch->m_zero);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::clear -- Remove all values.
+//
+
+void RollQuantiles::clear(void) {
+	m_positive.clear();
+	m_negative.clear();
+	m_zero  = 0;
+	m_count = 0;
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::add -- Add a value (one or more times).
+//
+
+void RollQuantiles::add(double value, long long count) {
+	if (count <= 0) {
+		return;
+	}
+	if (value > 0.0) {
+		m_positive[getBucket(value)] += count;
+	} else if (value < 0.0) {
+		m_negative[getBucket(-value)] += count;
+	} else {
+		m_zero += count;
+	}
+	m_count += count;
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::getQuantile -- Return the value below which the given
+//     fraction of the values lie: 0.5 for the median, 0.0 for the
+//     minimum and 1.0 for the maximum.  Returns 0.0 if there are no
+//     values.
+//
+
+double RollQuantiles::getQuantile(double fraction) const {
+	if (m_count == 0) {
+		return 0.0;
+	}
+	if (fraction < 0.0) {
+		fraction = 0.0;
+	} else if (fraction > 1.0) {
+		fraction = 1.0;
+	}
+	long long rank = (long long)(fraction * (m_count - 1));
+	long long sum = 0;
+	for (auto it = m_negative.rbegin(); it != m_negative.rend(); it++) {
+		sum += it->second;
+		if (sum > rank) {
+			return -getBucketValue(it->first);
+		}
+	}
+	sum += m_zero;
+	if (sum > rank) {
+		return 0.0;
+	}
+	for (auto& it : m_positive) {
+		sum += it.second;
+		if (sum > rank) {
+			return getBucketValue(it.first);
+		}
+	}
+	return 0.0;
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::getAccuracy -- Return the largest relative error of a
+//     quantile.
+//
+
+double RollQuantiles::getAccuracy(void) const {
+	return m_accuracy;
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::getCount -- Return the number of values added.
+//
+
+long long RollQuantiles::getCount(void) const {
+	return m_count;
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::getBucket -- Return the bucket for a positive value.
+//
+
+int RollQuantiles::getBucket(double value) const {
+	return (int)std::ceil(std::log(value) / std::log(m_gamma));
+}
+
+
+
+//////////////////////////////
+//
+// RollQuantiles::getBucketValue -- Return the value reported for a bucket,
+//     which is within the accuracy of every value in the bucket.
+//
+
+double RollQuantiles::getBucketValue(int bucket) const {
+	return 2.0 * std::pow(m_gamma, bucket) / (m_gamma + 1.0);
+}
+
+
+} // end smf namespace
+
+
+
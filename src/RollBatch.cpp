@@ -0,0 +1,336 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:07:19 PDT 2026
+// Last Modified: Sun Oct 18 19:32:11 PDT 2026
+// Filename:      midiroll/src/RollBatch.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Apply a change to many MIDI roll files in place, using
+//                several threads.
+//
+//                Each file is read into its own MidiRoll, given to the
+//                change function, and written back to the same filename
+//                if the function returns true.  Files are started largest
+//                first, and each thread takes the next file when it is
+//                done with its current one, so that a large file at the
+//                end of the list does not keep one thread busy after the
+//                others have finished.  A file which cannot be read,
+//                changed or written is listed as a failure without
+//                stopping the other files, and the failures are printed
+//                to standard error at the end of the run.
+//
+
+#include "RollBatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <sys/stat.h>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollBatch::RollBatch -- Class constructor.
+//
+
+RollBatch::RollBatch(void) { }
+
+
+
+//////////////////////////////
+//
+// RollBatch::~RollBatch -- Class deconstructor.
+//
+
+RollBatch::~RollBatch() { }
+
+
+
+//////////////////////////////
+//
+// RollBatch::setThreadCount -- Set the number of files processed at the
+//     same time.  A count of 0 (the default) uses one thread per processor
+//     core.
+//
+
+void RollBatch::setThreadCount(int count) {
+	m_threads = count < 0 ? 0 : count;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::getThreadCount -- Return the number of files processed at
+//     the same time (0 for one per processor core).
+//
+
+int RollBatch::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::setProgress -- Print the name of each file as it is finished
+//     and a summary of the run to standard error.
+//
+
+void RollBatch::setProgress(bool state) {
+	m_progress = state;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::getProgress -- Return true if progress is printed.
+//
+
+bool RollBatch::getProgress(void) const {
+	return m_progress;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::setWrite -- Write each file back after it has been changed
+//     (the default).  Set to false to only read the files, such as when
+//     the function collects information about them.
+//
+
+void RollBatch::setWrite(bool state) {
+	m_write = state;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::getWrite -- Return true if files are written back.
+//
+
+bool RollBatch::getWrite(void) const {
+	return m_write;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::run -- Read each file, apply the function to it, and write
+//     the result back to the file if the function returns true (a file
+//     is listed as failed if the function returns false).  Nothing is
+//     written if setWrite(false) was called.  The
+//     function is called from several threads at once (each time with a
+//     different roll), so it must not change any shared data.  Returns
+//     the number of files which failed.
+//
+
+int RollBatch::run(const std::vector<std::string>& filenames,
+		const std::function<bool(MidiRoll&)>& function) {
+	auto starttime = std::chrono::steady_clock::now();
+	m_filecount = (int)filenames.size();
+	m_failures.clear();
+	m_bytes = 0;
+
+	// largest files first:
+	std::vector<std::pair<long long, int>> order(filenames.size());
+	for (int i=0; i<(int)filenames.size(); i++) {
+		struct stat buffer;
+		long long size = 0;
+		if (stat(filenames[i].c_str(), &buffer) == 0) {
+			size = (long long)buffer.st_size;
+		}
+		order[i] = std::make_pair(-size, i);
+		m_bytes += size;
+	}
+	std::sort(order.begin(), order.end());
+
+	int threads = m_threads;
+	if (threads == 0) {
+		threads = (int)std::thread::hardware_concurrency();
+	}
+	if (threads > m_filecount) {
+		threads = m_filecount;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	// The files already use all of the threads, so process the tracks
+	// of each file one at a time:
+	int trackthreads = threads > 1 ? 1 : 0;
+
+	std::vector<std::string> reasons(filenames.size());
+	std::atomic<int> next(0);
+	std::atomic<int> finished(0);
+	std::mutex outputmutex;
+	auto worker = [&]() {
+		int index;
+		while ((index = next.fetch_add(1)) < m_filecount) {
+			int file = order[index].second;
+			reasons[file] = processFile(filenames[file], function, trackthreads);
+			int count = ++finished;
+			if (m_progress) {
+				std::lock_guard<std::mutex> lock(outputmutex);
+				std::cerr << "[" << count << "/" << m_filecount << "] "
+				          << filenames[file]
+				          << (reasons[file].empty() ? "" : " FAILED") << std::endl;
+			}
+		}
+	};
+	std::vector<std::thread> workers;
+	for (int i=1; i<threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	// failures in the order of the input list:
+	for (int i=0; i<(int)filenames.size(); i++) {
+		if (!reasons[i].empty()) {
+			m_failures.push_back(filenames[i] + ": " + reasons[i]);
+			std::cerr << "Error: " << m_failures.back() << std::endl;
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now()
+			- starttime;
+	m_seconds = elapsed.count();
+	if (m_progress) {
+		printSummary();
+	}
+	return (int)m_failures.size();
+}
+
+//
+// Options version of run(): process the files given as arguments on
+// the command line.
+//
+
+int RollBatch::run(Options& options,
+		const std::function<bool(MidiRoll&)>& function) {
+	std::vector<std::string> filenames;
+	for (int i=0; i<options.getArgCount(); i++) {
+		filenames.push_back(options.getArg(i+1));
+	}
+	return run(filenames, function);
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::getFileCount -- Return the number of files in the last run.
+//
+
+int RollBatch::getFileCount(void) const {
+	return m_filecount;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::getFailureCount -- Return the number of files which failed
+//     in the last run.
+//
+
+int RollBatch::getFailureCount(void) const {
+	return (int)m_failures.size();
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::getFailures -- Return the files which failed in the last
+//     run, each as "filename: reason".
+//
+
+const std::vector<std::string>& RollBatch::getFailures(void) const {
+	return m_failures;
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::getSeconds -- Return the duration of the last run.
+//
+
+double RollBatch::getSeconds(void) const {
+	return m_seconds;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollBatch::processFile -- Read, change and write one file, using
+//     trackthreads threads for its tracks (see MidiFile::setThreadCount()).
+//     Returns the reason for a failure, or an empty string if successful.
+//
+
+std::string RollBatch::processFile(const std::string& filename,
+		const std::function<bool(MidiRoll&)>& function, int trackthreads) {
+	MidiRoll midiroll;
+	midiroll.setThreadCount(trackthreads);
+	try {
+		if (!midiroll.read(filename)) {
+			return "cannot read file";
+		}
+		if (!function(midiroll)) {
+			return "cannot change file";
+		}
+		if (m_write && !midiroll.write(filename)) {
+			return "cannot write file";
+		}
+	} catch (const std::exception& error) {
+		return error.what();
+	}
+	return "";
+}
+
+
+
+//////////////////////////////
+//
+// RollBatch::printSummary -- Print the throughput of the last run to
+//     standard error.
+//
+
+void RollBatch::printSummary(void) const {
+	double seconds = m_seconds > 0.0 ? m_seconds : 1.0e-9;
+	std::cerr << "Processed " << m_filecount << " files";
+	if (!m_failures.empty()) {
+		std::cerr << " (" << m_failures.size() << " failed)";
+	}
+	std::cerr << " in " << m_seconds << " seconds: "
+	          << m_filecount / seconds << " files/second, "
+	          << m_bytes / seconds / 1.0e6 << " MB/second" << std::endl;
+}
+
+
+} // end smf namespace
+
+
+
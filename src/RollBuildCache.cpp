@@ -0,0 +1,399 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:35:58 PDT 2026
+// Last Modified: Sun Oct 18 18:38:48 PDT 2026
+// Filename:      midiroll/src/RollBuildCache.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Store the results of processing MIDI rolls in a
+//                directory, found by a hash of the input file and the
+//                processing done to it, so that unchanged inputs do not
+//                have to be processed again.
+//
+//                The key of a result is the SHA-256 hash of the recipe
+//                (a description of the processing, such as a pipeline
+//                string), ROLL_BUILD_VERSION and the bytes of the input
+//                file.  The result is stored as a MIDI file named by the
+//                key in the cache directory:
+//
+//                   directory/ab/abcdef0123...mid
+//
+//                Since the file contents are hashed rather than their
+//                modification times, copying or touching an input does
+//                not cause it to be processed again.  A file which was
+//                replaced by its result is a new input, so applying the
+//                same recipe to it in place again processes it again, as
+//                it would without the cache.  Results are written
+//                to a temporary file and renamed, so several processes
+//                can share a cache directory.  Nothing is ever removed
+//                from the cache; delete the directory to empty it.
+//
+
+#include "RollBuildCache.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollBuildCache::RollBuildCache -- Class constructors.
+//
+
+RollBuildCache::RollBuildCache(void) { }
+
+RollBuildCache::RollBuildCache(const std::string& directory) {
+	setDirectory(directory);
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::~RollBuildCache -- Class deconstructor.
+//
+
+RollBuildCache::~RollBuildCache() { }
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::setDirectory -- Set the directory containing the
+//     results.  It is created when the first result is stored.
+//
+
+void RollBuildCache::setDirectory(const std::string& directory) {
+	m_directory = directory;
+	while ((m_directory.size() > 1) && (m_directory.back() == '/')) {
+		m_directory.pop_back();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::getDirectory -- Return the directory containing the
+//     results.
+//
+
+const std::string& RollBuildCache::getDirectory(void) const {
+	return m_directory;
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::build -- Make the output file from the input file with
+//     the function, or copy the result from the cache if the same input
+//     was already processed with the same recipe.  The output file is not
+//     rewritten if it already contains the result.  The hit variable is
+//     set to true if the result came from the cache.  Returns false if
+//     the input cannot be read, the function returns false, or the output
+//     cannot be written.
+//
+
+bool RollBuildCache::build(const std::string& infile, const std::string& outfile,
+		const std::string& recipe, const std::function<bool(MidiRoll&)>& function,
+		bool* hit) {
+	if (hit) {
+		*hit = false;
+	}
+	std::string input;
+	if (!readFile(infile, input)) {
+		std::cerr << "Error: cannot read " << infile << std::endl;
+		return false;
+	}
+
+	std::string key = getKey(input, recipe);
+	std::string output;
+	if (fetch(key, output)) {
+		m_hits++;
+		if (hit) {
+			*hit = true;
+		}
+	} else {
+		m_misses++;
+		MidiRoll roll;
+		std::stringstream instream(input);
+		if (!roll.read(instream)) {
+			std::cerr << "Error: cannot parse " << infile << std::endl;
+			return false;
+		}
+		if (!function(roll)) {
+			return false;
+		}
+		std::stringstream outstream;
+		if (!roll.write(outstream)) {
+			return false;
+		}
+		output = outstream.str();
+		if (!store(key, output)) {
+			std::cerr << "Warning: cannot store result in " << m_directory << std::endl;
+		}
+	}
+
+	std::string existing;
+	if (readFile(outfile, existing) && (existing == output)) {
+		return true;
+	}
+	if (!writeFile(outfile, output)) {
+		std::cerr << "Error: cannot write " << outfile << std::endl;
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::getKey -- Return the key of a result (as hexadecimal
+//     digits) for the contents of an input file and a recipe.
+//
+
+std::string RollBuildCache::getKey(const std::string& input,
+		const std::string& recipe) const {
+	std::string data = recipe;
+	data += '\n';
+	data += ROLL_BUILD_VERSION;
+	data += '\n';
+	data += input;
+	return sha256(data);
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::fetch -- Read the result with the given key.  Returns
+//     false if it is not in the cache.
+//
+
+bool RollBuildCache::fetch(const std::string& key, std::string& output) const {
+	if (m_directory.empty()) {
+		return false;
+	}
+	return readFile(getPath(key), output);
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::store -- Add a result to the cache.  Returns false if
+//     it cannot be written.
+//
+
+bool RollBuildCache::store(const std::string& key, const std::string& output) const {
+	if (m_directory.empty()) {
+		return false;
+	}
+	makeDirectory(key);
+	return writeFile(getPath(key), output);
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::getHits -- Return the number of results copied from the
+//     cache by build().
+//
+
+int RollBuildCache::getHits(void) const {
+	return m_hits;
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::getMisses -- Return the number of results which build()
+//     had to make.
+//
+
+int RollBuildCache::getMisses(void) const {
+	return m_misses;
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::sha256 -- Return the SHA-256 hash of the data as 64
+//     hexadecimal digits.
+//
+
+std::string RollBuildCache::sha256(const std::string& data) {
+	static const uint32_t k[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+		0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+		0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+		0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+		0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+		0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+		0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+		0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+		0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+	uint32_t h[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	auto rotate = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+	// padding: a 1 bit, zeros, and the length in bits (64-bit big-endian):
+	std::string message = data;
+	uint64_t bits = (uint64_t)data.size() * 8;
+	message += (char)0x80;
+	while (message.size() % 64 != 56) {
+		message += (char)0x00;
+	}
+	for (int i=7; i>=0; i--) {
+		message += (char)((bits >> (i * 8)) & 0xff);
+	}
+
+	uint32_t w[64];
+	for (size_t block=0; block<message.size(); block+=64) {
+		const unsigned char* p = (const unsigned char*)message.data() + block;
+		for (int i=0; i<16; i++) {
+			w[i] = ((uint32_t)p[i*4] << 24) | ((uint32_t)p[i*4+1] << 16)
+					| ((uint32_t)p[i*4+2] << 8) | (uint32_t)p[i*4+3];
+		}
+		for (int i=16; i<64; i++) {
+			uint32_t s0 = rotate(w[i-15], 7) ^ rotate(w[i-15], 18) ^ (w[i-15] >> 3);
+			uint32_t s1 = rotate(w[i-2], 17) ^ rotate(w[i-2], 19) ^ (w[i-2] >> 10);
+			w[i] = w[i-16] + s0 + w[i-7] + s1;
+		}
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+		uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+		for (int i=0; i<64; i++) {
+			uint32_t s1 = rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25);
+			uint32_t choice = (e & f) ^ (~e & g);
+			uint32_t temp1 = hh + s1 + choice + k[i] + w[i];
+			uint32_t s0 = rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22);
+			uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+			uint32_t temp2 = s0 + majority;
+			hh = g;
+			g = f;
+			f = e;
+			e = d + temp1;
+			d = c;
+			c = b;
+			b = a;
+			a = temp1 + temp2;
+		}
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+		h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+	}
+
+	static const char* digits = "0123456789abcdef";
+	std::string output;
+	for (int i=0; i<8; i++) {
+		for (int j=28; j>=0; j-=4) {
+			output += digits[(h[i] >> j) & 0x0f];
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::readFile -- Read the bytes of a file.  Returns false
+//     if the file cannot be read.
+//
+
+bool RollBuildCache::readFile(const std::string& filename, std::string& contents) {
+	std::ifstream input(filename, std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << input.rdbuf();
+	contents = buffer.str();
+	return !input.bad();
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::writeFile -- Write the bytes of a file through a
+//     temporary file, so that readers never see a partial file.  Returns
+//     false if the file cannot be written.
+//
+
+bool RollBuildCache::writeFile(const std::string& filename,
+		const std::string& contents) {
+	static std::atomic<int> counter(0);
+	std::string temporary = filename + ".tmp" + std::to_string(getpid())
+			+ "-" + std::to_string(counter++);
+	{
+		std::ofstream output(temporary, std::ios::out | std::ios::binary);
+		if (!output.is_open()) {
+			return false;
+		}
+		output.write(contents.data(), contents.size());
+		if (!output.good()) {
+			output.close();
+			unlink(temporary.c_str());
+			return false;
+		}
+	}
+	if (rename(temporary.c_str(), filename.c_str()) != 0) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollBuildCache::getPath -- Return the filename of a result in the cache.
+//
+
+std::string RollBuildCache::getPath(const std::string& key) const {
+	return m_directory + "/" + key.substr(0, 2) + "/" + key + ".mid";
+}
+
+
+
+//////////////////////////////
+//
+// RollBuildCache::makeDirectory -- Create the cache directory and the
+//     subdirectory for the key if they do not exist.
+//
+
+void RollBuildCache::makeDirectory(const std::string& key) const {
+	mkdir(m_directory.c_str(), 0755);
+	mkdir((m_directory + "/" + key.substr(0, 2)).c_str(), 0755);
+}
+
+
+} // end smf namespace
+
+
+
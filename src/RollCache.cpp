@@ -0,0 +1,297 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:31:09 PDT 2026
+// Last Modified: Sun Oct 18 17:31:09 PDT 2026
+// Filename:      midiroll/src/RollCache.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Keep recently used MIDI rolls in memory, so that they
+//                do not have to be read and parsed again.
+//
+//                Rolls are found by filename.  The modification time and
+//                size of the file are checked each time a roll is
+//                requested, and the file is read again if either has
+//                changed.  The total memory used by the rolls is limited
+//                by removing the least recently used rolls.  Rolls are
+//                returned as shared pointers, so a roll removed from the
+//                cache stays valid for anyone still using it.
+//
+
+#include "RollCache.h"
+
+#include <sys/stat.h>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollCache::RollCache -- Class constructor.  The maximum bytes is the
+//     estimated memory that the rolls can use (default ROLL_CACHE_BYTES).
+//
+
+RollCache::RollCache(long long maxbytes) {
+	m_maxbytes = maxbytes;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::~RollCache -- Class deconstructor.
+//
+
+RollCache::~RollCache() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::get -- Return the roll for a file, reading the file if it is
+//     not in the cache or has changed since it was read.  Returns NULL if
+//     the file cannot be read.
+//
+
+std::shared_ptr<CachedRoll> RollCache::get(const std::string& filename) {
+	struct stat buffer;
+	if (stat(filename.c_str(), &buffer) != 0) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		remove(filename);
+		return NULL;
+	}
+	long long filesize = (long long)buffer.st_size;
+	long long filetime = (long long)buffer.st_mtime;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(filename);
+		if (it != m_entries.end()) {
+			std::shared_ptr<CachedRoll>& roll = it->second.roll;
+			if ((roll->filesize == filesize) && (roll->filetime == filetime)) {
+				m_order.splice(m_order.begin(), m_order, it->second.position);
+				m_hits++;
+				return roll;
+			}
+		}
+		m_misses++;
+	}
+
+	// Read the file without locking the cache, so that other rolls can be
+	// used in the meantime:
+	std::shared_ptr<CachedRoll> roll = load(filename, filesize, filetime);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	remove(filename);
+	if (roll == NULL) {
+		return NULL;
+	}
+	m_order.push_front(filename);
+	_Entry& entry = m_entries[filename];
+	entry.roll = roll;
+	entry.position = m_order.begin();
+	m_bytes += roll->bytes;
+	evict(filename);
+	return roll;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::addBytes -- Add to the memory used by a roll, such as for
+//     information stored along with it, removing other rolls if needed.
+//
+
+void RollCache::addBytes(const std::shared_ptr<CachedRoll>& roll,
+		long long bytes) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	roll->bytes += bytes;
+	auto it = m_entries.find(roll->filename);
+	if ((it != m_entries.end()) && (it->second.roll == roll)) {
+		m_bytes += bytes;
+		evict(roll->filename);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::clear -- Remove all rolls.
+//
+
+void RollCache::clear(void) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_entries.clear();
+	m_order.clear();
+	m_bytes = 0;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::setMaxBytes -- Set the estimated memory that the rolls can
+//     use.  Rolls are removed if needed the next time a file is read.
+//
+
+void RollCache::setMaxBytes(long long maxbytes) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxbytes = maxbytes;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::getMaxBytes -- Return the estimated memory that the rolls
+//     can use.
+//
+
+long long RollCache::getMaxBytes(void) const {
+	return m_maxbytes;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::getBytes -- Return the estimated memory used by the rolls.
+//
+
+long long RollCache::getBytes(void) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bytes;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::getRollCount -- Return the number of rolls in the cache.
+//
+
+int RollCache::getRollCount(void) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (int)m_entries.size();
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::getHits -- Return the number of requests which were answered
+//     from the cache.
+//
+
+long long RollCache::getHits(void) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_hits;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::getMisses -- Return the number of requests which needed to
+//     read a file.
+//
+
+long long RollCache::getMisses(void) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_misses;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollCache::load -- Read a file and prepare the joined copy of the roll.
+//
+
+std::shared_ptr<CachedRoll> RollCache::load(const std::string& filename,
+		long long filesize, long long filetime) {
+	std::shared_ptr<CachedRoll> roll = std::make_shared<CachedRoll>();
+	if (!roll->roll.read(filename)) {
+		return NULL;
+	}
+	roll->filename = filename;
+	roll->filesize = filesize;
+	roll->filetime = filetime;
+	roll->joined = roll->roll;
+	roll->joined.joinTracks();
+	roll->joined.doTimeAnalysis();
+	roll->joined.linkNotePairs();
+	roll->bytes = estimateBytes(roll->roll) + estimateBytes(roll->joined);
+	return roll;
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::remove -- Remove a roll from the cache (the cache must be
+//     locked).
+//
+
+void RollCache::remove(const std::string& filename) {
+	auto it = m_entries.find(filename);
+	if (it == m_entries.end()) {
+		return;
+	}
+	m_bytes -= it->second.roll->bytes;
+	m_order.erase(it->second.position);
+	m_entries.erase(it);
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::evict -- Remove the least recently used rolls until the
+//     memory is under the maximum, keeping the given roll even if it
+//     is larger than the maximum by itself (the cache must be locked).
+//
+
+void RollCache::evict(const std::string& keep) {
+	while ((m_bytes > m_maxbytes) && !m_order.empty()) {
+		if (m_order.back() == keep) {
+			break;
+		}
+		remove(m_order.back());
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollCache::estimateBytes -- Return the approximate memory used by the
+//     events of a MIDI file.
+//
+
+long long RollCache::estimateBytes(MidiFile& midifile) {
+	long long bytes = sizeof(MidiFile);
+	for (int i=0; i<midifile.getTrackCount(); i++) {
+		bytes += sizeof(MidiEventList);
+		for (int j=0; j<midifile[i].getEventCount(); j++) {
+			// the event, its pointer in the list, and its message bytes:
+			bytes += sizeof(MidiEvent) + sizeof(MidiEvent*)
+					+ midifile[i][j].capacity();
+		}
+	}
+	return bytes;
+}
+
+
+} // end smf namespace
+
+
+
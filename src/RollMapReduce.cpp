@@ -0,0 +1,204 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:11:07 PDT 2026
+// Last Modified: Sun Oct 18 17:11:07 PDT 2026
+// Filename:      midiroll/src/RollMapReduce.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Collect statistics from many MIDI roll files using
+//                several threads.
+//
+//                A map function looks at one roll and adds what it finds
+//                to an accumulator (see RollAccumulator.h).  Files are
+//                read by a RollBatch, and each thread adds to its own
+//                accumulator, so the map function does not need any
+//                locking.  When all files are done, the accumulators
+//                are merged into the result.  Since merging only adds
+//                counts or compares values, the result is the same for
+//                any number of threads and any order of the files.
+//
+//                Example, counting all notes in a set of files:
+//
+//                   RollCounts notes;
+//                   RollMapReduce mapreduce;
+//                   mapreduce.run<RollCounts>(filenames, notes,
+//                         [](MidiRoll& roll, RollCounts& counts) {
+//                            ... counts.add(0) for each note-on ...
+//                         });
+//                   cout << notes.getTotal() << endl;
+//
+
+#include "RollMapReduce.h"
+
+#include <mutex>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollMapReduce::RollMapReduce -- Class constructor.
+//
+
+RollMapReduce::RollMapReduce(void) {
+	m_batch.setWrite(false);
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::~RollMapReduce -- Class deconstructor.
+//
+
+RollMapReduce::~RollMapReduce() { }
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::setThreadCount -- Set the number of files processed at
+//     the same time.  A count of 0 (the default) uses one thread per
+//     processor core.
+//
+
+void RollMapReduce::setThreadCount(int count) {
+	m_batch.setThreadCount(count);
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::getThreadCount -- Return the number of files processed
+//     at the same time (0 for one per processor core).
+//
+
+int RollMapReduce::getThreadCount(void) const {
+	return m_batch.getThreadCount();
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::setProgress -- Print the name of each file as it is
+//     finished and a summary of the run to standard error.
+//
+
+void RollMapReduce::setProgress(bool state) {
+	m_batch.setProgress(state);
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::getProgress -- Return true if progress is printed.
+//
+
+bool RollMapReduce::getProgress(void) const {
+	return m_batch.getProgress();
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::getFileCount -- Return the number of files in the last
+//     run.
+//
+
+int RollMapReduce::getFileCount(void) const {
+	return m_batch.getFileCount();
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::getFailureCount -- Return the number of files which
+//     could not be read in the last run.
+//
+
+int RollMapReduce::getFailureCount(void) const {
+	return m_batch.getFailureCount();
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::getFailures -- Return the files which failed in the last
+//     run, each as "filename: reason".
+//
+
+const std::vector<std::string>& RollMapReduce::getFailures(void) const {
+	return m_batch.getFailures();
+}
+
+
+
+//////////////////////////////
+//
+// RollMapReduce::getSeconds -- Return the duration of the last run.
+//
+
+double RollMapReduce::getSeconds(void) const {
+	return m_batch.getSeconds();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollMapReduce::runAccumulators -- Run the map function on each file.
+//     An accumulator is taken from a pool while a file is being mapped
+//     and returned afterwards, so there are never more accumulators than
+//     threads.  The accumulators are then merged into the result.
+//
+
+int RollMapReduce::runAccumulators(const std::vector<std::string>& filenames,
+		RollAccumulator& result,
+		const std::function<void(MidiRoll&, RollAccumulator&)>& map) {
+	std::vector<RollAccumulator*> all;
+	std::vector<RollAccumulator*> available;
+	std::mutex poolmutex;
+
+	int failures = m_batch.run(filenames, [&](MidiRoll& roll) {
+		RollAccumulator* accumulator = NULL;
+		{
+			std::lock_guard<std::mutex> lock(poolmutex);
+			if (available.empty()) {
+				all.push_back(result.makeEmpty());
+				available.push_back(all.back());
+			}
+			accumulator = available.back();
+			available.pop_back();
+		}
+		map(roll, *accumulator);
+		{
+			std::lock_guard<std::mutex> lock(poolmutex);
+			available.push_back(accumulator);
+		}
+		return true;
+	});
+
+	for (int i=0; i<(int)all.size(); i++) {
+		result.merge(*all[i]);
+		delete all[i];
+		all[i] = NULL;
+	}
+	return failures;
+}
+
+
+} // end smf namespace
+
+
+
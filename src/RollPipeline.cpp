@@ -0,0 +1,409 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:01:05 PDT 2026
+// Last Modified: Sun Oct 18 18:04:10 PDT 2026
+// Filename:      midiroll/src/RollPipeline.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   An ordered list of roll transforms (using the same names
+//                and options as the command-line tools) which are applied
+//                to a roll in memory.
+//
+//                A conversion such as
+//                   trackerize | rollaccel | holeshift -t 1 | rollbreak -d
+//                run as a shell pipeline parses and writes the roll at
+//                every stage.  The same string given to a RollPipeline
+//                applies the transforms one after another to a single
+//                MidiRoll, which is then written once.  Each stage
+//                accepts the options of the tool with the same name that
+//                change the roll (input/output options are not used):
+//
+//                   trackerize    -h pixels -s scale
+//                   rollaccel     -r | -s inches -p percent
+//                   holeshift     -t transposition [-r|-g]
+//                   rollbreak     -b key | -w | -a | -d
+//                                 --treble-track # --bass-track #
+//                   setinstrument -i instrument | -p
+//                   expscale      -n min -x max [--old-min #] [--old-max #]
+//                   temposimp     -t milliseconds
+//
+
+#include "RollPipeline.h"
+
+#include <iostream>
+#include <sstream>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollPipeline::RollPipeline -- Class constructors.  Stages are separated
+//     by "|" characters in the pipeline string.
+//
+
+RollPipeline::RollPipeline(void) { }
+
+RollPipeline::RollPipeline(const std::string& pipeline) {
+	parse(pipeline);
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::~RollPipeline -- Class deconstructor.
+//
+
+RollPipeline::~RollPipeline() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::parse -- Add the stages of a pipeline string, such as
+//     "trackerize -h 25 | rollaccel | setinstrument -p", after any
+//     existing stages.  Returns false (adding no stages) if a stage
+//     name is not known.
+//
+
+bool RollPipeline::parse(const std::string& pipeline) {
+	std::vector<std::string> commands;
+	std::stringstream input(pipeline);
+	std::string command;
+	while (std::getline(input, command, '|')) {
+		size_t start = command.find_first_not_of(" \t\n\r");
+		if (start == std::string::npos) {
+			continue;
+		}
+		size_t end = command.find_last_not_of(" \t\n\r");
+		commands.push_back(command.substr(start, end - start + 1));
+	}
+
+	int oldcount = getStageCount();
+	for (int i=0; i<(int)commands.size(); i++) {
+		if (!addStage(commands[i])) {
+			for (int j=oldcount; j<getStageCount(); j++) {
+				delete m_stages[j];
+			}
+			m_stages.resize(oldcount);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::addStage -- Add a transform to the end of the pipeline,
+//     given as a tool name followed by its options, such as
+//     "holeshift -t 1 -g".  Returns false if the name is not a stage.
+//
+
+bool RollPipeline::addStage(const std::string& command) {
+	std::vector<std::string> tokens;
+	std::stringstream input(command);
+	std::string token;
+	while (input >> token) {
+		tokens.push_back(token);
+	}
+	if (tokens.empty()) {
+		return false;
+	}
+	if (!isStage(tokens[0])) {
+		std::cerr << "Error: unknown pipeline stage: " << tokens[0] << std::endl;
+		return false;
+	}
+
+	_Stage* stage = new _Stage;
+	stage->name = tokens[0];
+	stage->command = command;
+	defineOptions(stage->name, stage->options);
+	std::vector<char*> argv(tokens.size());
+	for (int i=0; i<(int)tokens.size(); i++) {
+		argv[i] = &tokens[i][0];
+	}
+	stage->options.process((int)argv.size(), argv.data());
+	m_stages.push_back(stage);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::clear -- Remove all stages.
+//
+
+void RollPipeline::clear(void) {
+	for (int i=0; i<(int)m_stages.size(); i++) {
+		delete m_stages[i];
+		m_stages[i] = NULL;
+	}
+	m_stages.clear();
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::getStageCount -- Return the number of stages.
+//
+
+int RollPipeline::getStageCount(void) const {
+	return (int)m_stages.size();
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::getStageCommand -- Return a stage as it was given to
+//     addStage().
+//
+
+const std::string& RollPipeline::getStageCommand(int index) const {
+	return m_stages.at(index)->command;
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::getRecipe -- Return the stages as a pipeline string with
+//     the spacing made uniform, such as "trackerize -h 25 | rollaccel",
+//     so that the same pipeline always gives the same string (for
+//     RollBuildCache keys).
+//
+
+std::string RollPipeline::getRecipe(void) const {
+	std::string output;
+	for (int i=0; i<(int)m_stages.size(); i++) {
+		if (i > 0) {
+			output += " | ";
+		}
+		std::stringstream input(m_stages[i]->command);
+		std::string token;
+		bool firstQ = true;
+		while (input >> token) {
+			if (!firstQ) {
+				output += ' ';
+			}
+			output += token;
+			firstQ = false;
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::run -- Apply the stages in order to the roll.  Returns
+//     false if a stage cannot be applied, in which case the later stages
+//     are skipped and the roll contains the results of the earlier ones.
+//
+
+bool RollPipeline::run(MidiRoll& roll) {
+	for (int i=0; i<(int)m_stages.size(); i++) {
+		if (!runStage(*m_stages[i], roll)) {
+			std::cerr << "Error: pipeline stopped at stage " << i+1 << ": "
+			          << m_stages[i]->command << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::isStage -- Return true if the name is a pipeline stage.
+//
+
+bool RollPipeline::isStage(const std::string& name) {
+	Options options;
+	return defineOptions(name, options);
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::getStageNames -- Return the names of the stages.
+//
+
+std::vector<std::string> RollPipeline::getStageNames(void) {
+	std::vector<std::string> names = {"trackerize", "rollaccel",
+			"holeshift", "rollbreak", "setinstrument", "expscale",
+			"temposimp", "fped"};
+	return names;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollPipeline::defineOptions -- Define the options of a stage, which
+//     are the same as those of the tool with the same name.  Returns
+//     false if the name is not a stage.
+//
+
+bool RollPipeline::defineOptions(const std::string& name, Options& options) {
+	if (name == "trackerize") {
+		options.define("h|tracker-height-in-pixels=i:25", "Height of tracker bar holes in pixels");
+		options.define("s|scale=d:0.9", "Scaling factor to apply");
+	} else if (name == "rollaccel") {
+		options.define("r|remove=b", "remove tempo acceleration emulation");
+		options.define("s|step=d:12", "inches between each tempo increment step");
+		options.define("p|percent=d:0.04", "percent acceleration at each step");
+	} else if (name == "holeshift") {
+		options.define("t|transpose=i:0", "Transpose by pitch amount");
+		options.define("r|red|t100|T100|t-100|T-100|red-roll=b", "Split into four registers of red roll");
+		options.define("g|green|t98|T98|t-98|T-98|green-roll=b", "Split into four registers of green roll");
+	} else if (name == "rollbreak") {
+		options.define("b|break=d:66.5",   "boundary between treble and bass notes");
+		options.define("w|welte-mignon=b", "boundary between treble and bass notes is 66.5");
+		options.define("green-welte=b",    "boundary between treble and bass notes is 66.5");
+		options.define("red-welte=b",      "boundary between treble and bass notes is 66.5");
+		options.define("licensee-welte=b", "boundary between treble and bass notes is 66.5");
+		options.define("a|ampico=b",       "boundary between treble and bass notes is 64.5");
+		options.define("d|duo-art=b",      "boundary between treble and bass notes is 63.5");
+		options.define("treble-track=i:2", "track containing treble notes");
+		options.define("bass-track=i:1",   "track containing bass notes");
+	} else if (name == "setinstrument") {
+		options.define("i|instrument=i:0", "set all tracks to the given instrument number");
+		options.define("p|piano=b",        "use piano timbre for all tracks");
+	} else if (name == "expscale") {
+		options.define("old-min=d:-1.0", "old minimum value");
+		options.define("old-max=d:-1.0", "old maximum value");
+		options.define("n|min|new-min=d:-1.0", "new minimum value");
+		options.define("x|max|new-max=d:-1.0", "new maximum value");
+	} else if (name == "temposimp") {
+		options.define("t|tolerance=d:1.0", "maximum timing error in milliseconds");
+	} else if (name == "fped") {
+		options.define("c|controller=i:64", "pedal controller to convert (64 = sustain, 67 = soft)");
+	} else {
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollPipeline::runStage -- Apply one stage to the roll in the same way
+//     as the tool with the same name.  Returns false if the stage cannot
+//     be applied.
+//
+
+bool RollPipeline::runStage(_Stage& stage, MidiRoll& roll) {
+	Options& options = stage.options;
+
+	// Keep events with the same tick in their current order when a stage
+	// sorts the tracks, as MidiFile::read() does for a tool reading the
+	// output of the previous tool:
+	roll.markSequence();
+
+	if (stage.name == "trackerize") {
+		double value = options.getDouble("tracker-height-in-pixels");
+		value *= options.getDouble("scale");
+		roll.trackerize(value);
+		roll.setMetadata("HOLE_EXTENSION", std::to_string(value) + "px");
+
+	} else if (stage.name == "rollaccel") {
+		double percent = options.getDouble("percent");
+		double inches  = options.getDouble("step");
+		if (options.getBoolean("remove")) {
+			roll.removeAcceleration();
+		} else if ((percent > 0.0) && (inches > 0.0)) {
+			roll.setAccelerationModel(inches, percent);
+		}
+
+	} else if (stage.name == "holeshift") {
+		int transpose = options.getInteger("transpose");
+		if (transpose == 0) {
+			std::cerr << "Error: holeshift needs a non-zero transposition" << std::endl;
+			return false;
+		}
+		roll.shiftHoles(transpose, options.getBoolean("green"));
+
+	} else if (stage.name == "rollbreak") {
+		double breakpoint = options.getDouble("break");
+		if (options.getBoolean("green-welte") || options.getBoolean("red-welte")
+				|| options.getBoolean("licensee-welte")
+				|| options.getBoolean("welte-mignon")) {
+			breakpoint = 66.5;
+		}
+		if (options.getBoolean("ampico")) {
+			breakpoint = 64.5;
+		}
+		if (options.getBoolean("duo-art")) {
+			breakpoint = 63.5;
+		}
+		if (!roll.setRegisterBreak(breakpoint, options.getInteger("treble-track"),
+				options.getInteger("bass-track"))) {
+			std::cerr << "Error: invalid breakpoint: " << breakpoint << std::endl;
+			return false;
+		}
+
+	} else if (stage.name == "setinstrument") {
+		int pc = options.getInteger("instrument");
+		if (options.getBoolean("piano")) {
+			pc = 0;
+		}
+		roll.setInstrument(pc);
+
+	} else if (stage.name == "expscale") {
+		if (roll.getTrackCount() < 3) {
+			std::cerr << "Error: There must be a minumum of 3 traks in the MIDI roll" << std::endl;
+			return false;
+		}
+		if (!(options.getBoolean("new-min") && options.getBoolean("new-max"))) {
+			std::cerr << "Error: expscale needs a new minimum and maximum" << std::endl;
+			return false;
+		}
+		int minimum;
+		int maximum;
+		roll.getAttackVelocityRange(minimum, maximum);
+		double oldmin = minimum;
+		double oldmax = maximum;
+		if (options.getBoolean("old-min")) {
+			oldmin = options.getDouble("old-min");
+		}
+		if (options.getBoolean("old-max")) {
+			oldmax = options.getDouble("old-max");
+		}
+		roll.rescaleAttackVelocities(oldmin, oldmax,
+				options.getDouble("new-min"), options.getDouble("new-max"));
+
+	} else if (stage.name == "temposimp") {
+		roll.simplifyTempos(options.getDouble("tolerance") / 1000.0);
+
+	} else if (stage.name == "fped") {
+		roll.applyPedal(options.getInteger("controller"));
+
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+
+} // end smf namespace
+
+
+
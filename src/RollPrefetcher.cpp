@@ -0,0 +1,373 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:14:59 PDT 2026
+// Last Modified: Sun Oct 18 17:14:59 PDT 2026
+// Filename:      midiroll/src/RollPrefetcher.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Read MIDI roll files on background threads ahead of
+//                their use, and write results on a background thread.
+//
+//                A tool which processes a list of files one at a time
+//                leaves the disk idle while it is working on a roll, and
+//                the processor idle while it is reading or writing a
+//                file.  A RollPrefetcher reads and parses the next few
+//                files while the current one is being processed, and
+//                next() returns them in the same order as the list:
+//
+//                   RollPrefetcher prefetcher;
+//                   prefetcher.start(filenames);
+//                   MidiRoll roll;
+//                   while (prefetcher.next(roll)) {
+//                      ... process roll ...
+//                      prefetcher.write(roll, prefetcher.getFilename());
+//                   }
+//                   prefetcher.finish();
+//
+//                write() hands the roll to a background thread, so the
+//                next file can be processed while the previous one is
+//                being written.  The number of rolls read ahead, and the
+//                number waiting to be written, are limited by the queue
+//                size, so memory use does not grow with the number of
+//                files.
+//
+
+#include "RollPrefetcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollPrefetcher::RollPrefetcher -- Class constructor.
+//
+
+RollPrefetcher::RollPrefetcher(void) { }
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::~RollPrefetcher -- Class deconstructor.  Waits for
+//     any rolls given to write() to be written.
+//
+
+RollPrefetcher::~RollPrefetcher() {
+	finish();
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::setQueueSize -- Set the number of files which can be
+//     read ahead of next(), and the number of rolls which can wait to be
+//     written (default PREFETCH_QUEUE_SIZE).  Used by the next call to
+//     start().
+//
+
+void RollPrefetcher::setQueueSize(int size) {
+	m_queuesize = size < 1 ? 1 : size;
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::getQueueSize -- Return the number of files which can be
+//     read ahead of next().
+//
+
+int RollPrefetcher::getQueueSize(void) const {
+	return m_queuesize;
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::setThreadCount -- Set the number of threads reading
+//     files (default 2).  Used by the next call to start().
+//
+
+void RollPrefetcher::setThreadCount(int count) {
+	m_threadcount = count < 1 ? 1 : count;
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::getThreadCount -- Return the number of threads reading
+//     files.
+//
+
+int RollPrefetcher::getThreadCount(void) const {
+	return m_threadcount;
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::start -- Start reading a list of files in the
+//     background.  Any files from a previous list which have not been
+//     given to next() are discarded.
+//
+
+void RollPrefetcher::start(const std::vector<std::string>& filenames) {
+	stopReaders();
+	m_filenames = filenames;
+	m_current   = -1;
+	m_reading   = 0;
+	m_consumed  = 0;
+	m_stop      = false;
+	int count = std::min(m_threadcount, (int)m_filenames.size());
+	for (int i=0; i<count; i++) {
+		m_readers.emplace_back(&RollPrefetcher::readFiles, this);
+	}
+}
+
+//
+// Options version of start(): read the files given as arguments on
+// the command line.
+//
+
+void RollPrefetcher::start(Options& options) {
+	std::vector<std::string> filenames;
+	for (int i=0; i<options.getArgCount(); i++) {
+		filenames.push_back(options.getArg(i+1));
+	}
+	start(filenames);
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::next -- Store the next roll in the list into the given
+//     roll, waiting for it to be read if necessary.  Returns false when
+//     there are no more files.  A file which could not be read gives a
+//     roll whose status() is false.
+//
+
+bool RollPrefetcher::next(MidiRoll& roll) {
+	MidiRoll* ready = NULL;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_consumed >= (int)m_filenames.size()) {
+			return false;
+		}
+		m_readycondition.wait(lock, [this]() {
+			return m_ready.find(m_consumed) != m_ready.end();
+		});
+		auto it = m_ready.find(m_consumed);
+		ready = it->second;
+		m_ready.erase(it);
+		m_current = m_consumed++;
+	}
+	m_readcondition.notify_all();
+	roll = std::move(*ready);
+	delete ready;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::getIndex -- Return the index in the list of the last
+//     roll given by next() (-1 before the first one).
+//
+
+int RollPrefetcher::getIndex(void) const {
+	return m_current;
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::getFilename -- Return the filename of the last roll
+//     given by next().
+//
+
+const std::string& RollPrefetcher::getFilename(void) const {
+	static const std::string empty;
+	if ((m_current < 0) || (m_current >= (int)m_filenames.size())) {
+		return empty;
+	}
+	return m_filenames[m_current];
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::write -- Write a roll to a file on a background thread.
+//     The contents of the roll are moved into the write queue, so the
+//     roll is empty afterwards.  Waits if the queue is full.
+//
+
+void RollPrefetcher::write(MidiRoll& roll, const std::string& filename) {
+	MidiRoll* output = new MidiRoll(std::move(roll));
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_writer.joinable()) {
+			m_closing = false;
+			m_writer = std::thread(&RollPrefetcher::writeFiles, this);
+		}
+		m_writecondition.wait(lock, [this]() {
+			return (int)m_writes.size() < m_queuesize;
+		});
+		m_writes.emplace_back(output, filename);
+	}
+	m_writecondition.notify_all();
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::finish -- Stop reading files, and wait for all rolls
+//     given to write() to be written.  Files which could not be written
+//     are printed to standard error.  Returns the number of files which
+//     could not be written.
+//
+
+int RollPrefetcher::finish(void) {
+	stopReaders();
+	if (m_writer.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closing = true;
+		}
+		m_writecondition.notify_all();
+		m_writer.join();
+		for (int i=0; i<(int)m_writefailures.size(); i++) {
+			std::cerr << "Error: cannot write file " << m_writefailures[i] << std::endl;
+		}
+	}
+	return (int)m_writefailures.size();
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::getWriteFailures -- Return the filenames which could not
+//     be written.
+//
+
+const std::vector<std::string>& RollPrefetcher::getWriteFailures(void) const {
+	return m_writefailures;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollPrefetcher::readFiles -- Read files in the list (used by each
+//     reading thread) until the end of the list, staying no more than
+//     the queue size ahead of next().
+//
+
+void RollPrefetcher::readFiles(void) {
+	while (true) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_readcondition.wait(lock, [this]() {
+				return m_stop || (m_reading >= (int)m_filenames.size())
+						|| (m_reading < m_consumed + m_queuesize);
+			});
+			if (m_stop || (m_reading >= (int)m_filenames.size())) {
+				return;
+			}
+			index = m_reading++;
+		}
+		MidiRoll* roll = new MidiRoll;
+		roll->read(m_filenames[index]);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_ready[index] = roll;
+		}
+		m_readycondition.notify_all();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::writeFiles -- Write the rolls in the write queue (used
+//     by the writing thread) until finish() is called and the queue is
+//     empty.
+//
+
+void RollPrefetcher::writeFiles(void) {
+	while (true) {
+		std::pair<MidiRoll*, std::string> output;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_writecondition.wait(lock, [this]() {
+				return m_closing || !m_writes.empty();
+			});
+			if (m_writes.empty()) {
+				return;
+			}
+			output = m_writes.front();
+			m_writes.pop_front();
+		}
+		m_writecondition.notify_all();
+		bool status = output.first->write(output.second);
+		delete output.first;
+		if (!status) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_writefailures.push_back(output.second);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollPrefetcher::stopReaders -- Stop the reading threads and delete any
+//     rolls which were not given to next() (which will then return false
+//     until the next call to start()).
+//
+
+void RollPrefetcher::stopReaders(void) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_readcondition.notify_all();
+	for (int i=0; i<(int)m_readers.size(); i++) {
+		m_readers[i].join();
+	}
+	m_readers.clear();
+	for (auto& it : m_ready) {
+		delete it.second;
+	}
+	m_ready.clear();
+	m_filenames.clear();
+	m_current  = -1;
+	m_reading  = 0;
+	m_consumed = 0;
+}
+
+
+} // end smf namespace
+
+
+
@@ -0,0 +1,164 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 19:05:38 PDT 2026
+// Last Modified: Sun Oct 18 19:05:38 PDT 2026
+// Filename:      midiroll/src/RollReport.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Text reports on MIDI rolls, shared by the notelist,
+//                tick2time, rolltext and countnotes tools and by the
+//                roll query server.
+//
+
+#include "RollReport.h"
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollReport::printNoteList -- Print each note with its key, velocity,
+//     track, starting time and duration in seconds.  The tracks of the
+//     file must already be joined, with the time analysis done and the
+//     notes linked.
+//
+
+void RollReport::printNoteList(MidiFile& joined, std::ostream& out) {
+	MidiEventList& events = joined[0];
+	for (int i=0; i<events.getSize(); i++) {
+		if (!events[i].isNoteOn()) {
+			continue;
+		}
+		out << events[i].getP1() << "\t";
+		out << events[i].getP2() << "\t";
+		out << events[i].track   << "\t";
+		out << events[i].seconds << "\t";
+		out << events[i].getDurationInSeconds() << "\n";
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollReport::printSoundingNotes -- Print the notes which are sounding at
+//     the given tick, along with their starting and ending ticks.
+//
+
+void RollReport::printSoundingNotes(MidiRoll& midiroll, int tick,
+		std::ostream& out) {
+	const NoteIndex& index = midiroll.getNoteIndex();
+	std::vector<const NoteInterval*> notes;
+	for (int key=0; key<128; key++) {
+		notes.clear();
+		index.getSoundingNotes(notes, key, tick);
+		for (int i=0; i<(int)notes.size(); i++) {
+			out << notes[i]->key << "\t";
+			out << notes[i]->noteon->getVelocity() << "\t";
+			out << notes[i]->track << "\t";
+			out << notes[i]->starttick << "\t";
+			out << notes[i]->endtick << "\n";
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollReport::printTickToTime -- Print each tick which has an event and
+//     its time in seconds.  The tracks of the file must already be joined,
+//     with the time analysis done.
+//
+
+void RollReport::printTickToTime(MidiFile& joined, std::ostream& out) {
+	MidiEventList& events = joined[0];
+	int lasttick = -1;
+	for (int i=0; i<events.getSize(); i++) {
+		if (lasttick == events[i].tick) {
+			continue;
+		}
+		out << events[i].tick << "\t";
+		out << events[i].seconds << "\n";
+		lasttick = events[i].tick;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollReport::printText -- Print the text of each text meta message, or
+//     only of the metadata messages, optionally preceded by the tick of
+//     the message.
+//
+
+void RollReport::printText(MidiRoll& midiroll, bool metadataQ, bool ticksQ,
+		std::ostream& out) {
+	std::vector<MidiEvent*> events;
+	if (metadataQ) {
+		events = midiroll.getMetadataEvents();
+	} else {
+		events = midiroll.getTextEvents();
+	}
+	for (int i=0; i<(int)events.size(); i++) {
+		if (ticksQ) {
+			out << events[i]->tick << "\t";
+		}
+		out << events[i]->getMetaContent() << "\n";
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollReport::countNotes -- Count the note-ons of each key, and store the
+//     tick of the first note-on of each key (-1 if the key is not used).
+//     Returns the total number of note-ons.
+//
+
+int RollReport::countNotes(MidiFile& midifile, std::vector<int>& keycount,
+		std::vector<int>& firsttick) {
+	keycount.assign(128, 0);
+	firsttick.assign(128, -1);
+	int sum = 0;
+	for (int i=0; i<midifile.getTrackCount(); i++) {
+		MidiEventList& events = midifile[i];
+		for (int j=0; j<events.getEventCount(); j++) {
+			if (!events[j].isNoteOn()) {
+				continue;
+			}
+			int key = events[j].getKeyNumber();
+			keycount[key]++;
+			if (firsttick[key] == -1) {
+				firsttick[key] = events[j].tick;
+			}
+			sum++;
+		}
+	}
+	return sum;
+}
+
+
+
+//////////////////////////////
+//
+// RollReport::printNoteCounts -- Print the number of notes for each key.
+//     If the duration in ticks is not zero, the time of the first note of
+//     each key is also printed as a percentage of the duration.
+//
+
+void RollReport::printNoteCounts(const std::vector<int>& keycount,
+		const std::vector<int>& firsttick, int duration, std::ostream& out) {
+	for (int i=0; i<(int)keycount.size(); i++) {
+		out << i << ":\t" << keycount[i];
+		if (duration) {
+			out << "\t" << (int)(firsttick[i]/(double)duration * 100.0 + 0.5);
+		}
+		out << "\n";
+	}
+}
+
+
+} // end smf namespace
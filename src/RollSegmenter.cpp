@@ -0,0 +1,578 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:44:37 PDT 2026
+// Last Modified: Sun Oct 18 19:32:11 PDT 2026
+// Filename:      midiroll/src/RollSegmenter.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Split a long MIDI roll into time segments which can be
+//                processed at the same time in several threads, and join
+//                the segments back into the roll afterwards.
+//
+//                Each segment is a MidiRoll with the same tracks and roll
+//                settings as the original.  The events are moved (not
+//                copied) from the roll into the segments, and moved back
+//                when the segments are joined.  An event goes into the
+//                segment containing its tick, except that note-offs and
+//                the releases of switch controllers (such as the sustain
+//                pedal) go into the segment of the note-on or pedal press
+//                which they are linked to.  So every note and pedal is
+//                complete within one segment, and segments can extend
+//                past their end tick by the tails of the notes started in
+//                them.  Joining merges the events of each track from all
+//                segments in the order used by MidiFile::sortTracks(),
+//                keeping the order of the segments for equal events, so
+//                splitting and joining a sorted roll gives the same roll.
+//
+//                This works for transforms which change each note or
+//                event without looking at other parts of the roll, such
+//                as shiftHoles(), setRegisterBreak() and
+//                rescaleAttackVelocities() (with the velocity range found
+//                on the whole roll first), for trackerize() with the
+//                tracker height as the margin (see setMargin()), and for
+//                analysis of the notes in each segment.  It does not work for transforms which
+//                change metadata (the metadata is only in the first
+//                segment), or which depend on the tempo or time of
+//                events, since only the first segment contains the tempo
+//                events from the start of the roll.
+//
+
+#include "RollSegmenter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <thread>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollSegmenter::RollSegmenter -- Class constructor.
+//
+
+RollSegmenter::RollSegmenter(void) { }
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::~RollSegmenter -- Class deconstructor.
+//
+
+RollSegmenter::~RollSegmenter() { }
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::setThreadCount -- Set the number of segments processed
+//     at the same time by run().  A count of 0 (the default) uses one
+//     thread per processor core.
+//
+
+void RollSegmenter::setThreadCount(int count) {
+	m_threads = count < 0 ? 0 : count;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getThreadCount -- Return the number of segments
+//     processed at the same time (0 for one per processor core).
+//
+
+int RollSegmenter::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::setWindow -- Set the length of the segments in ticks.
+//     A length of 0 (the default) splits the roll into one segment per
+//     thread, each with about the same number of events.
+//
+
+void RollSegmenter::setWindow(int ticks) {
+	m_window = ticks < 0 ? 0 : ticks;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getWindow -- Return the length of the segments in ticks
+//     (0 for one segment per thread).
+//
+
+int RollSegmenter::getWindow(void) const {
+	return m_window;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::setMargin -- Set the number of ticks around the start of
+//     each segment where no key should end one note and start another.
+//     This is needed for transforms which change a note depending on the
+//     next note of the same key, such as MidiRoll::trackerize(), where
+//     the margin is the tracker height.  Each start is moved to a nearby
+//     place without such notes, or dropped if there is none, so that the
+//     result is the same as for the whole roll.  The default margin is 0.
+//
+
+void RollSegmenter::setMargin(int ticks) {
+	m_margin = ticks < 0 ? 0 : ticks;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getMargin -- Return the margin around segment starts.
+//
+
+int RollSegmenter::getMargin(void) const {
+	return m_margin;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::split -- Move the events of the roll into segments,
+//     leaving the tracks of the roll empty until join() is called.  The
+//     notes and controllers are linked first.  Returns the number of
+//     segments.
+//
+
+int RollSegmenter::split(MidiRoll& roll) {
+	clear();
+	if (!roll.isAbsoluteTicks()) {
+		roll.makeAbsoluteTicks();
+	}
+	roll.linkNotePairs();
+	makeStarts(roll);
+
+	int trackcount = roll.getTrackCount();
+	m_segments.resize(m_starts.size());
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		MidiRoll& segment = m_segments[i];
+		segment.setTicksPerQuarterNote(roll.getTicksPerQuarterNote());
+		if (trackcount > 1) {
+			segment.addTracks(trackcount - 1);
+		}
+		segment.copyRollSettings(roll);
+	}
+
+	for (int i=0; i<trackcount; i++) {
+		MidiEventList& track = roll[i];
+		for (int j=0; j<track.getEventCount(); j++) {
+			MidiEvent& event = track[j];
+			int tick = event.tick;
+			MidiEvent* link = event.getLinkedEvent();
+			if (link && (event.isNoteOff()
+					|| (event.isController() && (event.getP2() < 64)))) {
+				// the end of a note or pedal goes with its start:
+				tick = link->tick;
+			}
+			m_segments[findSegment(tick)][i].push_back_no_copy(&event);
+		}
+		track.detach();
+	}
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::join -- Move the events of the segments back into the
+//     roll (replacing any events added to the roll since split()), and
+//     remove the segments.  Tracks added to the segments are added to the
+//     roll.
+//
+
+void RollSegmenter::join(MidiRoll& roll) {
+	int trackcount = roll.getTrackCount();
+	for (int i=0; i<(int)m_segments.size(); i++) {
+		if (m_segments[i].hasJoinedTracks()) {
+			m_segments[i].splitTracks();
+		}
+		trackcount = std::max(trackcount, m_segments[i].getTrackCount());
+	}
+	if (roll.getTrackCount() < trackcount) {
+		roll.addTracks(trackcount - roll.getTrackCount());
+	}
+
+	auto compare = [](MidiEvent* a, MidiEvent* b) {
+		return eventcompare(&a, &b) < 0;
+	};
+	std::vector<MidiEvent*> events;
+	for (int i=0; i<trackcount; i++) {
+		// Merge the (sorted) tracks of the segments in order, so that equal
+		// events keep the order of the segments:
+		events.clear();
+		for (int j=0; j<(int)m_segments.size(); j++) {
+			MidiRoll& segment = m_segments[j];
+			if (i >= segment.getTrackCount()) {
+				continue;
+			}
+			size_t middle = events.size();
+			for (int k=0; k<segment[i].getEventCount(); k++) {
+				events.push_back(&segment[i][k]);
+			}
+			if (!std::is_sorted(events.begin() + middle, events.end(), compare)) {
+				std::stable_sort(events.begin() + middle, events.end(), compare);
+			}
+			std::inplace_merge(events.begin(), events.begin() + middle,
+					events.end(), compare);
+		}
+		MidiEventList& track = roll[i];
+		track.clear();
+		track.reserve((int)events.size());
+		for (int j=0; j<(int)events.size(); j++) {
+			track.push_back_no_copy(events[j]);
+		}
+		for (int j=0; j<(int)m_segments.size(); j++) {
+			if (i < m_segments[j].getTrackCount()) {
+				m_segments[j][i].detach();
+			}
+		}
+	}
+
+	clear();
+	roll.invalidateTimeMap();
+	roll.invalidateIndexes();
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::run -- Split the roll, apply the function to each
+//     segment, and join the segments back into the roll.  The function
+//     is called from several threads at once (each time with a different
+//     segment), so it must not change any shared data.  Returns false if
+//     the function returns false for any segment (the segments are still
+//     joined, so the roll contains whatever the function did to them).
+//
+
+bool RollSegmenter::run(MidiRoll& roll,
+		const std::function<bool(MidiRoll&)>& function) {
+	if ((getThreads() == 1) && (m_window == 0)) {
+		// only one segment:
+		return function(roll);
+	}
+	int count = split(roll);
+	int threads = std::min(getThreads(), count);
+
+	// The segments already use all of the threads, so process the tracks
+	// of each segment one at a time:
+	int trackthreads = threads > 1 ? 1 : 0;
+	for (int i=0; i<count; i++) {
+		m_segments[i].setThreadCount(trackthreads);
+	}
+
+	std::vector<char> status(count, 0);
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next.fetch_add(1)) < count) {
+			status[index] = function(m_segments[index]) ? 1 : 0;
+		}
+	};
+	std::vector<std::thread> workers;
+	for (int i=1; i<threads; i++) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (int i=0; i<(int)workers.size(); i++) {
+		workers[i].join();
+	}
+
+	join(roll);
+	for (int i=0; i<count; i++) {
+		if (!status[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getSegmentCount -- Return the number of segments.
+//
+
+int RollSegmenter::getSegmentCount(void) const {
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getSegment -- Return a segment.
+//
+
+MidiRoll& RollSegmenter::getSegment(int index) {
+	return m_segments.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getSegmentStart -- Return the first tick of a segment.
+//
+
+int RollSegmenter::getSegmentStart(int index) const {
+	return m_starts.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getSegmentEnd -- Return the tick after the last note-on
+//     of a segment (the start of the next segment), or -1 for the last
+//     segment.
+//
+
+int RollSegmenter::getSegmentEnd(int index) const {
+	if (index + 1 < (int)m_starts.size()) {
+		return m_starts.at(index + 1);
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::clear -- Remove the segments.
+//
+
+void RollSegmenter::clear(void) {
+	m_segments.clear();
+	m_starts.clear();
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollSegmenter::makeStarts -- Choose the starting ticks of the segments,
+//     either every m_window ticks, or at the ticks which divide the
+//     events of the roll into one equal part per thread.  With a margin,
+//     each start is then moved to a nearby note-on where no note of the
+//     previous segment is followed within the margin by another note on
+//     the same key in the next segment, or dropped if there is none.
+//
+
+void RollSegmenter::makeStarts(MidiRoll& roll) {
+	std::vector<int> targets;
+	if (m_window > 0) {
+		int lasttick = 0;
+		for (int i=0; i<roll.getTrackCount(); i++) {
+			if (roll[i].getEventCount() > 0) {
+				lasttick = std::max(lasttick, roll[i].back().tick);
+			}
+		}
+		for (long long tick=m_window; tick<=lasttick; tick+=m_window) {
+			targets.push_back((int)tick);
+		}
+	} else {
+		std::vector<int> ticks;
+		for (int i=0; i<roll.getTrackCount(); i++) {
+			for (int j=0; j<roll[i].getEventCount(); j++) {
+				ticks.push_back(roll[i][j].tick);
+			}
+		}
+		int count = ticks.empty() ? 1 : getThreads();
+		for (int i=1; i<count; i++) {
+			auto nth = ticks.begin() + ticks.size() * i / count;
+			std::nth_element(ticks.begin(), nth, ticks.end());
+			targets.push_back(*nth);
+		}
+	}
+
+	// notes == linked notes of the roll sorted by starting tick, with the
+	// track, channel and key of each as a number.  longest == the length
+	// in ticks of the longest note.
+	std::vector<SegmentNote> notes;
+	int longest = 0;
+	if (m_margin > 0) {
+		for (int i=0; i<roll.getTrackCount(); i++) {
+			for (int j=0; j<roll[i].getEventCount(); j++) {
+				MidiEvent& event = roll[i][j];
+				if (!event.isNoteOn() || !event.isLinked()) {
+					continue;
+				}
+				SegmentNote note;
+				note.start = event.tick;
+				note.end   = event.getLinkedEvent()->tick;
+				note.key   = (i * 16 + event.getChannel()) * 128 + event.getKeyNumber();
+				longest = std::max(longest, note.end - note.start);
+				notes.push_back(note);
+			}
+		}
+		std::sort(notes.begin(), notes.end(),
+			[](const SegmentNote& a, const SegmentNote& b) {
+				return a.start < b.start;
+			});
+	}
+
+	m_starts.clear();
+	m_starts.push_back(0);
+	for (int i=0; i<(int)targets.size(); i++) {
+		int tick = targets[i];
+		if (m_margin > 0) {
+			tick = findQuietTick(notes, longest, tick);
+		}
+		if (tick > m_starts.back()) {
+			m_starts.push_back(tick);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::findSegment -- Return the index of the segment which
+//     contains the tick.
+//
+
+int RollSegmenter::findSegment(int tick) const {
+	auto it = std::upper_bound(m_starts.begin(), m_starts.end(), tick);
+	int index = (int)(it - m_starts.begin()) - 1;
+	return index < 0 ? 0 : index;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::findQuietTick -- Return the note-on tick closest to the
+//     given tick (trying up to SEGMENT_SEARCH notes on each side) which
+//     is quiet in the sense of isQuiet(), or -1 if none are.
+//
+
+int RollSegmenter::findQuietTick(const std::vector<SegmentNote>& notes,
+		int longest, int tick) const {
+	if (isQuiet(notes, longest, tick)) {
+		return tick;
+	}
+	int index = findNote(notes, tick);
+	int later = index;
+	int earlier = index - 1;
+	for (int i=0; i<SEGMENT_SEARCH; i++) {
+		while ((later < (int)notes.size()) && (notes[later].start == tick)) {
+			later++;
+		}
+		if (later < (int)notes.size()) {
+			if (isQuiet(notes, longest, notes[later].start)) {
+				return notes[later].start;
+			}
+			later++;
+		}
+		if (earlier >= 0) {
+			if (isQuiet(notes, longest, notes[earlier].start)) {
+				return notes[earlier].start;
+			}
+			earlier--;
+		}
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::isQuiet -- Return true if no note starting before the
+//     tick is followed by a note on the same key which starts at or
+//     after the tick and before the end of the first note plus the margin.
+//
+
+bool RollSegmenter::isQuiet(const std::vector<SegmentNote>& notes,
+		int longest, int tick) const {
+	// open == keys of notes before the tick, with the end of each plus
+	// the margin.
+	std::vector<std::pair<int, int>> open;
+	int index = findNote(notes, tick);
+	int limit = tick;
+	// (a note which ends before the tick minus the margin is not open):
+	for (int i=findNote(notes, tick - longest - m_margin); i<index; i++) {
+		int end = notes[i].end + m_margin;
+		if (end > tick) {
+			open.push_back(std::make_pair(notes[i].key, end));
+			limit = std::max(limit, end);
+		}
+	}
+	if (open.empty()) {
+		return true;
+	}
+	std::sort(open.begin(), open.end());
+	for (int i=index; (i<(int)notes.size()) && (notes[i].start < limit); i++) {
+		auto it = std::lower_bound(open.begin(), open.end(),
+				std::make_pair(notes[i].key + 1, INT_MIN));
+		if ((it != open.begin()) && ((it-1)->first == notes[i].key) &&
+				(notes[i].start < (it-1)->second)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::findNote -- Return the index of the first note which
+//     starts at or after the tick.
+//
+
+int RollSegmenter::findNote(const std::vector<SegmentNote>& notes,
+		int tick) const {
+	auto it = std::lower_bound(notes.begin(), notes.end(), tick,
+		[](const SegmentNote& note, int value) {
+			return note.start < value;
+		});
+	return (int)(it - notes.begin());
+}
+
+
+
+//////////////////////////////
+//
+// RollSegmenter::getThreads -- Return the number of threads to use.
+//
+
+int RollSegmenter::getThreads(void) const {
+	int threads = m_threads;
+	if (threads == 0) {
+		threads = (int)std::thread::hardware_concurrency();
+	}
+	return threads < 1 ? 1 : threads;
+}
+
+
+} // end smf namespace
+
+
+
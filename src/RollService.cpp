@@ -0,0 +1,579 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:31:09 PDT 2026
+// Last Modified: Sun Oct 18 19:27:07 PDT 2026
+// Filename:      midiroll/src/RollService.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   Answer queries about MIDI rolls (the same as the output
+//                of notelist, tick2time, rolltext and countnotes) from a
+//                cache of parsed rolls, over a Unix-domain socket.
+//
+//                A request is a command name, options and a filename (the
+//                rest of the request after the options):
+//
+//                   notelist   [-t tick]    file.mid
+//                   tick2time                file.mid
+//                   rolltext   [-m] [-t]     file.mid
+//                   countnotes [-s] [-t]     file.mid
+//                   cache
+//
+//                The output is the same as running the tool with the same
+//                options on the file.  The output is also kept with the
+//                roll in the cache, so a repeated query only needs to be
+//                copied.  "cache" reports the number of rolls and memory
+//                used by the cache.  Relative filenames are relative to the
+//                directory of the server.
+//
+//                Each message on the socket (in either direction) is a
+//                frame: the length of the data as a 4-byte big-endian
+//                number, followed by the data.  The client sends a request
+//                frame, and the server replies with a frame containing
+//                "OK\n" followed by the output, or "ERROR\n" followed by an
+//                error message.  Any number of requests can be sent on one
+//                connection.  A fixed number of threads in the server
+//                answer connections, so further clients wait until one of
+//                the connected clients disconnects.
+//
+//                The server reads any file which its user can read, so
+//                the socket is only accessible to the same user: it is in
+//                $XDG_RUNTIME_DIR, or else in a /tmp/rolld-<uid> directory
+//                which only the user can access, and the socket itself is
+//                created with permissions 0600.
+//
+
+#include "RollService.h"
+#include "RollReport.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollService::RollService -- Class constructor.  The cache bytes is the
+//     estimated memory that the cached rolls can use.
+//
+
+RollService::RollService(long long cachebytes) : m_cache(cachebytes) { }
+
+
+
+//////////////////////////////
+//
+// RollService::~RollService -- Class deconstructor.
+//
+
+RollService::~RollService() { }
+
+
+
+//////////////////////////////
+//
+// RollService::answer -- Answer a request.  Returns false if the request
+//     cannot be answered, with the reason in the output.
+//
+
+bool RollService::answer(const std::string& request, std::string& output) {
+	output.clear();
+	std::string command;
+	std::vector<std::string> options;
+	std::string filename;
+	if (!parseRequest(request, command, options, filename)) {
+		output = "cannot parse request: " + request;
+		return false;
+	}
+
+	if (command == "cache") {
+		std::stringstream out;
+		out << "rolls\t"  << m_cache.getRollCount() << "\n";
+		out << "bytes\t"  << m_cache.getBytes()     << "\n";
+		out << "max\t"    << m_cache.getMaxBytes()  << "\n";
+		out << "hits\t"   << m_cache.getHits()      << "\n";
+		out << "misses\t" << m_cache.getMisses()    << "\n";
+		output = out.str();
+		return true;
+	}
+
+	// options of each command:
+	bool metadataQ = false;
+	bool ticksQ    = false;
+	bool sumQ      = false;
+	bool tickQ     = false;
+	int  tick      = 0;
+	for (int i=0; i<(int)options.size(); i++) {
+		const std::string& option = options[i];
+		if ((command == "notelist") && (option == "-t")
+				&& (i + 1 < (int)options.size())) {
+			tickQ = true;
+			tick = atoi(options[++i].c_str());
+		} else if ((command == "rolltext") && (option == "-m")) {
+			metadataQ = true;
+		} else if ((command == "rolltext") && (option == "-t")) {
+			ticksQ = true;
+		} else if ((command == "countnotes") && (option == "-s")) {
+			sumQ = true;
+		} else if ((command == "countnotes") && (option == "-t")) {
+			ticksQ = true;
+		} else {
+			output = "unknown option for " + command + ": " + option;
+			return false;
+		}
+	}
+	if ((command != "notelist") && (command != "tick2time")
+			&& (command != "rolltext") && (command != "countnotes")) {
+		output = "unknown command: " + command;
+		return false;
+	}
+	if (filename.empty()) {
+		output = "no filename given";
+		return false;
+	}
+
+	std::shared_ptr<CachedRoll> roll = m_cache.get(filename);
+	if (roll == NULL) {
+		output = "cannot read file: " + filename;
+		return false;
+	}
+
+	std::string query = command;
+	for (int i=0; i<(int)options.size(); i++) {
+		query += " " + options[i];
+	}
+	std::unique_lock<std::mutex> lock(roll->mutex);
+	auto it = roll->answers.find(query);
+	if (it != roll->answers.end()) {
+		output = it->second;
+		return true;
+	}
+
+	std::stringstream out;
+	if (command == "notelist") {
+		if (tickQ) {
+			RollReport::printSoundingNotes(roll->roll, tick, out);
+		} else {
+			RollReport::printNoteList(roll->joined, out);
+		}
+	} else if (command == "tick2time") {
+		RollReport::printTickToTime(roll->joined, out);
+	} else if (command == "rolltext") {
+		RollReport::printText(roll->roll, metadataQ, ticksQ, out);
+	} else if (command == "countnotes") {
+		std::vector<int> keycount;
+		std::vector<int> firsttick;
+		int sum = RollReport::countNotes(roll->roll, keycount, firsttick);
+		if (sumQ) {
+			out << sum << "\n";
+		} else {
+			int duration = ticksQ ? roll->roll.getFileDurationInTicks() : 0;
+			RollReport::printNoteCounts(keycount, firsttick, duration, out);
+		}
+	}
+	output = out.str();
+	roll->answers[query] = output;
+	lock.unlock();
+	m_cache.addBytes(roll, (long long)(query.size() + output.size()));
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::setThreadCount -- Set the number of connections answered
+//     at the same time.  A count of 0 uses ROLL_THREADS.
+//
+
+void RollService::setThreadCount(int count) {
+	m_threads = count < 0 ? 0 : count;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::getThreadCount -- Return the number of connections
+//     answered at the same time (0 for ROLL_THREADS).
+//
+
+int RollService::getThreadCount(void) const {
+	return m_threads;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::serve -- Answer requests on a Unix-domain socket until the
+//     process is stopped.  An empty socket path uses getDefaultSocket().
+//     An old socket left by a server which is no longer running is
+//     removed, but the server will not start if another server is
+//     answering on the socket, or if the path is not a socket.  Each of
+//     the server threads accepts and answers one connection at a time.
+//     Returns 1 if the socket cannot be opened.
+//
+
+int RollService::serve(const std::string& path) {
+	std::string socketpath = path.empty() ? getDefaultSocket() : path;
+
+	// A client which disconnects before reading its answer should not
+	// stop the server:
+	signal(SIGPIPE, SIG_IGN);
+
+	if (!makeSocketDirectory(socketpath)) {
+		return 1;
+	}
+	struct stat info;
+	if (lstat(socketpath.c_str(), &info) == 0) {
+		if (!S_ISSOCK(info.st_mode)) {
+			std::cerr << "Error: " << socketpath << " exists and is not a socket"
+			          << std::endl;
+			return 1;
+		}
+		int running = connect(socketpath);
+		if (running >= 0) {
+			close(running);
+			std::cerr << "Error: a server is already running on " << socketpath
+			          << std::endl;
+			return 1;
+		}
+		unlink(socketpath.c_str());
+	}
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketpath.size() >= sizeof(address.sun_path)) {
+		std::cerr << "Error: socket name is too long: " << socketpath << std::endl;
+		return 1;
+	}
+	strcpy(address.sun_path, socketpath.c_str());
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0) {
+		std::cerr << "Error: cannot create socket: " << strerror(errno) << std::endl;
+		return 1;
+	}
+	// Only the user of the server may connect:
+	mode_t oldmask = umask(0177);
+	int status = bind(server, (struct sockaddr*)&address, sizeof(address));
+	umask(oldmask);
+	if ((status != 0) || (chmod(socketpath.c_str(), 0600) != 0)) {
+		std::cerr << "Error: cannot open socket " << socketpath << ": "
+		          << strerror(errno) << std::endl;
+		close(server);
+		return 1;
+	}
+	if (listen(server, 64) != 0) {
+		std::cerr << "Error: cannot listen on socket " << socketpath << ": "
+		          << strerror(errno) << std::endl;
+		close(server);
+		return 1;
+	}
+
+	int threadcount = m_threads > 0 ? m_threads : ROLL_THREADS;
+	std::vector<std::thread> threads;
+	for (int i=0; i<threadcount; i++) {
+		threads.emplace_back(&RollService::acceptConnections, this, server);
+	}
+	for (int i=0; i<(int)threads.size(); i++) {
+		threads[i].join();
+	}
+	close(server);
+	unlink(socketpath.c_str());
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::getCache -- Return the cache of parsed rolls.
+//
+
+RollCache& RollService::getCache(void) {
+	return m_cache;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::getDefaultSocket -- Return the socket used when no socket
+//     is given: rolld.socket in $XDG_RUNTIME_DIR (a directory which
+//     only belongs to the user), or in /tmp/rolld-<uid> if the variable
+//     is not set.
+//
+
+std::string RollService::getDefaultSocket(void) {
+	const char* runtime = getenv("XDG_RUNTIME_DIR");
+	if ((runtime != NULL) && (runtime[0] != '\0')) {
+		return std::string(runtime) + "/" + ROLL_SOCKET;
+	}
+	return "/tmp/rolld-" + std::to_string(getuid()) + "/" + ROLL_SOCKET;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::connect -- Connect to a server (getDefaultSocket() if the
+//     socket path is empty).  Returns the socket, or -1 if the server
+//     cannot be reached.
+//
+
+int RollService::connect(const std::string& path) {
+	std::string socketpath = path.empty() ? getDefaultSocket() : path;
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketpath.size() >= sizeof(address.sun_path)) {
+		return -1;
+	}
+	strcpy(address.sun_path, socketpath.c_str());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	if (::connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::request -- Send a request to a server and read the answer.
+//     The status is false if the server could not answer the request
+//     (the output is then the reason).  Returns false if the connection
+//     failed.
+//
+
+bool RollService::request(int fd, const std::string& request,
+		std::string& output, bool& status) {
+	std::string reply;
+	if (!writeFrame(fd, request) || !readFrame(fd, reply)) {
+		return false;
+	}
+	size_t newline = reply.find('\n');
+	if (newline == std::string::npos) {
+		return false;
+	}
+	status = reply.compare(0, newline, "OK") == 0;
+	output = reply.substr(newline + 1);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::readFrame -- Read one frame from a socket.  Returns false
+//     at the end of the connection or if the frame is too large.
+//
+
+bool RollService::readFrame(int fd, std::string& data) {
+	unsigned char header[4];
+	size_t count = 0;
+	while (count < 4) {
+		ssize_t size = read(fd, header + count, 4 - count);
+		if ((size < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (size <= 0) {
+			return false;
+		}
+		count += size;
+	}
+	size_t length = ((size_t)header[0] << 24) | ((size_t)header[1] << 16)
+			| ((size_t)header[2] << 8) | (size_t)header[3];
+	if (length > ROLL_FRAME_MAX) {
+		return false;
+	}
+	data.resize(length);
+	count = 0;
+	while (count < length) {
+		ssize_t size = read(fd, &data[count], length - count);
+		if ((size < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (size <= 0) {
+			return false;
+		}
+		count += size;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::writeFrame -- Write one frame to a socket.  Returns false
+//     if the connection is closed.
+//
+
+bool RollService::writeFrame(int fd, const std::string& data) {
+	if (data.size() > ROLL_FRAME_MAX) {
+		return false;
+	}
+	std::string frame(4, '\0');
+	frame[0] = (char)((data.size() >> 24) & 0xff);
+	frame[1] = (char)((data.size() >> 16) & 0xff);
+	frame[2] = (char)((data.size() >> 8) & 0xff);
+	frame[3] = (char)(data.size() & 0xff);
+	frame += data;
+	size_t count = 0;
+	while (count < frame.size()) {
+		ssize_t size = write(fd, frame.data() + count, frame.size() - count);
+		if ((size < 0) && (errno == EINTR)) {
+			continue;
+		}
+		if (size <= 0) {
+			return false;
+		}
+		count += size;
+	}
+	return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollService::acceptConnections -- Accept connections on the server
+//     socket and answer them one at a time (in each server thread).
+//     Returns if the socket fails.
+//
+
+void RollService::acceptConnections(int server) {
+	while (true) {
+		int client = accept(server, NULL, NULL);
+		if (client < 0) {
+			if ((errno == EINTR) || (errno == ECONNABORTED)) {
+				continue;
+			}
+			std::cerr << "Error: cannot accept connection: " << strerror(errno)
+			          << std::endl;
+			return;
+		}
+		handleConnection(client);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollService::handleConnection -- Answer the requests from one client
+//     until it disconnects.
+//
+
+void RollService::handleConnection(int fd) {
+	std::string request;
+	std::string output;
+	while (readFrame(fd, request)) {
+		bool status = answer(request, output);
+		if (!writeFrame(fd, (status ? "OK\n" : "ERROR\n") + output)) {
+			break;
+		}
+	}
+	close(fd);
+}
+
+
+
+//////////////////////////////
+//
+// RollService::makeSocketDirectory -- Create the /tmp/rolld-<uid>
+//     directory of the default socket with access only for the user.
+//     Other directories are left to the caller.  Returns false if the
+//     directory cannot be created, or if it already exists but belongs
+//     to another user or can be used by other users.
+//
+
+bool RollService::makeSocketDirectory(const std::string& socketpath) {
+	std::string directory = "/tmp/rolld-" + std::to_string(getuid());
+	if (socketpath.compare(0, directory.size() + 1, directory + "/") != 0) {
+		return true;
+	}
+	if ((mkdir(directory.c_str(), 0700) != 0) && (errno != EEXIST)) {
+		std::cerr << "Error: cannot create directory " << directory << ": "
+		          << strerror(errno) << std::endl;
+		return false;
+	}
+	struct stat info;
+	if ((lstat(directory.c_str(), &info) != 0) || !S_ISDIR(info.st_mode)
+			|| (info.st_uid != getuid()) || ((info.st_mode & 0077) != 0)) {
+		std::cerr << "Error: " << directory
+		          << " is not a private directory of this user" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// RollService::parseRequest -- Split a request into the command, the
+//     options (words starting with "-", and the number after "-t" for
+//     notelist) and the filename (the rest of the request).
+//
+
+bool RollService::parseRequest(const std::string& request,
+		std::string& command, std::vector<std::string>& options,
+		std::string& filename) {
+	command.clear();
+	options.clear();
+	filename.clear();
+	const char* spaces = " \t\r\n";
+	size_t start = request.find_first_not_of(spaces);
+	while (start != std::string::npos) {
+		size_t end = request.find_first_of(spaces, start);
+		std::string word = request.substr(start, end == std::string::npos ?
+				std::string::npos : end - start);
+		bool valueQ = (command == "notelist") && !options.empty()
+				&& (options.back() == "-t");
+		if (command.empty()) {
+			command = word;
+		} else if ((word[0] == '-') || valueQ) {
+			options.push_back(word);
+		} else {
+			size_t last = request.find_last_not_of(spaces);
+			filename = request.substr(start, last - start + 1);
+			break;
+		}
+		if (end == std::string::npos) {
+			break;
+		}
+		start = request.find_first_not_of(spaces, end);
+	}
+	return !command.empty();
+}
+
+
+} // end smf namespace
+
+
+
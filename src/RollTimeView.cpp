@@ -0,0 +1,256 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:38:48 PDT 2026
+// Last Modified: Sun Oct 18 18:53:12 PDT 2026
+// Filename:      midiroll/src/RollTimeView.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   A read-only view of the event times of a MIDI roll in
+//                seconds, milliseconds or any other rate, optionally
+//                scaled by a tempo factor, without changing the roll.
+//
+//                Converting a roll to millisecond ticks or applying a
+//                tempo factor rewrites the events of the roll.  A view
+//                instead calculates the time of any tick on request from
+//                its own copy of the roll's tempo map (or of the tempo
+//                steps of the roll's acceleration model), so several views with
+//                different units or tempo factors can read the same roll.
+//                The timing is calculated when the roll is given to the
+//                view, and refresh() must be called if the tempo of the
+//                roll changes afterwards.  Queries do not change the view
+//                or the roll, so a view can be read from several threads.
+//                Ticks are absolute ticks.
+//
+
+#include "RollTimeView.h"
+
+#include <utility>
+#include <vector>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// RollTimeView::RollTimeView -- Class constructors.
+//
+// default values: rate = 1.0 (seconds), tempofactor = 1.0
+//
+
+RollTimeView::RollTimeView(void) { }
+
+
+RollTimeView::RollTimeView(const MidiRoll& roll, double rate,
+		double tempofactor) {
+	m_roll = &roll;
+	setRate(rate);
+	setTempoFactor(tempofactor);
+	refresh();
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::~RollTimeView -- Class deconstructor.
+//
+
+RollTimeView::~RollTimeView() {
+	m_roll = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::setRoll -- View a different roll.
+//
+
+void RollTimeView::setRoll(const MidiRoll& roll) {
+	m_roll = &roll;
+	refresh();
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::getRoll -- Return the roll being viewed, or NULL if none.
+//
+
+const MidiRoll* RollTimeView::getRoll(void) const {
+	return m_roll;
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::setRate -- Set the number of time units per second:
+//     1.0 for seconds, 1000.0 for milliseconds.  Non-positive values
+//     are ignored.
+//
+
+void RollTimeView::setRate(double rate) {
+	if (rate <= 0.0) {
+		std::cerr << "Error: time rate must be positive: " << rate << std::endl;
+		return;
+	}
+	m_rate = rate;
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::getRate -- Return the number of time units per second.
+//
+
+double RollTimeView::getRate(void) const {
+	return m_rate;
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::setTempoFactor -- Set the speed-up of the roll.  A factor
+//     of 1.5 plays the roll 50% faster, like "tempomm -f 1.5".  Non-positive
+//     values are ignored.
+//
+
+void RollTimeView::setTempoFactor(double factor) {
+	if (factor <= 0.0) {
+		std::cerr << "Error: tempo factor must be positive: " << factor << std::endl;
+		return;
+	}
+	m_tempofactor = factor;
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::getTempoFactor -- Return the speed-up of the roll.
+//
+
+double RollTimeView::getTempoFactor(void) const {
+	return m_tempofactor;
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::refresh -- Recalculate the timing of the roll, such as
+//     after its tempo or acceleration has changed.
+//
+
+void RollTimeView::refresh(void) {
+	if (m_roll == NULL) {
+		m_tempomap.clear();
+	} else if (m_roll->hasAccelerationModel()) {
+		// same times as MidiRoll::getRollTimeInSeconds():
+		std::vector<std::pair<int, int>> tempos;
+		m_roll->getAccelerationTempos(tempos);
+		m_tempomap.build(m_roll->getTicksPerQuarterNote(), tempos);
+	} else {
+		m_tempomap.build(*m_roll);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::getTime -- Return the time of an absolute tick (or of an
+//     event, which must have an absolute tick) in the units of the view.
+//     Returns -1.0 for negative ticks, or if there is no roll.
+//
+
+double RollTimeView::getTime(double tick) const {
+	double seconds = getSeconds(tick);
+	if (seconds < 0.0) {
+		return -1.0;
+	}
+	return seconds / m_tempofactor * m_rate;
+}
+
+
+double RollTimeView::getTime(const MidiEvent& event) const {
+	return getTime(event.tick);
+}
+
+
+double RollTimeView::getTime(int track, int index) const {
+	if (m_roll == NULL) {
+		return -1.0;
+	}
+	return getTime((*m_roll)[track][index].tick);
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::getTick -- Return the (fractional) absolute tick at a
+//     time given in the units of the view.  Returns -1.0 for negative
+//     times, times which an accelerating roll never reaches, or if
+//     there is no roll.
+//
+
+double RollTimeView::getTick(double time) const {
+	if ((m_roll == NULL) || (time < 0.0)) {
+		return -1.0;
+	}
+	double seconds = time / m_rate * m_tempofactor;
+	return m_tempomap.getAbsoluteTickTime(seconds);
+}
+
+
+
+//////////////////////////////
+//
+// RollTimeView::getDuration -- Return the time of the last event in
+//     the roll in the units of the view.
+//
+
+double RollTimeView::getDuration(void) const {
+	if (m_roll == NULL) {
+		return 0.0;
+	}
+	int lasttick = 0;
+	for (int i=0; i<m_roll->getTrackCount(); i++) {
+		const MidiEventList& track = (*m_roll)[i];
+		if ((track.getEventCount() > 0) && (track.back().tick > lasttick)) {
+			lasttick = track.back().tick;
+		}
+	}
+	return getTime(lasttick);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// private functions
+//
+
+//////////////////////////////
+//
+// RollTimeView::getSeconds -- Return the time in seconds of an absolute
+//     tick at the original tempo of the roll.
+//
+
+double RollTimeView::getSeconds(double tick) const {
+	if ((m_roll == NULL) || (tick < 0.0)) {
+		return -1.0;
+	}
+	return m_tempomap.getTimeInSeconds(tick);
+}
+
+
+} // end smf namespace
+
+
+
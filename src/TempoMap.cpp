@@ -0,0 +1,549 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:25:30 PDT 2026
+// Last Modified: Sun Oct 18 19:24:16 PDT 2026
+// Filename:      midiroll/src/TempoMap.cpp
+// Syntax:        C++11
+// vim:           ts=3 expandtab
+//
+// Description:   A class which converts between absolute ticks and
+//                time in seconds using the tempo messages of a MidiFile.
+//                The tempo messages divide the file into segments with
+//                a constant number of seconds per tick.  Each segment
+//                stores the time in seconds at its start, so a conversion
+//                is a binary search for the segment followed by a
+//                multiply-add.  A tempo message at a given tick applies to
+//                the time after that tick.
+//
+
+#include "TempoMap.h"
+#include "MidiFile.h"
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <climits>
+#include <cmath>
+
+// The AVX kernel is compiled for AVX with a function attribute and is
+// only used if the processor supports it, since the library is not built
+// with -mavx:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#include <immintrin.h>
+	#define TEMPOMAP_AVX_DISPATCH
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// TempoMap::TempoMap -- Constructor.
+//
+
+TempoMap::TempoMap(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::~TempoMap -- Deconstructor.
+//
+
+TempoMap::~TempoMap() {
+	m_segments.clear();
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::clear -- Reset to a constant tempo of 120 beats per minute
+//    at 120 ticks per quarter note.
+//
+
+void TempoMap::clear(void) {
+	m_tpq = 120;
+	m_segments.resize(1);
+	m_segments[0].tick    = 0;
+	m_segments[0].seconds = 0.0;
+	m_segments[0].spt     = 60.0 / (120.0 * m_tpq);
+	m_segments[0].tps     = 1.0 / m_segments[0].spt;
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::swap -- Exchange the contents of two tempo maps.
+//
+
+void TempoMap::swap(TempoMap& other) {
+	m_segments.swap(other.m_segments);
+	std::swap(m_tpq, other.m_tpq);
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::build -- Calculate the tempo segments from the tempo messages
+//    in all tracks of a MIDI file.  The tempo is 120 beats per minute until
+//    the first tempo message.  If there are several tempo messages at the
+//    same tick, the last one in track order is used.
+//
+
+void TempoMap::build(const MidiFile& midifile) {
+	m_tpq = midifile.getTicksPerQuarterNote();
+	m_segments.resize(1);
+	m_segments[0].tick    = 0;
+	m_segments[0].seconds = 0.0;
+	m_segments[0].spt     = 60.0 / (120.0 * m_tpq);
+	m_segments[0].tps     = 1.0 / m_segments[0].spt;
+	addTempos(midifile, 0);
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::build -- Calculate the tempo segments from a list of tempos
+//    given as pairs of (absolute tick, microseconds per quarter note) in
+//    tick order, such as the list made by simplify().  The segments are
+//    the same as those built from tempo messages with the same values.
+//
+
+void TempoMap::build(int tpq, const std::vector<std::pair<int, int>>& tempos) {
+	clear();
+	m_tpq = tpq;
+	m_segments[0].spt = 60.0 / (120.0 * m_tpq);
+	m_segments[0].tps = 1.0 / m_segments[0].spt;
+	std::vector<std::pair<int, double>> values(tempos.size());
+	for (int i=0; i<(int)tempos.size(); i++) {
+		values[i].first  = tempos[i].first;
+		values[i].second = (double)tempos[i].second / 1000000.0 / tpq;
+	}
+	appendTempos(values);
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::update -- Recalculate the tempo segments starting at the
+//    given absolute tick, keeping the segments before it.  Use when the
+//    tempo messages before that tick have not changed.  The whole map
+//    is rebuilt if the ticks per quarter note has changed.
+//
+
+void TempoMap::update(const MidiFile& midifile, int fromtick) {
+	if ((fromtick <= 0) || (m_tpq != midifile.getTicksPerQuarterNote())) {
+		build(midifile);
+		return;
+	}
+	auto it = std::lower_bound(m_segments.begin() + 1, m_segments.end(),
+			fromtick,
+		[](const TempoSegment& segment, int value) {
+			return segment.tick < value;
+		}
+	);
+	m_segments.erase(it, m_segments.end());
+	addTempos(midifile, fromtick);
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::getTimeInSeconds -- Return the time in seconds of an absolute
+//    tick.  Times after the last tempo message are calculated with the
+//    last tempo.  Returns -1.0 for negative ticks.
+//
+
+double TempoMap::getTimeInSeconds(double tick) const {
+	if (tick < 0.0) {
+		return -1.0;
+	}
+	const TempoSegment& segment = m_segments[findSegmentByTick(tick)];
+	return segment.seconds + (tick - segment.tick) * segment.spt;
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::getAbsoluteTickTime -- Return the (fractional) absolute tick
+//    at a time in seconds.  Returns -1.0 for negative times.
+//
+
+double TempoMap::getAbsoluteTickTime(double seconds) const {
+	if (seconds < 0.0) {
+		return -1.0;
+	}
+	const TempoSegment& segment = m_segments[findSegmentBySeconds(seconds)];
+	return segment.tick + (seconds - segment.seconds) * segment.tps;
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::getSecondsPerTick -- Return the tempo at the given tick in
+//    seconds per tick.
+//
+
+double TempoMap::getSecondsPerTick(double tick) const {
+	return m_segments[findSegmentByTick(tick)].spt;
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::convertTicks -- Convert a list of absolute ticks into ticks
+//    at the given rate per second (1000.0 for milliseconds), rounded to
+//    the nearest integer.  The output list can be the same as the input
+//    list.  Consecutive ticks in the same tempo segment are converted
+//    together with SIMD instructions when available, so the input should
+//    be sorted for best performance.  The results are the same as
+//    int(getTimeInSeconds(tick) * rate + 0.5).
+//
+
+void TempoMap::convertTicks(const int* ticks, int* output, int count,
+		double rate) const {
+	int lastsegment = (int)m_segments.size() - 1;
+	int i = 0;
+	while (i < count) {
+		int tick = ticks[i];
+		if (tick < 0) {
+			output[i] = int(getTimeInSeconds(tick) * rate + 0.5);
+			i++;
+			continue;
+		}
+		int index = findSegmentByTick(tick);
+		int start = m_segments[index].tick;
+		int end   = index < lastsegment ? m_segments[index+1].tick : INT_MAX;
+		int j = i + 1;
+		while ((j < count) && (ticks[j] >= start) && (ticks[j] < end)) {
+			j++;
+		}
+		convertSegmentTicks(ticks + i, output + i, j - i, m_segments[index],
+				rate);
+		i = j;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::simplify -- Calculate a list of tempo changes, as pairs of
+//    (absolute tick, microseconds per quarter note), which reproduces the
+//    times of the tempo map within the given tolerance in seconds up to
+//    the given end tick, using as few tempo changes as possible.
+//
+//    The times of a tempo map are a piecewise-linear function of ticks
+//    with corners at the tempo changes, so the difference between two
+//    tempo maps is largest at one of their corners.  Starting from a
+//    tempo change, a single tempo can replace the following ones if its
+//    line passes within the tolerance of every corner which it covers.
+//    The allowed slopes from the start narrow with each corner, so the
+//    furthest corner which can be reached is found in one pass.  Tempos
+//    are rounded to whole microseconds as in MIDI files, and the rounding
+//    is included when checking the tolerance.  If no tempo can be merged,
+//    the original tempo is kept, which does not add any error.
+//
+
+void TempoMap::simplify(double tolerance, int endtick,
+		std::vector<std::pair<int, int>>& tempos) const {
+	tempos.clear();
+	if (tolerance < 0.0) {
+		tolerance = 0.0;
+	}
+	int segcount = (int)m_segments.size();
+	std::vector<int> ticks(segcount);
+	std::vector<double> times(segcount);
+	std::vector<int> micro(segcount);
+	for (int i=0; i<segcount; i++) {
+		ticks[i] = m_segments[i].tick;
+		times[i] = m_segments[i].seconds;
+		micro[i] = int(m_segments[i].spt * m_tpq * 1000000.0 + 0.5);
+	}
+	if (endtick > ticks.back()) {
+		ticks.push_back(endtick);
+		times.push_back(getTimeInSeconds(endtick));
+	}
+
+	int    corners = (int)ticks.size();
+	int    a       = 0;
+	double atime   = 0.0;  // time of corner a in the simplified map
+	while (a < corners - 1) {
+		double lo = -1.0e300;
+		double hi = 1.0e300;
+		int best = -1;
+		int bestmicro = 0;
+		for (int b=a+1; b<corners; b++) {
+			double dt = ticks[b] - ticks[a];
+			double slope = (times[b] - atime) / dt;
+			double value = slope * m_tpq * 1000000.0 + 0.5;
+			int usec = value < 1.0 ? 1 : (value > 0xffffff ? 0xffffff : int(value));
+			double spt = (double)usec / 1000000.0 / m_tpq;
+			double error = atime + spt * dt - times[b];
+			if ((std::fabs(error) <= tolerance) && (spt >= lo) && (spt <= hi)) {
+				best = b;
+				bestmicro = usec;
+			}
+			// corner b is covered by the slopes from a for later corners:
+			lo = std::max(lo, (times[b] - tolerance - atime) / dt);
+			hi = std::min(hi, (times[b] + tolerance - atime) / dt);
+			if (lo > hi) {
+				break;
+			}
+		}
+		if (best < 0) {
+			best = a + 1;
+			bestmicro = micro[a];
+		}
+		tempos.emplace_back(ticks[a], bestmicro);
+		double spt = (double)bestmicro / 1000000.0 / m_tpq;
+		atime += spt * (ticks[best] - ticks[a]);
+		a = best;
+	}
+	if (a < segcount) {
+		// the last corner is a tempo change which is in effect to the end:
+		tempos.emplace_back(ticks[a], micro[a]);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::getSegmentCount -- Return the number of tempo segments.
+//    There is always at least one segment.
+//
+
+int TempoMap::getSegmentCount(void) const {
+	return (int)m_segments.size();
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::getSegment -- Return a tempo segment.  Segments are in
+//    tick order.
+//
+
+const TempoSegment& TempoMap::getSegment(int index) const {
+	return m_segments[index];
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::getTicksPerQuarterNote -- Return the ticks per quarter note
+//    used to calculate the tempos.
+//
+
+int TempoMap::getTicksPerQuarterNote(void) const {
+	return m_tpq;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions
+//
+
+//////////////////////////////
+//
+// TempoMap::addTempos -- Append segments for the tempo messages at or
+//    after the given absolute tick.  The existing segments must all
+//    start before that tick.
+//
+
+void TempoMap::addTempos(const MidiFile& midifile, int fromtick) {
+	// list of tempo messages as (absolute tick, seconds per tick):
+	std::vector<std::pair<int, double>> tempos;
+	for (int i=0; i<midifile.getTrackCount(); i++) {
+		const MidiEventList& track = midifile[i];
+		if (midifile.isDeltaTicks()) {
+			int tick = 0;
+			for (int j=0; j<track.getEventCount(); j++) {
+				tick += track[j].tick;
+				if ((tick >= fromtick) && track[j].isTempo()) {
+					tempos.emplace_back(tick, track[j].getTempoSPT(m_tpq));
+				}
+			}
+		} else {
+			const std::vector<MidiEvent*>& events =
+					track.getEventsOfKind(EVENT_KIND_TEMPO);
+			for (int j=0; j<(int)events.size(); j++) {
+				if ((events[j]->tick >= fromtick) && events[j]->isTempo()) {
+					tempos.emplace_back(events[j]->tick, events[j]->getTempoSPT(m_tpq));
+				}
+			}
+		}
+	}
+	std::stable_sort(tempos.begin(), tempos.end(),
+		[](const std::pair<int, double>& a, const std::pair<int, double>& b) {
+			return a.first < b.first;
+		}
+	);
+	appendTempos(tempos);
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::appendTempos -- Add segments for a list of tempos, as pairs
+//    of (absolute tick, seconds per tick) in tick order, after the last
+//    segment.  A tempo at the tick of the last segment replaces its tempo.
+//
+
+void TempoMap::appendTempos(const std::vector<std::pair<int, double>>& tempos) {
+	for (int i=0; i<(int)tempos.size(); i++) {
+		int    tick = tempos[i].first;
+		double spt  = tempos[i].second;
+		if ((tick < 0) || (spt <= 0.0)) {
+			continue;
+		}
+		TempoSegment& last = m_segments.back();
+		if (tick == last.tick) {
+			last.spt = spt;
+			last.tps = 1.0 / spt;
+			continue;
+		}
+		TempoSegment segment;
+		segment.tick    = tick;
+		segment.seconds = last.seconds + (tick - last.tick) * last.spt;
+		segment.spt     = spt;
+		segment.tps     = 1.0 / spt;
+		m_segments.push_back(segment);
+	}
+}
+
+
+
+#if defined(TEMPOMAP_AVX_DISPATCH)
+
+//////////////////////////////
+//
+// convertSegmentTicksAvx -- Convert ticks four at a time with AVX for
+//    TempoMap::convertSegmentTicks().  Returns the number of ticks which
+//    were converted (a multiple of four).
+//
+
+__attribute__((target("avx")))
+static int convertSegmentTicksAvx(const int* ticks, int* output, int count,
+		int tick, double seconds, double spt, double rate) {
+	__m128i vtick    = _mm_set1_epi32(tick);
+	__m256d vseconds = _mm256_set1_pd(seconds);
+	__m256d vspt     = _mm256_set1_pd(spt);
+	__m256d vrate    = _mm256_set1_pd(rate);
+	__m256d vhalf    = _mm256_set1_pd(0.5);
+	int i = 0;
+	for (; i+4<=count; i+=4) {
+		__m128i t = _mm_loadu_si128((const __m128i*)(ticks + i));
+		__m256d d = _mm256_cvtepi32_pd(_mm_sub_epi32(t, vtick));
+		d = _mm256_add_pd(vseconds, _mm256_mul_pd(d, vspt));
+		d = _mm256_add_pd(_mm256_mul_pd(d, vrate), vhalf);
+		_mm_storeu_si128((__m128i*)(output + i), _mm256_cvttpd_epi32(d));
+	}
+	return i;
+}
+
+#endif
+
+
+
+//////////////////////////////
+//
+// TempoMap::convertSegmentTicks -- Convert ticks which are all in the
+//    given tempo segment into ticks at the given rate per second.  Four
+//    ticks at a time are converted with AVX when the processor has it,
+//    then two at a time with SSE2.  The operations are done in the same
+//    order as the scalar calculation, so the vector and scalar results
+//    are identical.
+//
+
+void TempoMap::convertSegmentTicks(const int* ticks, int* output, int count,
+		const TempoSegment& segment, double rate) {
+	int i = 0;
+
+#if defined(TEMPOMAP_AVX_DISPATCH)
+	static const bool hasAvx = __builtin_cpu_supports("avx");
+	if (hasAvx) {
+		i = convertSegmentTicksAvx(ticks, output, count, segment.tick,
+				segment.seconds, segment.spt, rate);
+	}
+#endif
+
+#if defined(__SSE2__)
+	__m128i vtick    = _mm_set1_epi32(segment.tick);
+	__m128d vseconds = _mm_set1_pd(segment.seconds);
+	__m128d vspt     = _mm_set1_pd(segment.spt);
+	__m128d vrate    = _mm_set1_pd(rate);
+	__m128d vhalf    = _mm_set1_pd(0.5);
+	for (; i+2<=count; i+=2) {
+		__m128i t = _mm_loadl_epi64((const __m128i*)(ticks + i));
+		__m128d d = _mm_cvtepi32_pd(_mm_sub_epi32(t, vtick));
+		d = _mm_add_pd(vseconds, _mm_mul_pd(d, vspt));
+		d = _mm_add_pd(_mm_mul_pd(d, vrate), vhalf);
+		_mm_storel_epi64((__m128i*)(output + i), _mm_cvttpd_epi32(d));
+	}
+#endif
+
+	for (; i<count; i++) {
+		double seconds = segment.seconds + (ticks[i] - segment.tick) * segment.spt;
+		output[i] = int(seconds * rate + 0.5);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::findSegmentByTick -- Return the index of the last segment
+//    which starts at or before the given tick.
+//
+
+int TempoMap::findSegmentByTick(double tick) const {
+	auto it = std::upper_bound(m_segments.begin() + 1, m_segments.end(), tick,
+		[](double value, const TempoSegment& segment) {
+			return value < segment.tick;
+		}
+	);
+	return int(it - m_segments.begin()) - 1;
+}
+
+
+
+//////////////////////////////
+//
+// TempoMap::findSegmentBySeconds -- Return the index of the last segment
+//    which starts at or before the given time in seconds.
+//
+
+int TempoMap::findSegmentBySeconds(double seconds) const {
+	auto it = std::upper_bound(m_segments.begin() + 1, m_segments.end(),
+			seconds,
+		[](double value, const TempoSegment& segment) {
+			return value < segment.seconds;
+		}
+	);
+	return int(it - m_segments.begin()) - 1;
+}
+
+
+} // end of namespace smf
+
+
+
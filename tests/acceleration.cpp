@@ -0,0 +1,183 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 19:20:12 PDT 2026
+// Last Modified: Sun Oct 18 19:20:12 PDT 2026
+// Filename:      midiroll/tests/acceleration.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Check that tempo changes made to a roll with an
+//                acceleration model are kept when the roll is written
+//                and read again, and that the model is only written as
+//                tempo steps when it was set in the same session.
+//
+
+#include "MidiRoll.h"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+// function declarations:
+void    makeRoll           (MidiRoll& rollfile);
+void    rereadRoll         (MidiRoll& rollfile, MidiRoll& output);
+void    scaleTempos        (MidiRoll& rollfile, double factor);
+void    getTempos          (MidiRoll& rollfile, vector<int>& tempos);
+void    check              (bool condition, const string& message);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	MidiRoll original;
+	makeRoll(original);
+	original.setAccelerationModel(12.0, 0.04);
+	vector<pair<int, int>> steps;
+	original.getAccelerationTempos(steps);
+	check(steps.size() > 2, "the test roll should have several tempo steps");
+
+	// Writing a roll with a new model adds its tempo steps:
+	MidiRoll accelerated;
+	rereadRoll(original, accelerated);
+	check(accelerated.hasAccelerationModel(), "model not read back");
+	vector<int> tempos;
+	getTempos(accelerated, tempos);
+	check(tempos.size() == steps.size(), "tempo steps not written");
+	check(tempos[0] == 1000000, "first tempo step is not 60 bpm");
+
+	// Read accelerated roll, change the tempo, write and read again:
+	MidiRoll faster;
+	rereadRoll(accelerated, faster);
+	faster.clearAccelerationModel();
+	scaleTempos(faster, 2.0);
+	MidiRoll reread;
+	rereadRoll(faster, reread);
+	vector<int> newtempos;
+	getTempos(reread, newtempos);
+	check(newtempos.size() == tempos.size(), "tempo count changed");
+	for (int i=0; i<(int)newtempos.size(); i++) {
+		check(newtempos[i] == int(tempos[i] / 2.0 + 0.5),
+				"tempo change was lost when writing");
+	}
+	check(!reread.hasAccelerationModel(), "model kept after tempo change");
+	check(reread.getMetadata(ACCELERATION_STEP_KEY).empty(),
+			"model metadata kept after tempo change");
+
+	// The same, but changing the tempos without clearing the model: the
+	// tempos are still written unchanged, and the out-of-date model is
+	// ignored when reading.
+	MidiRoll direct;
+	rereadRoll(accelerated, direct);
+	scaleTempos(direct, 2.0);
+	rereadRoll(direct, reread);
+	getTempos(reread, newtempos);
+	check(newtempos.size() == tempos.size(), "tempo count changed");
+	check(newtempos[0] == 500000, "direct tempo change was lost when writing");
+	check(!reread.hasAccelerationModel(), "out-of-date model was read");
+	int lasttick = steps.back().first + 100;
+	check(reread.getRollTimeInSeconds(lasttick) ==
+			reread.getTimeInSeconds(lasttick), "roll times do not follow tempos");
+
+	// Changing the roll tempo keeps the tempo steps as tempo messages:
+	MidiRoll settempo;
+	rereadRoll(accelerated, settempo);
+	settempo.setRollTempo(50.0);
+	rereadRoll(settempo, reread);
+	getTempos(reread, newtempos);
+	check(newtempos == tempos, "tempo steps lost after setRollTempo");
+	check(!reread.hasAccelerationModel(), "model kept after setRollTempo");
+
+	// Times of the roll follow the model, and do not change when the
+	// unchanged model is queried again:
+	double seconds = accelerated.getRollTimeInSeconds(lasttick);
+	check(seconds == accelerated.getTimeInSeconds(lasttick),
+			"roll times do not match the tempo steps");
+	check(seconds == accelerated.getRollTimeInSeconds(lasttick),
+			"roll times changed between queries");
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// makeRoll -- Create a roll with a note every 120 ticks for 40000 ticks.
+//
+
+void makeRoll(MidiRoll& rollfile) {
+	rollfile.clear();
+	rollfile.setTPQ(600);
+	rollfile.addTracks(1);
+	for (int tick=0; tick<40000; tick+=120) {
+		rollfile.addNoteOn(1, tick, 0, 60, 64);
+		rollfile.addNoteOff(1, tick + 60, 0, 60);
+	}
+	rollfile.sortTracks();
+}
+
+
+
+//////////////////////////////
+//
+// rereadRoll -- Write a roll and read it again into the output roll.
+//
+
+void rereadRoll(MidiRoll& rollfile, MidiRoll& output) {
+	stringstream data;
+	check(rollfile.write(data), "cannot write roll");
+	check(output.read(data), "cannot read roll");
+}
+
+
+
+//////////////////////////////
+//
+// scaleTempos -- Change the tempo messages in the first track directly,
+//     as the tempomm tool does.
+//
+
+void scaleTempos(MidiRoll& rollfile, double factor) {
+	const vector<MidiEvent*>& tempos =
+			rollfile[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)tempos.size(); i++) {
+		int microsec = tempos[i]->getTempoMicroseconds();
+		tempos[i]->setTempoMicroseconds(int(microsec / factor + 0.5));
+	}
+	rollfile.invalidateTimeMap();
+}
+
+
+
+//////////////////////////////
+//
+// getTempos -- Return the microseconds per quarter note of the tempo
+//     messages in the first track.
+//
+
+void getTempos(MidiRoll& rollfile, vector<int>& tempos) {
+	tempos.clear();
+	const vector<MidiEvent*>& events =
+			rollfile[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)events.size(); i++) {
+		tempos.push_back(events[i]->getTempoMicroseconds());
+	}
+}
+
+
+
+//////////////////////////////
+//
+// check -- Stop the test with an error message if the condition is false.
+//
+
+void check(bool condition, const string& message) {
+	if (!condition) {
+		cerr << "Error: " << message << endl;
+		exit(1);
+	}
+}
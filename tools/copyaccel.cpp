@@ -53,13 +53,16 @@ int main(int argc, char** argv) {
 	string outname = options.getString("to");
 
 	MidiFile input;
-	MidiFile output;
+	MidiRoll output;
 
 	if (!inname.empty()) {
 		input.read(inname);
 	}
 	if (!outname.empty()) {
 		output.read(outname);
+		// The tempos of the output file are replaced, so any acceleration
+		// model in its metadata no longer applies:
+		output.clearAccelerationModel();
 	}
 
 	if (options.getBoolean("delete") && !outname.empty()) {
@@ -121,13 +124,11 @@ int main(int argc, char** argv) {
 
 void printTempoList(MidiFile& file) {
 	cout << "**tick\t**usec\t**tempo\n";
-	for (int i=0; i<file[0].getEventCount(); i++) {
-		if (!file[0][i].isTempo()) {
-			continue;
-		}
-		int    microseconds = file[0][i].getTempoMicroseconds();
-		double tempo        = file[0][i].getTempoBPM();
-		int    tick         = file[0][i].tick;
+	const vector<MidiEvent*>& tempos = file[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)tempos.size(); i++) {
+		int    microseconds = tempos[i]->getTempoMicroseconds();
+		double tempo        = tempos[i]->getTempoBPM();
+		int    tick         = tempos[i]->tick;
 		cout << tick << "\t" << microseconds << "\t" << tempo << endl;
 	}
 	cout << "*-\t*-\t*-\n";
@@ -147,11 +148,9 @@ void processMidiFile(MidiFile& output, MidiFile& input) {
 	deleteTempo(output);
 
 	// then copy new tempo messages from input file's first track:
-	for (int i=0; i<input[0].getEventCount(); i++) {
-		if (!input[0][i].isTempo()) {
-			continue;
-		}
-		output[0].push_back(input[0][i]);
+	const vector<MidiEvent*>& tempos = input[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)tempos.size(); i++) {
+		output[0].push_back(*tempos[i]);
 	}
 	output.sortTracks();
 }
@@ -164,10 +163,9 @@ void processMidiFile(MidiFile& output, MidiFile& input) {
 //
 
 void deleteTempo(MidiFile& file) {
-	for (int i=0; i<file[0].getEventCount(); i++) {
-		if (file[0][i].isTempo()) {
-			file[0][i].clear();
-		}
+	const vector<MidiEvent*>& tempos = file[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)tempos.size(); i++) {
+		tempos[i]->clear();
 	}
 	file.removeEmpties();
 }
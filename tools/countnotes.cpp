@@ -13,6 +13,9 @@
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollMapReduce.h"
+#include "RollPrefetcher.h"
+#include "RollReport.h"
 #include <iostream>
 #include <string>
 
@@ -22,8 +25,7 @@ using namespace smf;
 // function declarations:
 void    processMidiFile    (MidiRoll& rollfile, Options& options);
 int     getTotalNotes      (MidiRoll& rollfile);
-
-int Sum = 0;
+void    countAllNotes      (MidiRoll& rollfile, RollCounts& counts);
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -35,20 +37,30 @@ int main(int argc, char** argv) {
 	options.define("t|time-of-first=b", "Display time of first note (as percent of total time)");
 	options.define("T|average-time-of-first=b", "Display average time of first note");
 	options.define("f|display-filename=b", "Display filename (for average-time-of-first)");
+	options.define("j|jobs=i:0", "Number of files to count at the same time (for sum)");
 	options.process(argc, argv);
 	MidiRoll midiroll;
-	if (options.getArgCount() == 0) {
+	if (options.getBoolean("sum")) {
+		RollCounts counts;
+		if (options.getArgCount() == 0) {
+			midiroll.read(cin);
+			countAllNotes(midiroll, counts);
+		} else {
+			RollMapReduce mapreduce;
+			mapreduce.setThreadCount(options.getInteger("jobs"));
+			mapreduce.run<RollCounts>(options, counts, countAllNotes);
+		}
+		cout << counts.getTotal() << endl;
+	} else if (options.getArgCount() == 0) {
 		midiroll.read(cin);
 		processMidiFile(midiroll, options);
 	} else {
-		for (int i=0; i<options.getArgCount(); i++) {
-			midiroll.read(options.getArg(i+1));
+		RollPrefetcher prefetcher;
+		prefetcher.start(options);
+		while (prefetcher.next(midiroll)) {
 			processMidiFile(midiroll, options);
 		}
 	}
-	if (options.getBoolean("sum")) {
-		cout << Sum << endl;
-	}
 	return 0;
 }
 
@@ -75,35 +87,30 @@ int getTotalNotes(MidiRoll& rollfile) {
 }
 
 
+//////////////////////////////
+//
+// countAllNotes -- add the note-ons in the MIDI file to the counts.
+//
+
+void countAllNotes(MidiRoll& rollfile, RollCounts& counts) {
+	counts.add(0, getTotalNotes(rollfile));
+}
+
+
+
 //////////////////////////////
 //
 // processMidiFile --
 //
 
 void processMidiFile(MidiRoll& rollfile, Options& options) {
-	if (options.getBoolean("sum")) {
-		Sum += getTotalNotes(rollfile);
-		return;
-	}
-	vector<int> keycount(128, 0);
-	vector<int> firsttick(128, -1);
+	vector<int> keycount;
+	vector<int> firsttick;
 	int duration = 0;
 	if (options.getBoolean("time-of-first") || options.getBoolean("average-time-of-first")) {
 		duration = rollfile.getFileDurationInTicks();
 	}
-	for (int i=0; i<rollfile.getTrackCount(); i++) {
-		MidiEventList* mel = &rollfile[i];
-		for (int j=0; j<mel->getEventCount(); j++) {
-			MidiEvent* me = &(*mel)[j];
-			if (me->isNoteOn()) {
-				int key = me->getKeyNumber();
-				keycount[key]++;
-				if (firsttick[key] == -1) {
-					firsttick[key] = me->tick;
-				}
-			}
-		}
-	}
+	RollReport::countNotes(rollfile, keycount, firsttick);
 
 	if (options.getBoolean("welte-red")) {
 		int k104 = keycount[104];  // rewind hole: ideally one note only
@@ -139,13 +146,7 @@ void processMidiFile(MidiRoll& rollfile, Options& options) {
 		cout << sum/counter  << endl;
 	} else {
 		// List counts of MIDI files by default:
-		for (int i=0; i<(int)keycount.size(); i++) {
-			cout << i << ":\t" << keycount[i];
-			if (duration) {
-				cout << "\t" << (int)(firsttick[i]/(double)duration * 100.0 + 0.5);
-			}
-			cout << endl;
-		}
+		RollReport::printNoteCounts(keycount, firsttick, duration, cout);
 	}
 }
 
@@ -11,6 +11,7 @@
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollSegmenter.h"
 #include <iostream>
 #include <string>
 
@@ -20,10 +21,6 @@ using namespace smf;
 // function declarations:
 int  processMidiFile                (MidiRoll& rollfile, Options& options);
 void listAttackVelocities           (MidiRoll& rollfile);
-int  getCurrentMinimumAttackVelocity(MidiRoll& rollfile);
-int  getCurrentMaximumAttackVelocity(MidiRoll& rollfile);
-int  mapToNewVelocity               (int velocity, double oldmin, double oldmax,
-                                     double newmin, double newmax);
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -35,6 +32,7 @@ int main(int argc, char** argv) {
 	options.define("n|min|new-min=d:-1.0", "new minimum value");
 	options.define("x|max|new-max=d:-1.0", "new maximum value");
 	options.define("l|list=b", "list all note attacks");
+	options.define("j|jobs=i:1", "number of roll segments to process at the same time (0 = one per core)");
 	options.process(argc, argv);
 
 	MidiRoll midiroll;
@@ -77,11 +75,14 @@ int processMidiFile(MidiRoll& rollfile, Options& options) {
 
 	double oldmin;
 	double oldmax;
+	int minimum;
+	int maximum;
+	rollfile.getAttackVelocityRange(minimum, maximum);
 
 	if (options.getBoolean("old-min")) {
 		oldmin = options.getDouble("old-min");
 	} else {
-		oldmin = getCurrentMinimumAttackVelocity(rollfile);
+		oldmin = minimum;
 	}
 	if (oldmin < 1) {
 		oldmin = 1;
@@ -93,7 +94,7 @@ int processMidiFile(MidiRoll& rollfile, Options& options) {
 	if (options.getBoolean("old-max")) {
 		oldmax = options.getDouble("old-max");
 	} else {
-		oldmax = getCurrentMaximumAttackVelocity(rollfile);
+		oldmax = maximum;
 	}
 	if (oldmax < 1) {
 		oldmax = 1;
@@ -112,84 +113,22 @@ int processMidiFile(MidiRoll& rollfile, Options& options) {
 	}
 
 	double newmin = options.getDouble("new-min");
-	if (newmin < 1) {
-		newmin = 1;
-	}
-	if (newmin > 127) {
-		newmin = 127;
-	}
 	double newmax = options.getDouble("new-max");
-	if (newmax < 1) {
-		newmax = 1;
-	}
-	if (newmax > 127) {
-		newmax = 127;
-	}
-
-	for (int i=1; i<=2; i++) {
-		for (int j=0; j<rollfile[i].getEventCount(); j++) {
-			if (!rollfile[i][j].isNote()) {
-				continue;
-			}
-			if (rollfile[i][j].isNoteOff()) {
-				if (rollfile[i][j].getVelocity() == 0) {
-					continue;
-				}
-			}
-			int velocity = mapToNewVelocity(rollfile[i][j].getVelocity(), oldmin, oldmax, newmin, newmax);
-			rollfile[i][j].setVelocity(velocity);
-		}
+	if (options.getInteger("jobs") == 1) {
+		rollfile.rescaleAttackVelocities(oldmin, oldmax, newmin, newmax);
+	} else {
+		RollSegmenter segmenter;
+		segmenter.setThreadCount(options.getInteger("jobs"));
+		segmenter.run(rollfile, [=](MidiRoll& segment) {
+			segment.rescaleAttackVelocities(oldmin, oldmax, newmin, newmax);
+			return true;
+		});
 	}
 	return 1;
 }
 
 
 
-///////////////////////////////
-//
-// getCurrentMinimumAttackVelocity --
-//
-
-int getCurrentMinimumAttackVelocity(MidiRoll& rollfile) {
-	int output = -1;
-
-	for (int i=1; i<=2; i++) {
-		for (int j=0; j<rollfile[i].getEventCount(); j++) {
-			if (!rollfile[i][j].isNoteOn()) {
-				continue;
-			}
-			if ((output < 0) || (rollfile[i][j].getVelocity() < output)) {
-				output = rollfile[i][j].getVelocity();
-			}
-		}
-	}
-	return output;
-}
-
-
-
-///////////////////////////////
-//
-// getCurrentMaximumAttackVelocity --
-//
-
-int getCurrentMaximumAttackVelocity(MidiRoll& rollfile) {
-	int output = -1;
-	for (int i=1; i<=2; i++) {
-		for (int j=0; j<rollfile[1].getEventCount(); j++) {
-			if (!rollfile[i][j].isNoteOn()) {
-				continue;
-			}
-			if ((output < 0) || (rollfile[i][j].getVelocity() > output)) {
-				output = rollfile[i][j].getVelocity();
-			}
-		}
-	}
-	return output;
-}
-
-
-
 //////////////////////////////
 //
 // listAttackVelocities --
@@ -208,29 +147,3 @@ void listAttackVelocities(MidiRoll& rollfile) {
 
 
 
-//////////////////////////////
-//
-// mapToNewVelocity -- Linear interpolation to new range.
-//
-
-int mapToNewVelocity(int velocity, double oldmin, double oldmax, double newmin,
-		double newmax) {
-	double oldrange = oldmax - oldmin;
-	double newrange = newmax - newmin;
-	double slope = newrange / oldrange;
-	double zero = newmax - slope * oldmax;
-	double output = slope * velocity + zero;
-	int outint = int(output + 0.5);
-	if (outint < 1) {
-		outint = 1;
-	}
-	if (outint > 127) {
-		outint = 127;
-	}
-	return outint;
-}
-
-
-
-
-
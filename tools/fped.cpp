@@ -25,6 +25,7 @@ void    processMidiFile    (MidiRoll& rollfile, Options& options);
 
 int main(int argc, char** argv) {
 	Options options;
+	options.define("c|controller=i:64", "pedal controller to convert (64 = sustain, 67 = soft)");
 	options.process(argc, argv);
 	if ((options.getArgCount() > 2) || (options.getArgCount() == 1)) {
 		cerr << "Usage: " << options.getCommand() << " input.mid output.mid" << endl;
@@ -48,42 +49,11 @@ int main(int argc, char** argv) {
 
 //////////////////////////////
 //
-// processMidiFile --
+// processMidiFile -- Extend the notes held by the pedal.
 //
 
 void processMidiFile(MidiRoll& rollfile, Options& options) {
-	rollfile.joinTracks();
-	vector<vector<MidiEvent*>> offs(16);
-	vector<bool> sustain(16);
-
-	for (int i=0; i<rollfile[0].getEventCount(); i++) {
-		MidiEvent* me = &rollfile[0][i];
-		int channel = me->getChannel();
-		if (me->isSustainOn()) {
-			sustain[channel] = true;
-			me->clear();
-			continue;
-		}
-		if (me->isSustainOff()) {
-			sustain[channel] = false;
-			for (int j=0; j<(int)offs[channel].size(); j++) {
-				offs[channel][j]->tick = me->tick;
-			}
-			offs[channel].clear();
-			me->clear();
-			continue;
-		}
-		if (!sustain[channel]) {
-			continue;
-		}
-		if (me->isNoteOff()) {
-			offs[channel].push_back(me);
-		}
-	}
-
-	rollfile.splitTracks();
-	rollfile.removeEmpties();
-	rollfile.sortTracks();
+	rollfile.applyPedal(options.getInteger("controller"));
 }
 
 
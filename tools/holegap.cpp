@@ -17,10 +17,12 @@
 //                -m # : minimum pixel distance to track
 //                -x # : maximum pixel distance to track
 //                -v   : verbose: print name of each file when processing
+//                -j # : number of files to process at the same time
 //
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollMapReduce.h"
 #include <iostream>
 #include <string>
 
@@ -28,8 +30,8 @@ using namespace std;
 using namespace smf;
 
 // function declarations:
-void processMidiFile  (vector<int>& histogram, MidiRoll& rollfile);
-void printResults     (vector<int>& histogram, int minlen, int average);
+void processMidiFile  (MidiRoll& rollfile, RollHistogram& histogram);
+void printResults     (RollHistogram& histogram, int average);
 
 int  minlen = 0;	     // minimum pixel distance to track
 int  maxlen = 99;	     // maximum pixel distance to track
@@ -44,28 +46,26 @@ int main(int argc, char** argv) {
 	options.define("m|min=i:0", "Minimum pixel size to track");
 	options.define("x|max=i:99", "Maximum pixel size to track");
 	options.define("v|verbose=b", "Display debugging information");
+	options.define("j|jobs=i:0", "Number of files to process at the same time");
 	options.process(argc, argv);
 
 	minlen = options.getInteger("min");
 	maxlen = options.getInteger("max");
 	verboseQ = options.getBoolean("verbose");
 
-	vector<int> histogram(maxlen - minlen + 1, 0);
-	
-	MidiRoll midiroll;
+	RollHistogram histogram(minlen, maxlen);
+
 	if (options.getArgCount() == 0) {
+		MidiRoll midiroll;
 		midiroll.read(cin);
-		processMidiFile(histogram, midiroll);
+		processMidiFile(midiroll, histogram);
 	} else {
-		for (int i=0; i<options.getArgCount(); i++) {
-			if (verboseQ) {
-				cerr << options.getArg(i+1) << endl;
-			}
-			midiroll.read(options.getArg(i+1));
-			processMidiFile(histogram, midiroll);
-		}
+		RollMapReduce mapreduce;
+		mapreduce.setThreadCount(options.getInteger("jobs"));
+		mapreduce.setProgress(verboseQ);
+		mapreduce.run<RollHistogram>(options, histogram, processMidiFile);
 	}
-	printResults(histogram, minlen, average);
+	printResults(histogram, average);
 	return 0;
 }
 
@@ -74,10 +74,11 @@ int main(int argc, char** argv) {
 
 //////////////////////////////
 //
-// processMidiFile --
+// processMidiFile -- Add the gaps between holes in the roll to the
+//     histogram (which ignores gaps outside of the minimum/maximum).
 //
 
-void processMidiFile(vector<int>& histogram, MidiRoll& rollfile) {
+void processMidiFile(MidiRoll& rollfile, RollHistogram& histogram) {
 	vector<int> lastOffTime;
 
 	for (int i=0; i<rollfile.getTrackCount(); i++) {
@@ -94,10 +95,7 @@ void processMidiFile(vector<int>& histogram, MidiRoll& rollfile) {
 				int key = me->getKeyNumber();
 				int tick = me->tick;
 				if (lastOffTime.at(key) >= 0) {
-					int difference = tick - lastOffTime.at(key);
-					if ((difference >= minlen) && (difference <= maxlen)) {
-						histogram[difference - minlen]++;
-					}
+					histogram.add(tick - lastOffTime.at(key));
 				}
 			}
 		}
@@ -111,13 +109,15 @@ void processMidiFile(vector<int>& histogram, MidiRoll& rollfile) {
 // printResults --
 //
 
-void printResults(vector<int>& histogram, int minlen, int average) {
-	for (int i=0; i<(int)histogram.size(); i++) {
-		cout << (i+minlen) << "\t" << histogram[i];
-		if ((average > 0) && (i - average >= 0) && (i + average < (int)histogram.size())) {
+void printResults(RollHistogram& histogram, int average) {
+	int minimum = histogram.getMinimum();
+	int size = histogram.getMaximum() - minimum + 1;
+	for (int i=0; i<size; i++) {
+		cout << (i+minimum) << "\t" << histogram.getCount(i+minimum);
+		if ((average > 0) && (i - average >= 0) && (i + average < size)) {
 			double sum = 0;
 			for (int j = i - average; j <= i + average; j++) {
-				sum += histogram.at(j);
+				sum += histogram.getCount(j+minimum);
 			}
 			double total = sum / (average * 2 + 1);
 			total = (int(total * 10.0 + 0.5))/10.0;
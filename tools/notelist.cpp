@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Thu Apr 12 21:48:03 PDT 2018
-// Last Modified: Thu Apr 12 27:56:17 PDT 2018
+// Last Modified: Sun Oct 18 19:05:38 PDT 2026
 // Filename:      midiroll/tools/notelist.cpp
 // Syntax:        C++11
 // vim:           ts=3
@@ -9,23 +9,24 @@
 // Description:   Print list of notes in MIDI file along with their
 //                starting times and durations.
 //
+// Options:       -t # : only list notes which are sounding at the given tick
+//
 
 #include "Options.h"
-#include "MidiFile.h"
+#include "MidiRoll.h"
+#include "RollReport.h"
 #include <iostream>
 
 using namespace std;
 using namespace smf;
 
-// function declarations:
-void printNoteList(MidiFile& midifile);
-
 ///////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv) {
 	Options options;
+	options.define("t|tick=i:0", "list notes sounding at the given tick");
 	options.process(argc, argv);
-	MidiFile midifile;
+	MidiRoll midifile;
 	if (options.getArgCount() == 0) {
 		midifile.read(cin);
 	} else if (options.getArgCount() == 1) {
@@ -34,33 +35,15 @@ int main(int argc, char** argv) {
 		cerr << "Usage: " << options.getCommand() << "  [midifile]" << endl;
 		exit(1);
 	}
-	printNoteList(midifile);
-	return 0;
-}
-
-
-
-//////////////////////////////
-//
-// printNoteList -- Creates a single list of all MIDI notes
-//     along with their starting times and durations in seconds.
-//
-
-void printNoteList(MidiFile& midifile) {
-	midifile.joinTracks();
-	midifile.doTimeAnalysis();
-	midifile.linkNotePairs();
-	
-	for (int i=0; i<midifile[0].getSize(); i++) {
-		if (!midifile[0][i].isNoteOn()) {
-			continue;
-		}
-		cout << midifile[0][i].getP1() << "\t";
-		cout << midifile[0][i].getP2() << "\t";
-		cout << midifile[0][i].track   << "\t";
-		cout << midifile[0][i].seconds << "\t";
-		cout << midifile[0][i].getDurationInSeconds() << "\n";
+	if (options.getBoolean("tick")) {
+		RollReport::printSoundingNotes(midifile, options.getInteger("tick"), cout);
+	} else {
+		midifile.joinTracks();
+		midifile.doTimeAnalysis();
+		midifile.linkNotePairs();
+		RollReport::printNoteList(midifile, cout);
 	}
+	return 0;
 }
 
 
@@ -55,13 +55,12 @@ int main(int argc, char** argv) {
 
 void processMidiFile(MidiRoll& rollfile, Options& options) {
 	rollfile.joinTracks();
-	rollfile.doTimeAnalysis();
+	rollfile.convertToRateTicks(1000.0);
 	rollfile.setMillisecondTicks();
 	bool deletetempo = false;
 
 	for (int i=0; i<rollfile[0].getEventCount(); i++) {
 		MidiEvent* me = &rollfile[0][i];
-		me->tick = (int)(me->seconds * 1000.0 + 0.5);
 		if (me->isTempo()) {
 			if (deletetempo) {
 				me->clear();
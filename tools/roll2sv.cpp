@@ -13,6 +13,8 @@
 #include "MidiRoll.h"
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 using namespace smf;
@@ -20,6 +22,10 @@ using namespace smf;
 // function declarations:
 void    processMidiFile    (MidiRoll& rollfile, Options& options);
 void    extractNoteVolumes (MidiRoll& rollfile, int track);
+void    addPedalLabels     (vector<pair<int, string>>& labels,
+                            vector<double>& times,
+                            const vector<ControllerInterval>& intervals,
+                            const string& ontext, const string& offtext);
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -66,25 +72,48 @@ void processMidiFile(MidiRoll& rollfile, Options& options) {
 	}
 
 	// annotations encoded as labels
-	for (int i=0; i<rollfile[0].getEventCount(); i++) {
-		MidiEvent* me = &rollfile[0][i];
-		int channel = me->getChannel();
-		if (sustainQ) {
-			if ((channel == 1) && me->isSustainOn()) {
-				cout << me->seconds << "\t" << "Ped" << endl;
-			} else if ((channel == 1) && me->isSustainOff()) {
-				cout << me->seconds << "\t" << "*" << endl;
-			}
-		} if (softQ) {
-			if ((channel == 1) && me->isSoftOn()) {
-				cout << me->seconds << "\t" << "UC" << endl;
-			} else if ((channel == 1) && me->isSoftOff()) {
-				if (!sustainQ) {
-					cout << me->seconds << "\t" << "*" << endl;
-				} else {
-					cout << me->seconds << "\t" << "**" << endl;
-				}
-			}
+	const ControllerTimeline& timeline = rollfile.getControllerTimeline();
+	vector<pair<int, string>> labels;
+	vector<double> times;
+	if (sustainQ) {
+		addPedalLabels(labels, times, timeline.getIntervals(1, 64), "Ped", "*");
+	}
+	if (softQ) {
+		addPedalLabels(labels, times, timeline.getIntervals(1, 67), "UC",
+				sustainQ ? "**" : "*");
+	}
+
+	vector<int> order(labels.size());
+	for (int i=0; i<(int)order.size(); i++) {
+		order[i] = i;
+	}
+	stable_sort(order.begin(), order.end(),
+		[&labels](int a, int b) -> bool {
+			return labels[a].first < labels[b].first;
+		}
+	);
+	for (int i=0; i<(int)order.size(); i++) {
+		cout << times[order[i]] << "\t" << labels[order[i]].second << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// addPedalLabels -- Add a label for the start and end of each pedal
+//     interval.  Pedals which are never released have no ending label.
+//
+
+void addPedalLabels(vector<pair<int, string>>& labels, vector<double>& times,
+		const vector<ControllerInterval>& intervals, const string& ontext,
+		const string& offtext) {
+	for (int i=0; i<(int)intervals.size(); i++) {
+		labels.emplace_back(intervals[i].starttick, ontext);
+		times.push_back(intervals[i].startseconds);
+		if (intervals[i].off) {
+			labels.emplace_back(intervals[i].endtick, offtext);
+			times.push_back(intervals[i].endseconds);
 		}
 	}
 }
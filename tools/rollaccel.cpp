@@ -59,7 +59,7 @@ void processMidiFile(MidiRoll& rollfile, Options& options) {
 		rollfile.removeAcceleration();
 	} else if (percent > 0.0) {
 		if (inches > 0.0) {
-			rollfile.applyAcceleration(inches, percent);
+			rollfile.setAccelerationModel(inches, percent);
 		}
 	}
 
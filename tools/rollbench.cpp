@@ -0,0 +1,153 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 19:00:56 PDT 2026
+// Last Modified: Sun Oct 18 19:00:56 PDT 2026
+// Filename:      midiroll/tools/rollbench.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Time copying a large roll against moving, swapping and
+//                forking it.  A roll with the requested number of notes
+//                is generated unless a MIDI file is given.
+//
+// Options:
+//                -n count == number of notes in the generated roll.
+//                -t count == number of tracks in the generated roll.
+//                -i count == number of times to repeat each operation.
+//
+
+#include "Options.h"
+#include "MidiRoll.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+
+using namespace std;
+using namespace smf;
+
+// function declarations:
+void    generateRoll       (MidiRoll& rollfile, int notecount, int trackcount);
+void    benchmarkRoll      (MidiRoll& rollfile, int iterations);
+void    printTime          (const string& name,
+                            chrono::steady_clock::time_point start,
+                            int iterations);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|notes=i:500000", "number of notes in generated roll");
+	options.define("t|tracks=i:16", "number of tracks in generated roll");
+	options.define("i|iterations=i:20", "number of repeats of each operation");
+	options.process(argc, argv);
+	int iterations = options.getInteger("iterations");
+	if (iterations < 1) {
+		iterations = 1;
+	}
+	MidiRoll midiroll;
+	if (options.getArgCount() == 0) {
+		int trackcount = options.getInteger("tracks");
+		if (trackcount < 1) {
+			trackcount = 1;
+		}
+		generateRoll(midiroll, options.getInteger("notes"), trackcount);
+		benchmarkRoll(midiroll, iterations);
+	} else {
+		for (int i=0; i<options.getArgCount(); i++) {
+			if (!midiroll.read(options.getArg(i+1))) {
+				cerr << "Error reading " << options.getArg(i+1) << endl;
+				return 1;
+			}
+			cout << midiroll.getFilename() << endl;
+			benchmarkRoll(midiroll, iterations);
+		}
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// generateRoll -- Fill the roll with notes spread evenly over the
+//    given number of tracks (after the expression track).
+//
+
+void generateRoll(MidiRoll& rollfile, int notecount, int trackcount) {
+	rollfile.clear();
+	rollfile.setTPQ(600);
+	rollfile.addTracks(trackcount);
+	for (int i=0; i<notecount; i++) {
+		int track = 1 + i % trackcount;
+		int tick  = (i / trackcount) * 60;
+		int key   = 21 + i % 88;
+		rollfile.addNoteOn(track, tick, 0, key, 64);
+		rollfile.addNoteOff(track, tick + 45, 0, key);
+	}
+	rollfile.sortTracks();
+}
+
+
+
+//////////////////////////////
+//
+// benchmarkRoll -- Print the average time of each operation in
+//    microseconds.
+//
+
+void benchmarkRoll(MidiRoll& rollfile, int iterations) {
+	int eventcount = 0;
+	for (int i=0; i<rollfile.getTrackCount(); i++) {
+		eventcount += rollfile.getEventCount(i);
+	}
+	cout << "events:\t" << eventcount << endl;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i=0; i<iterations; i++) {
+		MidiRoll copy(rollfile);
+	}
+	printTime("copy", start, iterations);
+
+	MidiRoll target;
+	start = chrono::steady_clock::now();
+	for (int i=0; i<iterations; i++) {
+		target = rollfile;
+	}
+	printTime("copy assign", start, iterations);
+
+	// Each iteration moves the roll out and back again:
+	start = chrono::steady_clock::now();
+	for (int i=0; i<iterations; i++) {
+		MidiRoll moved(std::move(rollfile));
+		rollfile = std::move(moved);
+	}
+	printTime("move", start, iterations * 2);
+
+	start = chrono::steady_clock::now();
+	for (int i=0; i<iterations; i++) {
+		rollfile.swap(target);
+	}
+	printTime("swap", start, iterations);
+
+	start = chrono::steady_clock::now();
+	for (int i=0; i<iterations; i++) {
+		MidiRoll forked = rollfile.fork();
+	}
+	printTime("fork", start, iterations);
+}
+
+
+
+//////////////////////////////
+//
+// printTime -- Print the average time since start in microseconds.
+//
+
+void printTime(const string& name, chrono::steady_clock::time_point start,
+		int iterations) {
+	chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+	cout << name << ":\t" << elapsed.count() / iterations << " us" << endl;
+}
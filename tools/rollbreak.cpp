@@ -21,6 +21,7 @@
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollBatch.h"
 #include <iostream>
 
 using namespace std;
@@ -29,8 +30,9 @@ using namespace smf;
 // function declarations:
 void  displayTempo          (Options& options);
 void  setBreak              (Options& options);
-void  setBreakOverwrite     (Options& options);
+int   setBreakOverwrite     (Options& options);
 void  applyBreakpoint       (MidiRoll& midiroll, Options& options);
+double getBreakpoint        (Options& options);
 void  displayRegisterBreak  (Options& options);
 void  displayRegisterBreak  (MidiRoll& midiroll, Options& options, int count);
 void  errorMessage          (Options& options, const string& message = "");
@@ -51,6 +53,8 @@ int main(int argc, char** argv) {
 	options.define("treble-track=i:2", "track containing treble notes");
 	options.define("bass-track=i:1",   "track containing bass notes");
 	options.define("replace=b",        "replace contents of input files");
+	options.define("j|jobs=i:0",       "number of files to replace at the same time");
+	options.define("progress=b",       "show progress when replacing files");
 	options.define("r|range=b",        "show total ranges");
 	options.process(argc, argv);
 
@@ -59,7 +63,9 @@ int main(int argc, char** argv) {
 	 } if (options.getBoolean("range")) {
 		displayRegisterBreak(options);
 	} else if (options.getBoolean("replace")) {
-		setBreakOverwrite(options);
+		if (setBreakOverwrite(options) > 0) {
+			return 1;
+		}
 	} else {
 		setBreak(options);
 	}
@@ -105,20 +111,24 @@ void setBreak(Options& options) {
 //////////////////////////////
 //
 // setBreakOverwrite -- Same as setBreak, but will replace
-//    input MIDI file.
+//    input MIDI file.  Returns the number of files which could not
+//    be changed.
 //
 
-void setBreakOverwrite(Options& options) {
-	MidiRoll midiroll;
+int setBreakOverwrite(Options& options) {
 	if (options.getArgCount() == 0) {
 		errorMessage(options);
-	} else {
-		for (int i=0; i<options.getArgCount(); i++) {
-			midiroll.read(options.getArg(i+1));
-			applyBreakpoint(midiroll, options);
-			midiroll.write(options.getArg(i+1));
-		}
+		return 1;
 	}
+	double breakpoint = getBreakpoint(options);
+	int trebletrack = options.getInteger("treble-track");
+	int basstrack = options.getInteger("bass-track");
+	RollBatch batch;
+	batch.setThreadCount(options.getInteger("jobs"));
+	batch.setProgress(options.getBoolean("progress"));
+	return batch.run(options, [=](MidiRoll& midiroll) {
+		return midiroll.setRegisterBreak(breakpoint, trebletrack, basstrack);
+	});
 }
 
 
@@ -129,6 +139,21 @@ void setBreakOverwrite(Options& options) {
 //
 
 void applyBreakpoint(MidiRoll& midiroll, Options& options) {
+	double breakpoint = getBreakpoint(options);
+	int trebletrack = options.getInteger("treble-track");
+	int basstrack = options.getInteger("bass-track");
+	midiroll.setRegisterBreak(breakpoint, trebletrack, basstrack);
+}
+
+
+
+//////////////////////////////
+//
+// getBreakpoint -- Return the break point between the bass and treble
+//     registers.  Exits if it is not valid.
+//
+
+double getBreakpoint(Options& options) {
 	double breakpoint = options.getDouble("break");
 	if (options.getBoolean("green-welte")) {
 		breakpoint = 66.5;
@@ -153,34 +178,7 @@ void applyBreakpoint(MidiRoll& midiroll, Options& options) {
 		errorMessage(options, "Invalid breakpoint");
 		exit(1);
 	}
-
-	int trebletrack = options.getInteger("treble-track");
-	int basstrack = options.getInteger("bass-track");
-	int basschannel   = 1;
-	int treblechannel = 2;
-
-	midiroll.joinTracks();
-	for (int i=0; i<midiroll[0].getEventCount(); i++) {
-		if (!midiroll[0][i].isNote()) {
-			continue;
-		}
-		int key = midiroll[0][i].getKeyNumber();
-		int track = midiroll[0][i].track;
-		if (track == trebletrack) {
-			if (key < breakpoint) {
-				midiroll[0][i].track = basstrack;
-				midiroll[0][i].setChannel(basschannel);
-			}
-		}
-		if (track == basstrack) {
-			if (key > breakpoint) {
-				midiroll[0][i].track = trebletrack;
-				midiroll[0][i].setChannel(treblechannel);
-			}
-		}
-	}
-	
-	midiroll.splitTracks();
+	return breakpoint;
 }
 
 
@@ -0,0 +1,129 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:31:09 PDT 2026
+// Last Modified: Sun Oct 18 19:27:07 PDT 2026
+// Filename:      midiroll/tools/rollc.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Send queries to a rolld server and print the answers.
+//                Each query is a command with its options and a filename,
+//                given as a single argument.  A relative filename is
+//                changed to an absolute one, since the server may be
+//                running in another directory.
+//
+// Options:
+//      rollc "notelist file.mid"
+//           Same output as "notelist file.mid".
+//      rollc "countnotes -s a.mid" "countnotes -s b.mid"
+//           Send two queries on the same connection.
+//      rollc -T "rolltext -m file.mid"
+//           Also print the time taken by each query.
+//
+
+#include "Options.h"
+#include "RollService.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+using namespace smf;
+
+// function declarations:
+string  makeAbsolute  (const string& query);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("s|socket=s", "Unix-domain socket of the server");
+	options.define("T|time=b", "print the time of each query in milliseconds");
+	options.process(argc, argv);
+
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand()
+		     << " [-s socket] \"command [options] file.mid\" ..." << endl;
+		exit(1);
+	}
+
+	string socketpath = options.getString("socket");
+	if (socketpath.empty()) {
+		socketpath = RollService::getDefaultSocket();
+	}
+	int fd = RollService::connect(socketpath);
+	if (fd < 0) {
+		cerr << "Error: cannot connect to " << socketpath << endl;
+		exit(1);
+	}
+
+	int failures = 0;
+	for (int i=0; i<options.getArgCount(); i++) {
+		string query = makeAbsolute(options.getArg(i+1));
+		string output;
+		bool status = false;
+		auto starttime = chrono::steady_clock::now();
+		if (!RollService::request(fd, query, output, status)) {
+			cerr << "Error: connection to server was lost" << endl;
+			exit(1);
+		}
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - starttime;
+		if (status) {
+			cout << output;
+		} else {
+			cerr << "Error: " << output << endl;
+			failures++;
+		}
+		if (options.getBoolean("time")) {
+			cerr << elapsed.count() << " ms\t" << query << endl;
+		}
+	}
+	close(fd);
+	return failures ? 1 : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// makeAbsolute -- Add the current directory in front of a relative
+//     filename at the end of the query.  The filename is the first word
+//     which does not start with "-" (after the command, and after the
+//     tick number of "notelist -t").
+//
+
+string makeAbsolute(const string& query) {
+	const char* spaces = " \t";
+	string command;
+	bool valueQ = false;
+	size_t start = query.find_first_not_of(spaces);
+	while (start != string::npos) {
+		size_t end = query.find_first_of(spaces, start);
+		string word = query.substr(start, end == string::npos ? string::npos : end - start);
+		if (command.empty()) {
+			command = word;
+		} else if (valueQ || (word[0] == '-')) {
+			valueQ = (command == "notelist") && (word == "-t");
+		} else {
+			if (word[0] == '/') {
+				return query;
+			}
+			char buffer[4096];
+			if (getcwd(buffer, sizeof(buffer)) == NULL) {
+				return query;
+			}
+			return query.substr(0, start) + buffer + "/" + query.substr(start);
+		}
+		if (end == string::npos) {
+			break;
+		}
+		start = query.find_first_not_of(spaces, end);
+	}
+	return query;
+}
+
+
+
@@ -0,0 +1,47 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:31:09 PDT 2026
+// Last Modified: Sun Oct 18 19:27:07 PDT 2026
+// Filename:      midiroll/tools/rolld.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Server which answers notelist, tick2time, rolltext and
+//                countnotes queries from a cache of parsed MIDI rolls.
+//                Use rollc to send queries to the server.
+//
+// Options:
+//      rolld &
+//           Answer queries on $XDG_RUNTIME_DIR/rolld.socket (or on
+//           /tmp/rolld-<uid>/rolld.socket if XDG_RUNTIME_DIR is not set).
+//      rolld -s /tmp/qa.socket -c 1024 &
+//           Use a different socket, and up to 1024 MB for the cache.
+//      rolld -n 64 &
+//           Answer up to 64 connections at the same time (16 by default).
+//
+
+#include "Options.h"
+#include "RollService.h"
+#include <iostream>
+
+using namespace std;
+using namespace smf;
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("s|socket=s", "Unix-domain socket for queries");
+	options.define("c|cache-size=d:256", "memory for cached rolls in megabytes");
+	options.define("n|connections=i:0", "number of connections answered at the same time");
+	options.process(argc, argv);
+
+	long long cachebytes = (long long)(options.getDouble("cache-size") * 1024 * 1024);
+	RollService service(cachebytes);
+	service.setThreadCount(options.getInteger("connections"));
+	return service.serve(options.getString("socket"));
+}
+
+
+
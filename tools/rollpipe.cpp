@@ -0,0 +1,189 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:01:05 PDT 2026
+// Last Modified: Sun Oct 18 17:35:58 PDT 2026
+// Filename:      midiroll/tools/rollpipe.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Apply a chain of roll transforms to a MIDI file in one
+//                process: the file is read once, each stage is applied
+//                in memory, and the result is written once.
+//
+// Options:
+//      rollpipe -p "trackerize | rollaccel | holeshift -t 1" in.mid -o out.mid
+//           Same result as piping the file through the three tools.
+//      rollpipe -p "setinstrument -p | expscale -n 40 -x 90" --replace *.mid
+//           Apply the pipeline to each file, replacing the files.
+//      rollpipe -p "trackerize | rollaccel" --cache ~/.rollcache --replace *.mid
+//           Copy results from the cache directory for files which were
+//           already processed by the same pipeline, and add the results
+//           of the other files to the cache.
+//      rollpipe -l
+//           List the stage names.
+//
+
+#include "Options.h"
+#include "MidiRoll.h"
+#include "RollBuildCache.h"
+#include "RollPipeline.h"
+#include "RollPrefetcher.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace smf;
+
+// function declarations:
+void  listStages     (void);
+int   replaceFiles   (RollPipeline& pipeline, Options& options);
+int   buildFiles     (RollPipeline& pipeline, Options& options);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("p|pipeline=s", "stages separated by | characters");
+	options.define("o|output-file=s", "filename to save output results");
+	options.define("replace=b", "write output to same name as input file");
+	options.define("c|cache=s", "directory for results of earlier runs");
+	options.define("l|list=b", "list the names of the pipeline stages");
+	options.process(argc, argv);
+
+	if (options.getBoolean("list")) {
+		listStages();
+		return 0;
+	}
+
+	RollPipeline pipeline;
+	if (!pipeline.parse(options.getString("pipeline"))) {
+		exit(1);
+	}
+
+	bool outputQ = options.getBoolean("output-file") || options.getBoolean("replace");
+	if (options.getBoolean("cache") && outputQ && (options.getArgCount() > 0)) {
+		return buildFiles(pipeline, options);
+	}
+
+	if ((options.getArgCount() > 1) && options.getBoolean("replace")) {
+		return replaceFiles(pipeline, options);
+	}
+
+	MidiRoll rollfile;
+	if (options.getArgCount() == 0) {
+		rollfile.read(cin);
+	} else if (options.getArgCount() == 1) {
+		rollfile.read(options.getArg(1));
+	} else {
+		cerr << "Usage: " << options.getCommand()
+		     << " -p \"stage [options] | ...\" [-o output.mid] [midifile]" << endl;
+		cerr << "       " << options.getCommand()
+		     << " -p \"stage [options] | ...\" --replace midifile(s)" << endl;
+		exit(1);
+	}
+	if (!rollfile.status()) {
+		cerr << "Error: could not read MIDI file" << endl;
+		exit(1);
+	}
+
+	if (!pipeline.run(rollfile)) {
+		exit(1);
+	}
+
+	string filename = options.getString("output-file");
+	if ((!filename.empty()) && (options.getBoolean("output-file"))) {
+		rollfile.write(filename);
+	} else if ((options.getArgCount() > 0) && options.getBoolean("replace")) {
+		rollfile.write(options.getArg(1));
+	} else {
+		cout << rollfile;
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// replaceFiles -- Apply the pipeline to each input file and write the
+//     result back to the same file.  The next files are read while the
+//     current one is being processed, and the results are written in
+//     the background.  Files which cannot be read or processed are left
+//     unchanged.  Returns 1 if any file failed.
+//
+
+int replaceFiles(RollPipeline& pipeline, Options& options) {
+	int failures = 0;
+	MidiRoll rollfile;
+	RollPrefetcher prefetcher;
+	prefetcher.start(options);
+	while (prefetcher.next(rollfile)) {
+		if (!rollfile.status()) {
+			cerr << "Error: could not read MIDI file " << prefetcher.getFilename() << endl;
+			failures++;
+		} else if (!pipeline.run(rollfile)) {
+			cerr << "Error: file not changed: " << prefetcher.getFilename() << endl;
+			failures++;
+		} else {
+			prefetcher.write(rollfile, prefetcher.getFilename());
+		}
+	}
+	failures += prefetcher.finish();
+	return failures ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// buildFiles -- Apply the pipeline to the input file(s) using the build
+//     cache, writing to the output file or replacing the input files.
+//     Returns 1 if any file failed.
+//
+
+int buildFiles(RollPipeline& pipeline, Options& options) {
+	RollBuildCache cache(options.getString("cache"));
+	string recipe = pipeline.getRecipe();
+	auto function = [&pipeline](MidiRoll& rollfile) {
+		return pipeline.run(rollfile);
+	};
+
+	if (options.getBoolean("output-file")) {
+		if (options.getArgCount() != 1) {
+			cerr << "Error: -o can only be used with one input file" << endl;
+			return 1;
+		}
+		bool status = cache.build(options.getArg(1),
+				options.getString("output-file"), recipe, function);
+		return status ? 0 : 1;
+	}
+
+	int failures = 0;
+	for (int i=0; i<options.getArgCount(); i++) {
+		string filename = options.getArg(i+1);
+		if (!cache.build(filename, filename, recipe, function)) {
+			cerr << "Error: file not changed: " << filename << endl;
+			failures++;
+		}
+	}
+	return failures ? 1 : 0;
+}
+
+
+
+//////////////////////////////
+//
+// listStages --
+//
+
+void listStages(void) {
+	vector<string> names = RollPipeline::getStageNames();
+	for (int i=0; i<(int)names.size(); i++) {
+		cout << names[i] << endl;
+	}
+}
+
+
+
@@ -0,0 +1,545 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:18:38 PDT 2026
+// Last Modified: Sun Oct 18 19:32:11 PDT 2026
+// Filename:      midiroll/tools/rollshard.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Apply a chain of roll transforms (see rollpipe) to a
+//                large list of MIDI files using several worker processes.
+//
+//                The files are split into one shard per worker, and each
+//                worker is a separate process which handles one file at
+//                a time.  Every file is recorded in a journal when it is
+//                started and when it is finished, so an interrupted run
+//                can be started again with the same command, and it will
+//                skip the files which were already finished.  If a worker
+//                crashes on a file, the file is recorded as failed and a
+//                new worker continues with the rest of the shard.  Files
+//                which failed are not tried again in later runs (remove
+//                their lines from the journal to try them again).
+//
+//                With --cache, the results are also stored in a cache
+//                directory (see RollBuildCache), and files which have not
+//                changed since an earlier run with the same pipeline are
+//                copied from the cache instead of being processed.  This
+//                allows a new run over the whole corpus (with a new
+//                journal) to skip the unchanged files.
+//
+//                Journal lines (tab separated):
+//                   begin   filename
+//                   done    filename    [cached]
+//                   fail    filename    reason
+//
+// Options:
+//      rollshard -p "setinstrument -p | temposimp" -m files.txt -d outdir
+//           Process the files listed in files.txt (one per line), writing
+//           the results to outdir.  The journal is files.txt.journal.
+//           The run is refused if two files have the same name, since
+//           their results would be written to the same file in outdir.
+//      rollshard -p "holeshift -t 1" --replace -w 4 *.mid
+//           Replace the files using 4 worker processes.
+//      rollshard -p "trackerize | rollaccel" -c cachedir -J run.journal -d out *.mid
+//           Use results in cachedir for unchanged files.
+//
+
+#include "Options.h"
+#include "MidiRoll.h"
+#include "RollBuildCache.h"
+#include "RollPipeline.h"
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace smf;
+
+// function declarations:
+void    getFilenames      (vector<string>& filenames, Options& options);
+void    readJournal       (const string& journal, set<string>& done,
+                           set<string>& failed, set<string>& started);
+bool    isFinished        (const string& filename, set<string>& done,
+                           set<string>& failed);
+void    writeJournal      (int fd, const string& state, const string& filename,
+                           const string& reason = "");
+pid_t   startWorker       (const vector<string>& shard, RollPipeline& pipeline,
+                           int journalfd);
+int     runWorker         (const vector<string>& shard, RollPipeline& pipeline,
+                           int journalfd);
+bool    processFile       (const string& filename, RollPipeline& pipeline,
+                           string& reason, bool& cached);
+string  getOutputFilename (const string& filename);
+bool    checkOutputNames  (const vector<string>& filenames);
+string  getCrashedFile    (const vector<string>& shard, const string& journal);
+
+string OutputDirectory;     // directory for output files (if not --replace)
+bool   ReplaceQ = false;    // write output to the input filename
+RollBuildCache BuildCache;  // results of earlier runs (if --cache)
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("p|pipeline=s", "stages separated by | characters");
+	options.define("m|manifest=s", "file containing a list of MIDI files");
+	options.define("w|workers=i:0", "number of worker processes (0 = one per core)");
+	options.define("J|journal=s", "checkpoint journal (default manifest.journal)");
+	options.define("d|output-directory=s", "directory for output files");
+	options.define("replace=b", "write output to same name as input file");
+	options.define("c|cache=s", "directory for results of earlier runs");
+	options.process(argc, argv);
+
+	OutputDirectory = options.getString("output-directory");
+	ReplaceQ = options.getBoolean("replace");
+	BuildCache.setDirectory(options.getString("cache"));
+	if (ReplaceQ == !OutputDirectory.empty()) {
+		cerr << "Usage: " << options.getCommand()
+		     << " -p \"stage [options] | ...\" (-d outdir | --replace)"
+		     << " [-w workers] [-m manifest] [midifile(s)]" << endl;
+		exit(1);
+	}
+
+	RollPipeline pipeline;
+	if (!pipeline.parse(options.getString("pipeline"))) {
+		exit(1);
+	}
+
+	vector<string> filenames;
+	getFilenames(filenames, options);
+	if (filenames.empty()) {
+		cerr << "Error: no input files" << endl;
+		exit(1);
+	}
+	if (!checkOutputNames(filenames)) {
+		exit(1);
+	}
+
+	string journal = options.getString("journal");
+	if (journal.empty()) {
+		journal = options.getBoolean("manifest") ?
+				options.getString("manifest") + ".journal" : "rollshard.journal";
+	}
+	set<string> done;
+	set<string> failed;
+	set<string> started;
+	readJournal(journal, done, failed, started);
+
+	int workers = options.getInteger("workers");
+	if (workers <= 0) {
+		workers = (int)std::thread::hardware_concurrency();
+	}
+	if (workers < 1) {
+		workers = 1;
+	}
+
+	// Files which were started but not finished in an earlier run are
+	// done again, since the run may have been stopped while they were
+	// being processed:
+	vector<vector<string>> shards(workers);
+	int skipped = 0;
+	int pending = 0;
+	for (int i=0; i<(int)filenames.size(); i++) {
+		if (isFinished(filenames[i], done, failed)) {
+			skipped++;
+			continue;
+		}
+		shards[pending++ % workers].push_back(filenames[i]);
+	}
+	if (skipped) {
+		cerr << "Skipping " << skipped << " files already in " << journal << endl;
+	}
+
+	int journalfd = open(journal.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (journalfd < 0) {
+		cerr << "Error: cannot open journal " << journal << ": "
+		     << strerror(errno) << endl;
+		exit(1);
+	}
+
+	vector<pid_t> pids(workers, -1);
+	int running = 0;
+	for (int i=0; i<workers; i++) {
+		if (shards[i].empty()) {
+			continue;
+		}
+		pids[i] = startWorker(shards[i], pipeline, journalfd);
+		if (pids[i] > 0) {
+			running++;
+		}
+	}
+
+	int crashes = 0;
+	while (running > 0) {
+		int status;
+		pid_t pid = wait(&status);
+		if (pid < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		int shard = -1;
+		for (int i=0; i<workers; i++) {
+			if (pids[i] == pid) {
+				shard = i;
+			}
+		}
+		if (shard < 0) {
+			continue;
+		}
+		pids[shard] = -1;
+		running--;
+		if (WIFEXITED(status)) {
+			continue;
+		}
+		int signal = WTERMSIG(status);
+		if ((signal == SIGINT) || (signal == SIGTERM) || (signal == SIGHUP)) {
+			// interrupted: the current file is done again in the next run.
+			continue;
+		}
+
+		// The worker crashed: record the file it was working on as failed
+		// and start a new worker for the rest of the shard.
+		string filename = getCrashedFile(shards[shard], journal);
+		if (filename.empty()) {
+			cerr << "Error: worker " << shard + 1 << " stopped with signal "
+			     << signal << endl;
+			continue;
+		}
+		crashes++;
+		string reason = "crashed with signal " + to_string(signal);
+		writeJournal(journalfd, "fail", filename, reason);
+		cerr << "Error: " << filename << ": " << reason << endl;
+
+		readJournal(journal, done, failed, started);
+		vector<string> rest;
+		for (int i=0; i<(int)shards[shard].size(); i++) {
+			if (!isFinished(shards[shard][i], done, failed)) {
+				rest.push_back(shards[shard][i]);
+			}
+		}
+		shards[shard] = rest;
+		if (!rest.empty()) {
+			pids[shard] = startWorker(rest, pipeline, journalfd);
+			if (pids[shard] > 0) {
+				running++;
+			}
+		}
+	}
+	close(journalfd);
+
+	// Summary of all runs:
+	readJournal(journal, done, failed, started);
+	int successes = 0;
+	int failures = 0;
+	for (int i=0; i<(int)filenames.size(); i++) {
+		if (done.find(filenames[i]) != done.end()) {
+			successes++;
+		} else if (failed.find(filenames[i]) != failed.end()) {
+			failures++;
+		}
+	}
+	cerr << "Finished " << successes << " of " << filenames.size() << " files";
+	if (failures) {
+		cerr << " (" << failures << " failed";
+		if (crashes) {
+			cerr << ", " << crashes << " crashed";
+		}
+		cerr << ")";
+	}
+	cerr << endl;
+
+	return successes == (int)filenames.size() ? 0 : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// getFilenames -- Return the files listed in the manifest (one per line,
+//     ignoring empty lines and lines starting with #), followed by the
+//     files given on the command line.  Repeated files are only used once.
+//
+
+void getFilenames(vector<string>& filenames, Options& options) {
+	set<string> seen;
+	if (options.getBoolean("manifest")) {
+		ifstream input(options.getString("manifest"));
+		if (!input.is_open()) {
+			cerr << "Error: cannot read manifest " << options.getString("manifest") << endl;
+			exit(1);
+		}
+		string line;
+		while (getline(input, line)) {
+			size_t start = line.find_first_not_of(" \t\r");
+			if ((start == string::npos) || (line[start] == '#')) {
+				continue;
+			}
+			size_t end = line.find_last_not_of(" \t\r");
+			string filename = line.substr(start, end - start + 1);
+			if (seen.insert(filename).second) {
+				filenames.push_back(filename);
+			}
+		}
+	}
+	for (int i=0; i<options.getArgCount(); i++) {
+		if (seen.insert(options.getArg(i+1)).second) {
+			filenames.push_back(options.getArg(i+1));
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// readJournal -- Return the files which are done, failed and started in
+//     the journal.  A missing journal is the same as an empty one.  A
+//     file which is done after failing in an earlier run is only done.
+//
+
+void readJournal(const string& journal, set<string>& done,
+		set<string>& failed, set<string>& started) {
+	done.clear();
+	failed.clear();
+	started.clear();
+	ifstream input(journal);
+	string line;
+	while (getline(input, line)) {
+		size_t tab = line.find('\t');
+		if (tab == string::npos) {
+			continue;
+		}
+		string state = line.substr(0, tab);
+		size_t end = line.find('\t', tab + 1);
+		string filename = line.substr(tab + 1,
+				end == string::npos ? string::npos : end - tab - 1);
+		if (state == "begin") {
+			started.insert(filename);
+		} else if (state == "done") {
+			done.insert(filename);
+			failed.erase(filename);
+		} else if (state == "fail") {
+			failed.insert(filename);
+			done.erase(filename);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// isFinished -- Return true if the file is done or failed.
+//
+
+bool isFinished(const string& filename, set<string>& done,
+		set<string>& failed) {
+	return (done.find(filename) != done.end())
+			|| (failed.find(filename) != failed.end());
+}
+
+
+
+//////////////////////////////
+//
+// writeJournal -- Add a line to the journal.  The line is written with a
+//     single call to an append-only file, so lines from different workers
+//     are not mixed together.
+//
+
+void writeJournal(int fd, const string& state, const string& filename,
+		const string& reason) {
+	string line = state + "\t" + filename;
+	if (!reason.empty()) {
+		line += "\t" + reason;
+	}
+	line += "\n";
+	if (write(fd, line.data(), line.size()) != (ssize_t)line.size()) {
+		cerr << "Error: cannot write to journal: " << strerror(errno) << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// startWorker -- Start a worker process for a shard.  Returns the process
+//     id, or -1 if the process could not be started.
+//
+
+pid_t startWorker(const vector<string>& shard, RollPipeline& pipeline,
+		int journalfd) {
+	cout.flush();
+	cerr.flush();
+	pid_t pid = fork();
+	if (pid < 0) {
+		cerr << "Error: cannot start worker: " << strerror(errno) << endl;
+		return -1;
+	}
+	if (pid == 0) {
+		_exit(runWorker(shard, pipeline, journalfd));
+	}
+	return pid;
+}
+
+
+
+//////////////////////////////
+//
+// runWorker -- Process the files of a shard one at a time (in the worker
+//     process).  A file is recorded in the journal before it is read,
+//     so that a crash can be traced to it.
+//
+
+int runWorker(const vector<string>& shard, RollPipeline& pipeline,
+		int journalfd) {
+	for (int i=0; i<(int)shard.size(); i++) {
+		writeJournal(journalfd, "begin", shard[i]);
+		string reason;
+		bool cached = false;
+		if (processFile(shard[i], pipeline, reason, cached)) {
+			writeJournal(journalfd, "done", shard[i], cached ? "cached" : "");
+		} else {
+			writeJournal(journalfd, "fail", shard[i], reason);
+			cerr << "Error: " << shard[i] << ": " << reason << endl;
+		}
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// processFile -- Read a file, apply the pipeline and write the output.
+//     The output is written to a temporary file which is then renamed,
+//     so an interrupted run never leaves a partly written file.  If there
+//     is a cache directory, the output is copied from it when possible,
+//     and cached is set to true.  The tracks are processed one at a time,
+//     since the worker processes already use all of the processor cores.
+//
+
+bool processFile(const string& filename, RollPipeline& pipeline,
+		string& reason, bool& cached) {
+	cached = false;
+	if (!BuildCache.getDirectory().empty()) {
+		auto function = [&pipeline](MidiRoll& rollfile) {
+			rollfile.setThreadCount(1);
+			return pipeline.run(rollfile);
+		};
+		if (!BuildCache.build(filename, getOutputFilename(filename),
+				pipeline.getRecipe(), function, &cached)) {
+			reason = "cannot build file";
+			return false;
+		}
+		return true;
+	}
+
+	MidiRoll rollfile;
+	rollfile.setThreadCount(1);
+	if (!rollfile.read(filename)) {
+		reason = "cannot read file";
+		return false;
+	}
+	if (!pipeline.run(rollfile)) {
+		reason = "pipeline failed";
+		return false;
+	}
+	string output = getOutputFilename(filename);
+	string temporary = output + ".rollshard" + to_string(getpid());
+	if (!rollfile.write(temporary)) {
+		reason = "cannot write " + temporary;
+		unlink(temporary.c_str());
+		return false;
+	}
+	if (rename(temporary.c_str(), output.c_str()) != 0) {
+		reason = "cannot write " + output + ": " + strerror(errno);
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// getOutputFilename -- Return the input filename for --replace, or the
+//     filename in the output directory.
+//
+
+string getOutputFilename(const string& filename) {
+	if (ReplaceQ) {
+		return filename;
+	}
+	size_t slash = filename.rfind('/');
+	string base = slash == string::npos ? filename : filename.substr(slash + 1);
+	return OutputDirectory + "/" + base;
+}
+
+
+
+//////////////////////////////
+//
+// checkOutputNames -- Return false (after printing the files) if two
+//     input files would be written to the same output file, which
+//     happens with -d for files with the same name in different
+//     directories.
+//
+
+bool checkOutputNames(const vector<string>& filenames) {
+	map<string, string> inputs;
+	bool status = true;
+	for (int i=0; i<(int)filenames.size(); i++) {
+		string output = getOutputFilename(filenames[i]);
+		auto result = inputs.insert(make_pair(output, filenames[i]));
+		if (!result.second) {
+			cerr << "Error: " << result.first->second << " and " << filenames[i]
+			     << " would both be written to " << output << endl;
+			status = false;
+		}
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// getCrashedFile -- Return the file in the shard which was started but not
+//     finished according to the journal (the file a worker was processing
+//     when it crashed).  Returns an empty string if there is none.
+//
+
+string getCrashedFile(const vector<string>& shard, const string& journal) {
+	set<string> done;
+	set<string> failed;
+	set<string> started;
+	readJournal(journal, done, failed, started);
+	for (int i=0; i<(int)shard.size(); i++) {
+		if ((started.find(shard[i]) != started.end())
+				&& !isFinished(shard[i], done, failed)) {
+			return shard[i];
+		}
+	}
+	return "";
+}
+
+
+
@@ -19,6 +19,8 @@
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollBatch.h"
+#include "RollPrefetcher.h"
 #include <iostream>
 
 using namespace std;
@@ -26,7 +28,7 @@ using namespace smf;
 
 // function declarations:
 void    displayTempo     (Options& options);
-void    setTempo         (Options& options);
+int     setTempo         (Options& options);
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -35,12 +37,16 @@ int main(int argc, char** argv) {
 	Options options;
 	options.define("l|list=b", "list roll tempo(s)");
 	options.define("t|tempo=i:85", "roll tempo");
+	options.define("j|jobs=i:0", "number of files to replace at the same time");
+	options.define("progress=b", "show progress when replacing files");
 	options.process(argc, argv);
 
 	if (options.getBoolean("list")) {
 		displayTempo(options);
 	} else if (options.getBoolean("tempo")) {
-		setTempo(options);
+		if (setTempo(options) > 0) {
+			return 1;
+		}
 	} else {
 		cerr << "Usage: " << options.getCommand()
 		     << " [-t #|-l] midifile(s)"
@@ -58,25 +64,27 @@ int main(int argc, char** argv) {
 //    controlled by the ticks-per-quarter value in the MIDI header
 //    rather than a tempo meta message.  The tempo meta messages
 //    are instead used to control an emulation of the roll
-//    acceleration over time.
+//    acceleration over time.  Returns the number of files which could
+//    not be changed.
 //
 
-void setTempo(Options& options) {
+int setTempo(Options& options) {
 	MidiRoll midiroll;
 	if (options.getArgCount() == 0) {
 		// Read from standard input and write to standard output:
 		midiroll.read(cin);
 		midiroll.setRollTempo(options.getDouble("tempo"));
 		cout << midiroll;
+		return 0;
 	} else {
-		for (int i=0; i < options.getArgCount(); i++) {
-			if (i > 1) {
-				cerr << "Processing file " << options.getArgCount() << endl;
-			}
-			midiroll.read(options.getArg(i+1));
-			midiroll.setRollTempo(options.getDouble("tempo"));
-			midiroll.write(options.getArg(i+1));
-		}
+		double tempo = options.getDouble("tempo");
+		RollBatch batch;
+		batch.setThreadCount(options.getInteger("jobs"));
+		batch.setProgress(options.getBoolean("progress"));
+		return batch.run(options, [=](MidiRoll& rollfile) {
+			rollfile.setRollTempo(tempo);
+			return true;
+		});
 	}
 }
 
@@ -96,10 +104,11 @@ void displayTempo(Options& options) {
 		midiroll.read(cin);
 		cout << midiroll.getRollTempo() << endl;
 	} else {
-		for (int i=0; i<options.getArgCount(); i++) {
-			midiroll.read(options.getArg(i+1));
+		RollPrefetcher prefetcher;
+		prefetcher.start(options);
+		while (prefetcher.next(midiroll)) {
 			if (options.getArgCount() > 1) {
-				cout << options.getArg(i+1) << '\t';
+				cout << prefetcher.getFilename() << '\t';
 			}
 			cout << midiroll.getRollTempo() << endl;
 		}
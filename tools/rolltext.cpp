@@ -11,6 +11,9 @@
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollBatch.h"
+#include "RollPrefetcher.h"
+#include "RollReport.h"
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -21,13 +24,11 @@ using namespace smf;
 
 // function declarations:
 void    processMidiFile    (MidiRoll& rollfile, Options& options, int index = -1);
+int     replaceMetadata    (Options& options);
 void    queryParameter     (MidiRoll& rollfile, const string& query, bool fileQ);
 void    setMetadata        (MidiRoll& rollfile, const string& key,
                             const string& value, const string& outputfile);
-void    listAllText        (MidiRoll& rollfile, bool showTicks);
-void    listAllMetadata    (MidiRoll& rollfile, bool showTicks);
 void    errorMessage       (const string& message);
-void    deleteMetadata     (MidiRoll& rollfile, const string& key);
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -43,6 +44,8 @@ int main(int argc, char** argv) {
 	options.define("p|prefix=s:@", "metadata prefix character(s)");
 	options.define("d|delete=b", "delete the specified metadata key and its value");
 	options.define("replace=b", "overwrite the input data with the output data");
+	options.define("j|jobs=i:0", "number of files to replace at the same time");
+	options.define("progress=b", "show progress when replacing files");
 	options.process(argc, argv);
 	MidiRoll midiroll;
 	if (options.getArgCount() == 0) {
@@ -52,9 +55,15 @@ int main(int argc, char** argv) {
 		if ((options.getArgCount() > 1) && options.getBoolean("output")) {
 			errorMessage("Cannot write multiple input files to a single output file");
 		}
-		for (int i=0; i<options.getArgCount(); i++) {
-			midiroll.read(options.getArg(i+1));
-			processMidiFile(midiroll, options, i);
+		if (options.getBoolean("replace") && !options.getBoolean("output")
+				&& options.getBoolean("key")
+				&& (options.getBoolean("value") || options.getBoolean("delete"))) {
+			return (replaceMetadata(options) > 0) ? 1 : 0;
+		}
+		RollPrefetcher prefetcher;
+		prefetcher.start(options);
+		while (prefetcher.next(midiroll)) {
+			processMidiFile(midiroll, options, prefetcher.getIndex());
 		}
 	}
 	return 0;
@@ -91,7 +100,7 @@ void processMidiFile(MidiRoll& rollfile, Options& options, int index) {
 
 	} else if (options.getBoolean("key")) {
 		if (options.getBoolean("delete")) {
-			deleteMetadata(rollfile, options.getString("key"));
+			rollfile.deleteMetadata(options.getString("key"));
 
 			if (options.getBoolean("output")) {
 				// write to the given output file (should be guaranteed to be 
@@ -105,10 +114,9 @@ void processMidiFile(MidiRoll& rollfile, Options& options, int index) {
 				cout << rollfile;
 			}
 		}
-	} else if (options.getBoolean("metadata")) {
-		listAllMetadata(rollfile, options.getBoolean("ticks"));
 	} else {
-		listAllText(rollfile, options.getBoolean("ticks"));
+		RollReport::printText(rollfile, options.getBoolean("metadata"),
+				options.getBoolean("ticks"), cout);
 	}
 }
 
@@ -116,29 +124,31 @@ void processMidiFile(MidiRoll& rollfile, Options& options, int index) {
 
 //////////////////////////////
 //
-// deleteMetadata -- Remove a metadata key/value pair.
-//
-
-void deleteMetadata(MidiRoll& rollfile, const string& key) {
-	int eventCount = rollfile[0].getEventCount();
-	string prefix = rollfile.getMetadataMarker();
-	string searcher = prefix + key + ":";
-	int slen = searcher.size();
-	bool empties = false;
-	for (int i=0; i<eventCount; i++) {
-		if (!rollfile[0][i].isText()) {
-			continue;
+// replaceMetadata -- Set or delete a metadata key in each input file,
+//     writing the result back to the same file.  Several files are
+//     changed at the same time.  Returns the number of files which could
+//     not be changed.
+//
+
+int replaceMetadata(Options& options) {
+	string prefix = options.getBoolean("prefix") ? options.getString("prefix") : "";
+	string key    = options.getString("key");
+	string value  = options.getString("value");
+	bool   setQ   = options.getBoolean("value");
+	RollBatch batch;
+	batch.setThreadCount(options.getInteger("jobs"));
+	batch.setProgress(options.getBoolean("progress"));
+	return batch.run(options, [=](MidiRoll& rollfile) {
+		if (!prefix.empty()) {
+			rollfile.setMetadataMarker(prefix);
 		}
-		string data = rollfile[0][i].getMetaContent();
-		if (data.compare(0, slen, searcher) == 0) {
-			rollfile[0][i].clear();
-			empties = true;
-			
+		if (setQ) {
+			rollfile.setMetadata(key, value);
+		} else {
+			rollfile.deleteMetadata(key);
 		}
-	}
-	if (empties) {
-		rollfile[0].removeEmpties();
-	}
+		return true;
+	});
 }
 
 
@@ -211,40 +221,6 @@ void setMetadata(MidiRoll& rollfile, const string& key, const string& value,
 
 
 
-//////////////////////////////
-//
-// listAllText -- Print all text
-//
-
-void listAllText(MidiRoll& rollfile, bool showTicks) {
-	vector<MidiEvent*> mes = rollfile.getTextEvents();
-	for (int i=0; i<(int)mes.size(); i++) {
-		if (showTicks) {
-			cout << mes[i]->tick << "\t";
-		}
-		cout << mes[i]->getMetaContent() << endl;
-	}
-}
-
-
-
-//////////////////////////////
-//
-// listAllMetadata -- Print all metadata events
-//
-
-void listAllMetadata(MidiRoll& rollfile, bool showTicks) {
-	vector<MidiEvent*> mes = rollfile.getMetadataEvents();
-	for (int i=0; i<(int)mes.size(); i++) {
-		if (showTicks) {
-			cout << mes[i]->tick << "\t";
-		}
-		cout << mes[i]->getMetaContent() << endl;
-	}
-}
-
-
-
 //////////////////////////////
 //
 // errorMessage --
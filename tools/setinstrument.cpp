@@ -19,6 +19,8 @@
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollBatch.h"
+#include "RollPrefetcher.h"
 #include <iostream>
 
 using namespace std;
@@ -27,13 +29,12 @@ using namespace smf;
 // function declarations:
 void  displayTempo           (Options& options);
 void  setInstrument          (Options& options);
-void  setInstrumentOverwrite (Options& options);
+int   setInstrumentOverwrite (Options& options);
 void  setInstrument          (MidiRoll& midiroll, Options& options);
 void  displayInstruments     (Options& options);
 void  displayInstruments     (MidiRoll& midiroll, Options& options, int count);
 void  errorMessage           (Options& options, const string& message = "");
 void  getPatchChanges        (vector<vector<MidiEvent*>>& patchchanges, MidiRoll& midiroll);
-void  getTrackNoteChannels   (vector<int>& channels, MidiRoll& midiroll);
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -45,12 +46,16 @@ int main(int argc, char** argv) {
 	options.define("p|piano=b",        "use piano timbre for all tracks");
 	options.define("r|remove=b",       "remove all timbre MIDI messages.");
 	options.define("replace=b",        "replace contents of input files");
+	options.define("j|jobs=i:0",       "number of files to replace at the same time");
+	options.define("progress=b",       "show progress when replacing files");
 	options.process(argc, argv);
 
 	if (options.getBoolean("list")) {
 		displayInstruments(options);
 	} else if (options.getBoolean("replace")) {
-		setInstrumentOverwrite(options);
+		if (setInstrumentOverwrite(options) > 0) {
+			return 1;
+		}
 	} else {
 		setInstrument(options);
 	}
@@ -96,20 +101,26 @@ void setInstrument(Options& options) {
 //////////////////////////////
 //
 // setInstrumentOverwrite -- Same as setInstrument, but will replace
-//    input MIDI file.
+//    input MIDI file.  Returns the number of files which could not
+//    be changed.
 //
 
-void setInstrumentOverwrite(Options& options) {
-	MidiRoll midiroll;
+int setInstrumentOverwrite(Options& options) {
 	if (options.getArgCount() == 0) {
 		errorMessage(options);
-	} else {
-		for (int i=0; i<options.getArgCount(); i++) {
-			midiroll.read(options.getArg(i+1));
-			setInstrument(midiroll, options);
-			midiroll.write(options.getArg(i+1));
-		}
+		return 1;
+	}
+	int pc = options.getInteger("instrument");
+	if (options.getBoolean("piano")) {
+		pc = 0;
 	}
+	RollBatch batch;
+	batch.setThreadCount(options.getInteger("jobs"));
+	batch.setProgress(options.getBoolean("progress"));
+	return batch.run(options, [=](MidiRoll& midiroll) {
+		midiroll.setInstrument(pc);
+		return true;
+	});
 }
 
 
@@ -120,61 +131,11 @@ void setInstrumentOverwrite(Options& options) {
 //
 
 void setInstrument(MidiRoll& midiroll, Options& options) {
-	vector<vector<MidiEvent*>> patchchanges;
-	getPatchChanges(patchchanges, midiroll);
-
-	vector<int> channels;
-	getTrackNoteChannels(channels, midiroll);
-
 	int pc = options.getInteger("instrument");
 	if (options.getBoolean("piano")) {
 		pc = 0;
 	}
-	if (pc < 0) {
-		pc = 0;
-	}
-	if (pc > 127) {
-		pc = 127;
-	}
-
-	bool needsSort = false;
-
-	for (int i=0; i<midiroll.getTrackCount(); i++) {
-		if (!patchchanges[i].empty()) {
-			for (int j=0; j<(int)patchchanges[i].size(); j++) {
-				patchchanges[i][j]->setP1(pc);
-			}
-		} else if (channels[i] >= 0) {
-			// need to add a patch change
-			midiroll.addPatchChange(i, 0, channels[i], pc);
-			needsSort = true;
-		}
-	}
-
-	if (needsSort) {
-		midiroll.sortTracks();
-	}
-}
-
-
-
-//////////////////////////////
-//
-// getTrackNoteChannels --
-//
-
-void getTrackNoteChannels(vector<int>& channels, MidiRoll& midiroll) {
-	channels.resize(midiroll.getTrackCount());
-	for (int i=0; i<midiroll.getTrackCount(); i++) {
-		channels[i] = -1;
-		for (int j=0; j<midiroll[i].getEventCount(); j++) {
-			if (!midiroll[i][j].isNote()) {
-				continue;
-			}
-			channels[i] = midiroll[i][j].getChannel();
-			break;
-		}
-	}
+	midiroll.setInstrument(pc);
 }
 
 
@@ -192,10 +153,11 @@ void displayInstruments(Options& options) {
 		midiroll.read(cin);
 		displayInstruments(midiroll, options, 1);
 	} else {
-		for (int i=0; i<options.getArgCount(); i++) {
-			midiroll.read(options.getArg(i+1));
+		RollPrefetcher prefetcher;
+		prefetcher.start(options);
+		while (prefetcher.next(midiroll)) {
 			if (options.getArgCount() > 1) {
-				cout << options.getArg(i+1);
+				cout << prefetcher.getFilename();
 				cout << "\t";
 			}
 			displayInstruments(midiroll, options, options.getArgCount());
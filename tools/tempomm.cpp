@@ -97,14 +97,15 @@ void setTempo(Options& options) {
 //
 
 void applyTempoFactor(MidiRoll& midiroll, double factor) {
-	for (int i=0; i<midiroll[0].getEventCount(); i++) {
-		if (!midiroll[0][i].isTempo()) {
-			continue;
-		}
-		int microsec = midiroll[0][i].getTempoMicroseconds();
+	midiroll.clearAccelerationModel();
+	const vector<MidiEvent*>& tempos =
+			midiroll[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)tempos.size(); i++) {
+		int microsec = tempos[i]->getTempoMicroseconds();
 		microsec = int(microsec / factor + 0.5);
-		midiroll[0][i].setTempoMicroseconds(microsec);
+		tempos[i]->setTempoMicroseconds(microsec);
 	}
+	midiroll.invalidateTimeMap();
 }
 
 
@@ -140,11 +141,10 @@ void displayTempo(Options& options) {
 //
 
 void displayMidiTempos(MidiRoll& midiroll) {
-	for (int i=0; i<midiroll[0].getEventCount(); i++) {
-		if (!midiroll[0][i].isTempo()) {
-			continue;
-		}
-		cout << midiroll[0][i].getTempoBPM() << endl;
+	const vector<MidiEvent*>& tempos =
+			midiroll[0].getEventsOfKind(EVENT_KIND_TEMPO);
+	for (int i=0; i<(int)tempos.size(); i++) {
+		cout << tempos[i]->getTempoBPM() << endl;
 	}
 	cout << endl;
 }
@@ -0,0 +1,100 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 16:41:29 PDT 2026
+// Last Modified: Sun Oct 18 16:41:29 PDT 2026
+// Filename:      midiroll/tools/temposimp.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Replace tempo messages with as few tempo messages as
+//                possible while keeping the time of every event within
+//                a tolerance (1 millisecond by default).
+//
+// Options:
+//                -t ms   == maximum change in event times in milliseconds.
+//                -o file == output file for the simplified MIDI file.
+//                -r      == only report the number of tempo messages and
+//                           the maximum time change.
+//
+
+#include "Options.h"
+#include "MidiRoll.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+using namespace smf;
+
+// function declarations:
+void    processMidiFile    (MidiRoll& rollfile, Options& options);
+int     countTempos        (MidiRoll& rollfile);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("o|output=s", "output file for simplified MIDI file");
+	options.define("t|tolerance=d:1.0", "maximum time change in milliseconds");
+	options.define("r|report=b", "report tempo count and maximum time change");
+	options.process(argc, argv);
+	MidiRoll midiroll;
+	if (options.getArgCount() == 0) {
+		midiroll.read(cin);
+		processMidiFile(midiroll, options);
+	} else {
+		for (int i=0; i<options.getArgCount(); i++) {
+			midiroll.read(options.getArg(i+1));
+			processMidiFile(midiroll, options);
+		}
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// processMidiFile --
+//
+
+void processMidiFile(MidiRoll& rollfile, Options& options) {
+	double tolerance = options.getDouble("tolerance") / 1000.0;
+	int    oldcount  = countTempos(rollfile);
+	double maxerror  = rollfile.simplifyTempos(tolerance);
+
+	if (options.getBoolean("report")) {
+		if (options.getArgCount() > 1) {
+			cout << rollfile.getFilename() << "\t";
+		}
+		cout << "tempos: " << oldcount << " -> " << countTempos(rollfile);
+		cout << "\tmaximum error: " << maxerror * 1000.0 << " ms" << endl;
+		return;
+	}
+
+	string filename = options.getString("output");
+	if (!filename.empty()) {
+		rollfile.write(filename);
+	} else {
+		cout << rollfile;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// countTempos -- Return the number of tempo messages in all tracks.
+//
+
+int countTempos(MidiRoll& rollfile) {
+	int output = 0;
+	for (int i=0; i<rollfile.getTrackCount(); i++) {
+		output += (int)rollfile[i].getEventsOfKind(EVENT_KIND_TEMPO).size();
+	}
+	return output;
+}
+
+
+
@@ -12,15 +12,12 @@
 //
 
 #include "Options.h"
-#include "MidiFile.h"
+#include "RollReport.h"
 #include <iostream>
 
 using namespace std;
 using namespace smf;
 
-// function declarations:
-void printTickToTempoMap(MidiFile& midifile);
-
 ///////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv) {
@@ -35,33 +32,10 @@ int main(int argc, char** argv) {
 		cerr << "Usage: " << options.getCommand() << "  [midifile]" << endl;
 		exit(1);
 	}
-	printTickToTempoMap(midifile);
-	return 0;
-}
-
-
-
-//////////////////////////////
-//
-// printTickToTempoMap -- Creates a single list of all MIDI events
-//     (by calling .joinTracks()) and then iterates through the list
-//     of events printing unique tick values and their corresponding
-//     performance time in seconds.  The .doTimeAnalysis() function
-//     calculates the times in seconds.
-//
-
-void printTickToTempoMap(MidiFile& midifile) {
 	midifile.joinTracks();
 	midifile.doTimeAnalysis();
-	int lasttick = -1;
-	for (int i=0; i<midifile[0].getSize(); i++) {
-		if (lasttick == midifile[0][i].tick) {
-			continue;
-		}
-		cout << midifile[0][i].tick << "\t";
-		cout << midifile[0][i].seconds << endl;
-		lasttick = midifile[0][i].tick;
-	}
+	RollReport::printTickToTime(midifile, cout);
+	return 0;
 }
 
 
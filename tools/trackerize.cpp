@@ -12,6 +12,7 @@
 
 #include "Options.h"
 #include "MidiRoll.h"
+#include "RollSegmenter.h"
 #include <iostream>
 
 using namespace std;
@@ -25,6 +26,7 @@ int main(int argc, char** argv) {
 	options.define("s|scale=d:0.9", "Scaling factor to apply");
 	options.define("o|output-file=s", "filename to save output results");
 	options.define("replace=b", "write output to same name as input file");
+	options.define("j|jobs=i:1", "number of roll segments to process at the same time (0 = one per core)");
 	options.process(argc, argv);
 	MidiRoll rollfile;
 	if (options.getArgCount() == 0) {
@@ -37,7 +39,17 @@ int main(int argc, char** argv) {
 	}
 	double value = options.getDouble("tracker-height-in-pixels");
 	value *= options.getDouble("scale");
-	rollfile.trackerize(value);
+	if (options.getInteger("jobs") == 1) {
+		rollfile.trackerize(value);
+	} else {
+		RollSegmenter segmenter;
+		segmenter.setThreadCount(options.getInteger("jobs"));
+		segmenter.setMargin(value);
+		segmenter.run(rollfile, [value](MidiRoll& segment) {
+			segment.trackerize(value);
+			return true;
+		});
+	}
 	rollfile.setMetadata("HOLE_EXTENSION", to_string(value) + "px");
 	string filename = options.getString("output-file");
 	if ((!filename.empty()) && (options.getBoolean("output-file"))) {
@@ -84,14 +84,11 @@ int processMidiFile(MidiRoll& rollfile, Options& options) {
 	}
 
 	if (!tempoQ) {
-		rollfile.doTimeAnalysis();
+		rollfile.convertToRateTicks(2000.0);
 		rollfile.setTPQ(1000);
 	}
 
 	for (int i=0; i<rollfile[0].getEventCount(); i++) {
-		if (!tempoQ) {
-			rollfile[0][i].tick = int(rollfile[0][i].seconds * 1000.0 * 2.0 + 0.5);
-		}
 		if ((!tempoQ) && rollfile[0][i].isTempo()) {
 			rollfile[0][i].clear();
 			continue;